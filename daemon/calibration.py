@@ -0,0 +1,124 @@
+"""Per-device noise-floor cache.
+
+The VADs measure background noise in detector-specific units (RMS for
+energy, dB for spectral), so entries are keyed by capture device, VAD
+name and frame size. Each entry keeps an exponentially weighted mean
+and variance of the floors observed at commits and session ends:
+
+  mean += alpha * (x - mean)
+  var   = (1 - alpha) * (var + alpha * (x - mean_old)^2)
+
+A session seeds its VAD with the mean and starts detecting speech
+boundaries immediately (see vad.py for the check that re-bases a floor
+that no longer fits the room).
+
+The cache lives in $CACHE_DIRECTORY (set by systemd's CacheDirectory=)
+or $XDG_CACHE_HOME/fcitx5-voice, as JSON written atomically.
+"""
+
+import json
+import logging
+import math
+import os
+import time
+from dataclasses import asdict, dataclass
+from pathlib import Path
+
+logger = logging.getLogger(__name__)
+
+CACHE_FILE = "noise_floor.json"
+VERSION = 1
+DEFAULT_ALPHA = 0.2
+
+
+def default_path() -> Path:
+    cache_dir = os.environ.get("CACHE_DIRECTORY")
+    if cache_dir:
+        return Path(cache_dir.split(":")[0]) / CACHE_FILE
+    xdg = os.environ.get("XDG_CACHE_HOME") or os.path.expanduser("~/.cache")
+    return Path(xdg) / "fcitx5-voice" / CACHE_FILE
+
+
+@dataclass
+class FloorEstimate:
+    mean: float
+    var: float = 0.0
+    count: int = 1
+    updated: float = 0.0  # time.time() of the last update
+
+    @property
+    def std(self) -> float:
+        return math.sqrt(self.var)
+
+
+class NoiseFloorCache:
+    """EMA noise-floor estimates per (device, VAD, frame size).
+
+    Without a path the cache is kept in memory only (e.g. WAV replay).
+    """
+
+    def __init__(self, path: Path | None = None, alpha: float = DEFAULT_ALPHA):
+        self.path = path
+        self.alpha = alpha
+        self._entries: dict[str, FloorEstimate] = {}
+        self._dirty = False
+        if path is not None:
+            self._load()
+
+    @staticmethod
+    def key(device: str, vad: str, frame_ms: int) -> str:
+        return f"{device}|{vad}|{frame_ms}"
+
+    def lookup(self, key: str) -> FloorEstimate | None:
+        return self._entries.get(key)
+
+    def update(self, key: str, floor: float) -> None:
+        entry = self._entries.get(key)
+        if entry is None:
+            entry = self._entries[key] = FloorEstimate(mean=floor)
+        else:
+            diff = floor - entry.mean
+            entry.mean += self.alpha * diff
+            entry.var = (1 - self.alpha) * (entry.var + self.alpha * diff * diff)
+            entry.count += 1
+        entry.updated = time.time()
+        self._dirty = True
+
+    def save(self) -> None:
+        """Write the cache if it changed (errors are logged, not raised)."""
+        if self.path is None or not self._dirty:
+            return
+        data = {
+            "version": VERSION,
+            "entries": {k: asdict(v) for k, v in self._entries.items()},
+        }
+        tmp = self.path.with_suffix(".tmp")
+        try:
+            self.path.parent.mkdir(parents=True, exist_ok=True)
+            tmp.write_text(json.dumps(data, indent=1))
+            os.replace(tmp, self.path)
+            self._dirty = False
+        except OSError as e:
+            logger.warning(f"Cannot save noise-floor cache {self.path}: {e}")
+
+    def _load(self) -> None:
+        try:
+            data = json.loads(self.path.read_text())
+        except FileNotFoundError:
+            return
+        except (OSError, ValueError) as e:
+            logger.warning(f"Ignoring noise-floor cache {self.path}: {e}")
+            return
+        if not isinstance(data, dict) or data.get("version") != VERSION:
+            return
+        entries = data.get("entries")
+        if not isinstance(entries, dict):
+            return
+        for key, fields in entries.items():
+            try:
+                self._entries[key] = FloorEstimate(**fields)
+            except TypeError:
+                continue
+        logger.debug(
+            f"Loaded {len(self._entries)} noise-floor estimates from {self.path}"
+        )
@@ -1,22 +1,54 @@
 """D-Bus service for fcitx5-voice daemon with real-time streaming ASR.
 
 Bridges between D-Bus (GLib main loop) and async WebSocket streaming
-(asyncio in a separate thread).
+(a persistent asyncio loop in a separate thread, shared by recording
+sessions and the warm standby session). Events cross back to the GLib
+thread in batches through an eventfd-backed queue (see event_queue.py).
+The service is published on the session bus and, for clients that
+attach, on direct peer connections (see peer.py).
 """
 
 import asyncio
+import concurrent.futures
 import logging
+import os
 import threading
+from pathlib import Path
 
-from gi.repository import GLib
+from gi.repository import Gio, GLib
 from pydbus import SessionBus
 from pydbus.generic import signal
 
-from .recorder import AudioSource, MicSource, WavReplaySource
+from . import dsp, event_channel, event_queue
+from .calibration import NoiseFloorCache
+from .event_channel import EventChannels
+from .pcm_ring import PcmRingWriter
+from .peer import PeerServer
+from .recorder import (
+    CHUNK_DURATION_MS,
+    AudioSource,
+    MicSource,
+    WavReplaySource,
+)
+from .standby import WarmStandby
+from .tracing import LatencyTrace, TraceStamps, monotonic_us
+from .vad import (
+    DEFAULT_FRAME_MS,
+    DEFAULT_SILENCE_COMMIT_MS,
+    DEFAULT_VAD,
+    Segmenter,
+    create_vad,
+)
 from .ws_client import RivaWSClient
 
 logger = logging.getLogger(__name__)
 
+# Input levels go to the plugin's meter at this pace, not per chunk
+LEVEL_INTERVAL_MS = 100
+
+DBUS_NAME = "org.fcitx.Fcitx5.Voice"
+DBUS_PATH = "/org/fcitx/Fcitx5/Voice"
+
 # D-Bus interface XML definition
 DBUS_INTERFACE = """
 <node>
@@ -28,6 +60,14 @@ DBUS_INTERFACE = """
     <method name='GetStatus'>
       <arg type='s' name='status' direction='out'/>
     </method>
+    <method name='Prewarm'>
+    </method>
+    <method name='GetPeerAddress'>
+      <arg type='s' name='address' direction='out'/>
+    </method>
+    <method name='AttachPeer'>
+      <arg type='s' name='id' direction='in'/>
+    </method>
     <signal name='TranscriptionComplete'>
       <arg type='s' name='text'/>
       <arg type='i' name='segment_num'/>
@@ -42,6 +82,37 @@ DBUS_INTERFACE = """
     <signal name='Error'>
       <arg type='s' name='message'/>
     </signal>
+    <signal name='TranscriptionCompleteTraced'>
+      <arg type='s' name='text'/>
+      <arg type='i' name='segment_num'/>
+      <arg type='t' name='capture_us'/>
+      <arg type='t' name='send_us'/>
+      <arg type='t' name='server_us'/>
+      <arg type='t' name='emit_us'/>
+    </signal>
+    <signal name='TranscriptionDeltaTraced'>
+      <arg type='s' name='text'/>
+      <arg type='t' name='capture_us'/>
+      <arg type='t' name='send_us'/>
+      <arg type='t' name='server_us'/>
+      <arg type='t' name='emit_us'/>
+    </signal>
+  </interface>
+</node>
+"""
+
+# Methods that pass file descriptors. pydbus cannot attach a GUnixFDList to
+# a reply, so this interface is registered on the same object path directly
+# through Gio.
+CHANNELS_INTERFACE = """
+<node>
+  <interface name='org.fcitx.Fcitx5.Voice.Channels'>
+    <method name='OpenPcmRing'>
+      <arg type='h' name='fd' direction='out'/>
+    </method>
+    <method name='OpenEventChannel'>
+      <arg type='h' name='fd' direction='out'/>
+    </method>
   </interface>
 </node>
 """
@@ -59,6 +130,13 @@ class VoiceDaemonService:
         language: str,
         compression: str | None = "deflate",
         replay_wav: str | None = None,
+        vad: str = DEFAULT_VAD,
+        vad_frame_ms: int = DEFAULT_FRAME_MS,
+        silence_commit_ms: int = DEFAULT_SILENCE_COMMIT_MS,
+        trace: bool = False,
+        standby_s: float = 0,
+        preroll_ms: int = 0,
+        calibration_cache: str | None = None,
     ):
         logger.info("Initializing voice daemon service (streaming mode)")
         self.ws_url = ws_url
@@ -66,13 +144,49 @@ class VoiceDaemonService:
         self.language = language
         self.compression = compression
         self.replay_wav = replay_wav
+        self.vad_name = vad
+        self.vad_frame_ms = vad_frame_ms
+        self.silence_commit_ms = silence_commit_ms
+        self.trace = trace
+        self.standby_s = standby_s
         self.recording = False
+        self._segment_num = 0
         self._stop_event: threading.Event | None = None
-        self._stream_thread: threading.Thread | None = None
+        self._loop: asyncio.AbstractEventLoop | None = None
+        self._loop_thread: threading.Thread | None = None
+        self._stream_future: concurrent.futures.Future | None = None
+        self._standby: WarmStandby | None = None
+        # Replayed WAVs keep their floors in memory, off the user's cache
+        self.noise_floors = NoiseFloorCache(
+            Path(calibration_cache)
+            if calibration_cache and not replay_wav else None
+        )
+        self._mic: MicSource | None = None
+        if preroll_ms > 0 and not replay_wav:
+            self._mic = MicSource(preroll_ms=preroll_ms)
+            try:
+                self._mic.open()
+            except Exception as e:
+                # Retried by the first StartRecording
+                logger.warning(f"Cannot open microphone for pre-roll: {e}")
+        self.pcm_ring = PcmRingWriter()
+        self.channels = EventChannels()
+        self.peer_server: PeerServer | None = None  # Set by start_dbus_service
+        self._events = event_queue.EventQueue()
+        self._events_source = GLib.unix_fd_add_full(
+            GLib.PRIORITY_DEFAULT, self._events.fileno(), GLib.IOCondition.IN,
+            self._on_events,
+        )
+        logger.debug(f"Energy kernel: {dsp.KERNEL}")
+        logger.debug(f"Event queue: {event_queue.IMPL}")
         logger.debug(
             f"Config: url={ws_url}, model={model}, "
-            f"language={language}, compression={compression}"
+            f"language={language}, compression={compression}, "
+            f"vad={vad}/{vad_frame_ms}ms, silence_commit={silence_commit_ms}ms"
             + (f", replay_wav={replay_wav}" if replay_wav else "")
+            + (", trace" if trace else "")
+            + (f", standby={standby_s:g}s" if standby_s > 0 else "")
+            + (f", preroll={preroll_ms}ms" if self._mic else "")
         )
 
     def StartRecording(self):
@@ -81,16 +195,22 @@ class VoiceDaemonService:
             logger.warning("Already recording")
             return
 
-        # Wait briefly for previous streaming thread to finish cleanup
-        if self._stream_thread and self._stream_thread.is_alive():
-            self._stream_thread.join(timeout=2)
-            if self._stream_thread.is_alive():
-                logger.error("Previous streaming thread still running")
+        # Wait briefly for the previous session to finish cleanup
+        if self._stream_future and not self._stream_future.done():
+            try:
+                self._stream_future.result(timeout=2)
+            except concurrent.futures.TimeoutError:
+                logger.error("Previous streaming session still running")
                 self.Error("前回の録音セッションがまだ終了していません")
                 return
 
         logger.debug("D-Bus: StartRecording called")
+        # The previous session's results go out before RecordingStarted;
+        # its pending partial result is superseded by the session's end
+        self._events.clear_delta()
+        self._on_events(self._events.fileno(), GLib.IOCondition.IN)
         self.recording = True
+        self._segment_num = 0
         self.RecordingStarted()
         self._start_streaming()
 
@@ -117,84 +237,162 @@ class VoiceDaemonService:
         logger.debug(f"D-Bus: GetStatus -> {status}")
         return status
 
+    def Prewarm(self):
+        """Open (or keep) a standby ASR session (D-Bus method).
+
+        Called by the plugin when the voice input method is activated, so
+        the next StartRecording streams without connection setup. Also
+        starts the daemon through D-Bus activation. A no-op without
+        --standby.
+        """
+        logger.debug("D-Bus: Prewarm called")
+        self._ensure_loop()
+        if self._standby:
+            self._standby.touch()
+
+    def GetPeerAddress(self) -> str:
+        """Address of the private peer-to-peer server, or "" (D-Bus method)."""
+        return self.peer_server.address if self.peer_server else ""
+
+    def AttachPeer(self, peer_id: str):
+        """Export the service on a peer connection (D-Bus method).
+
+        Called on the session bus with the id the peer's Hello returned.
+        Signals emitted after this reply also reach the peer directly.
+        """
+        if not self.peer_server:
+            raise RuntimeError("Peer connections are disabled")
+        logger.debug(f"D-Bus: AttachPeer {peer_id}")
+        self.peer_server.attach(peer_id)
+
     # D-Bus signals
     TranscriptionComplete = signal()
     TranscriptionDelta = signal()
     RecordingStarted = signal()
     RecordingStopped = signal()
     Error = signal()
+    TranscriptionCompleteTraced = signal()
+    TranscriptionDeltaTraced = signal()
+
+    def _ensure_loop(self) -> asyncio.AbstractEventLoop:
+        """Start the asyncio thread on first use."""
+        if self._loop is None:
+            self._loop = asyncio.new_event_loop()
+            self._loop_thread = threading.Thread(
+                target=self._loop.run_forever, name="asyncio", daemon=True
+            )
+            self._loop_thread.start()
+            if self.standby_s > 0:
+                self._standby = WarmStandby(
+                    self._loop, self._connect_standby, self.standby_s
+                )
+        return self._loop
+
+    async def _connect_standby(self) -> RivaWSClient:
+        client = RivaWSClient(
+            url=self.ws_url,
+            model=self.model,
+            language=self.language,
+            compression=self.compression,
+        )
+        try:
+            await client.connect()
+        except BaseException:
+            await client.close()
+            raise
+        return client
 
     def _start_streaming(self):
-        """Start the async streaming thread."""
+        """Start a streaming session on the asyncio thread."""
         self._stop_event = threading.Event()
-        self._stream_thread = threading.Thread(
-            target=self._run_stream_loop, daemon=True
+        self._stream_future = asyncio.run_coroutine_threadsafe(
+            self._run_stream(), self._ensure_loop()
         )
-        self._stream_thread.start()
 
     def _stop_streaming(self):
-        """Signal the streaming thread to stop and wait for it."""
+        """Signal the streaming session to stop and wait for it."""
         if self._stop_event:
             self._stop_event.set()
-        if self._stream_thread:
-            self._stream_thread.join(timeout=15)
-            if self._stream_thread.is_alive():
-                logger.warning("Streaming thread did not stop in time")
-            self._stream_thread = None
-
-    def _run_stream_loop(self):
-        """Run the asyncio event loop for streaming (in a separate thread)."""
-        loop = asyncio.new_event_loop()
-        asyncio.set_event_loop(loop)
+        if self._stream_future:
+            try:
+                self._stream_future.result(timeout=15)
+            except concurrent.futures.TimeoutError:
+                logger.warning("Streaming session did not stop in time")
+            self._stream_future = None
+
+    def _stop_loop(self):
+        """Close the standby session and stop the asyncio thread."""
+        if self._loop is None:
+            return
+        if self._standby:
+            try:
+                asyncio.run_coroutine_threadsafe(
+                    self._standby.close(), self._loop
+                ).result(timeout=2)
+            except Exception as e:
+                logger.debug(f"Standby close error (ignored): {e}")
+        self._loop.call_soon_threadsafe(self._loop.stop)
+        self._loop_thread.join(timeout=2)
+        self._loop = None
+
+    async def _run_stream(self):
         try:
-            loop.run_until_complete(self._stream())
+            await self._stream()
         except Exception as e:
             logger.error(f"Streaming error: {e}", exc_info=True)
-            GLib.idle_add(self._emit_error, str(e))
-        finally:
-            loop.close()
+            self._post(event_queue.ERROR, str(e))
 
     def _create_audio_source(self) -> AudioSource:
         """Create the appropriate audio source based on configuration."""
         if self.replay_wav:
             return WavReplaySource(self.replay_wav, realtime=True)
-        return MicSource()
+        return self._mic or MicSource()
 
     async def _stream(self):
         """Main streaming coroutine with automatic reconnection.
 
         The audio source runs continuously outside the reconnection loop.
         On connection failure, stale audio is drained and reconnection
-        is attempted with exponential backoff.
+        is attempted with exponential backoff. The first attempt uses the
+        standby session when one is open, and keeps the audio captured
+        while connecting (and the source's pre-roll).
         """
         source = self._create_audio_source()
         source.start()
+        warm = self._standby.take() if self._standby else None
 
         try:
             backoff = 1.0
+            reconnect = False
             while not self._stop_event.is_set():
-                client = RivaWSClient(
+                # Commits are answered per connection
+                trace = LatencyTrace()
+                client = warm or RivaWSClient(
                     url=self.ws_url,
                     model=self.model,
                     language=self.language,
                     compression=self.compression,
-                    on_delta=lambda text: GLib.idle_add(
-                        self._emit_delta, text
-                    ),
-                    on_completed=lambda text: GLib.idle_add(
-                        self._emit_completed, text
-                    ),
-                    on_error=lambda msg: GLib.idle_add(
-                        self._emit_error, msg
-                    ),
+                )
+                warm = None
+                client.on_delta = lambda text: self._post(
+                    event_queue.DELTA, text, trace.delta(client.last_recv_us)
+                )
+                client.on_completed = lambda text: self._post(
+                    event_queue.COMPLETED, text,
+                    trace.completed(client.last_recv_us),
+                )
+                client.on_error = lambda msg: self._post(
+                    event_queue.ERROR, msg
                 )
                 try:
-                    await client.connect()
+                    if not client.is_open:
+                        await client.connect()
                     backoff = 1.0  # Reset on successful connection
-                    source.drain()  # Discard stale audio from reconnect gap
+                    if reconnect:
+                        source.drain()  # Discard stale audio from reconnect gap
 
                     send_task = asyncio.create_task(
-                        self._send_audio_loop(client, source)
+                        self._send_audio_loop(client, source, trace)
                     )
                     recv_task = asyncio.create_task(client.recv_loop())
 
@@ -237,12 +435,13 @@ class VoiceDaemonService:
                     await client.close()
                     if self._stop_event.is_set():
                         break
+                    reconnect = True
                     logger.warning(
                         f"WebSocket error: {e}. "
                         f"Reconnecting in {backoff:.0f}s..."
                     )
-                    GLib.idle_add(
-                        self._emit_error,
+                    self._post(
+                        event_queue.ERROR,
                         f"接続が切れました。{backoff:.0f}秒後に再接続します...",
                     )
                     await asyncio.sleep(backoff)
@@ -251,41 +450,59 @@ class VoiceDaemonService:
                     await client.close()
         finally:
             source.stop()
+            if self._standby:
+                self._standby.release()
             # If WAV replay ended naturally (not via StopRecording), emit
-            # RecordingStopped now — after recv_task has queued all completion
-            # callbacks, so they arrive before RecordingStopped on D-Bus.
+            # RecordingStopped now — queued behind all completions, so they
+            # arrive before RecordingStopped on D-Bus.
             if source.exhausted and not self._stop_event.is_set():
-                GLib.idle_add(self._on_source_exhausted)
+                self._post(event_queue.EXHAUSTED)
             logger.info("Streaming session ended")
 
     async def _send_audio_loop(
-        self, client: RivaWSClient, source: AudioSource
+        self, client: RivaWSClient, source: AudioSource, trace: LatencyTrace
     ):
         """Read audio chunks from source and send to WebSocket server.
 
-        Commits are triggered by silence detection. After speech followed
-        by silence, a commit is sent. The silence threshold is auto-calibrated
-        from the first second of ambient noise.
+        Commits are triggered by the Segmenter: after speech followed by
+        silence a commit is sent, then a few periodic flushes while the
+        silence lasts. The VAD starts from the device's cached noise floor
+        (see calibration.py); without one it calibrates from the source's
+        ambient pre-roll audio, or else from the first second of the
+        session. The cache is updated at each commit and saved at the end.
         """
-        import struct
+        vad = create_vad(self.vad_name, self.vad_frame_ms)
+        floor_key = NoiseFloorCache.key(
+            source.device, self.vad_name, self.vad_frame_ms
+        )
+        estimate = self.noise_floors.lookup(floor_key)
+        if estimate is not None:
+            logger.debug(
+                f"Cached noise floor for {floor_key}: {estimate.mean:.1f} "
+                f"± {estimate.std:.1f} (n={estimate.count})"
+            )
+            vad.seed(estimate.mean)
+        else:
+            vad.calibrate(source.ambient)
+        segmenter = Segmenter(vad, silence_commit_ms=self.silence_commit_ms)
+        try:
+            await self._send_chunks(client, source, trace, segmenter, floor_key)
+        finally:
+            if vad.calibrated:
+                self.noise_floors.update(floor_key, vad.noise_floor)
+                self.noise_floors.save()
 
-        CALIBRATION_CHUNKS = 10     # 1s calibration period
-        NOISE_MULTIPLIER = 3.0      # threshold = noise_floor * multiplier
-        MIN_THRESHOLD = 300         # absolute minimum threshold
-        SILENCE_COMMIT_CHUNKS = 2   # 200ms silence → commit
-        FLUSH_INTERVAL_CHUNKS = 10  # Flush every 1s during silence
-        MAX_FLUSHES = 3             # Up to 3 flush commits
+    async def _send_chunks(
+        self, client: RivaWSClient, source: AudioSource, trace: LatencyTrace,
+        segmenter: Segmenter, floor_key: str,
+    ):
+        vad = segmenter.vad
 
         loop = asyncio.get_event_loop()
-        has_speech = False
-        silence_chunks = 0
         chunks_since_commit = 0
-        flush_count = 0
-        silence_after_commit = 0
-
-        # Auto-calibration state
-        calibration_rms_values: list[float] = []
-        silence_threshold = 0.0  # Will be set after calibration
+        level_chunks = LEVEL_INTERVAL_MS // CHUNK_DURATION_MS
+        log_chunks = 1000 // CHUNK_DURATION_MS
+        level = bytearray()
 
         while not self._stop_event.is_set():
             chunk = await loop.run_in_executor(
@@ -297,104 +514,120 @@ class VoiceDaemonService:
                     break
                 continue
 
-            # Compute RMS energy of PCM16 audio
-            samples = struct.unpack(f"<{len(chunk) // 2}h", chunk)
-            rms = (sum(s * s for s in samples) / len(samples)) ** 0.5
+            # Publish to the plugin's level meter (shared memory, no D-Bus)
+            self.pcm_ring.write(chunk)
+            if self.channels:
+                level += chunk
+                if len(level) >= level_chunks * len(chunk):
+                    rms, peak, _ = dsp.chunk_energy(bytes(level))
+                    self.channels.send_level(len(level) // 2, peak, rms)
+                    level.clear()
 
             # Send audio to server during calibration too
             await client.send_audio(chunk)
+            trace.on_send(source.last_capture_us)
             chunks_since_commit += 1
 
-            # Calibration phase: collect noise floor samples
-            if len(calibration_rms_values) < CALIBRATION_CHUNKS:
-                calibration_rms_values.append(rms)
-                if len(calibration_rms_values) == CALIBRATION_CHUNKS:
-                    noise_floor = (
-                        sum(calibration_rms_values)
-                        / len(calibration_rms_values)
-                    )
-                    silence_threshold = max(
-                        noise_floor * NOISE_MULTIPLIER, MIN_THRESHOLD
-                    )
-                    logger.info(
-                        f"Noise calibration: floor={noise_floor:.0f} "
-                        f"threshold={silence_threshold:.0f}"
-                    )
-                continue
-
-            is_speech = rms >= silence_threshold
-            if is_speech:
-                has_speech = True
-                silence_chunks = 0
-                flush_count = 0
-                silence_after_commit = 0
-            else:
-                silence_chunks += 1
-                if flush_count < MAX_FLUSHES:
-                    silence_after_commit += 1
-
-            # Log RMS periodically (every 10 chunks = 1s)
-            if chunks_since_commit % 10 == 0:
-                logger.debug(
-                    f"RMS: {rms:.0f} threshold={silence_threshold:.0f} "
-                    f"speech={is_speech} has_speech={has_speech} "
-                    f"silence={silence_chunks}"
-                )
+            action = segmenter.feed(chunk)
 
-            # Commit after speech followed by silence
-            if has_speech and silence_chunks >= SILENCE_COMMIT_CHUNKS:
-                await client.commit()
+            # Log VAD state periodically (about once a second)
+            if chunks_since_commit % log_chunks == 0:
                 logger.debug(
-                    f"Commit: {chunks_since_commit} chunks (rms={rms:.0f})"
+                    f"VAD: {vad.describe()} "
+                    f"has_speech={segmenter.has_speech} "
+                    f"silence={segmenter.silence_frames * vad.frame_ms}ms"
                 )
-                has_speech = False
-                chunks_since_commit = 0
-                flush_count = 0
-                silence_after_commit = 0
 
-            # Periodic flush commits during silence to finalize text
-            if (flush_count < MAX_FLUSHES
-                    and silence_after_commit > 0
-                    and silence_after_commit % FLUSH_INTERVAL_CHUNKS == 0):
+            if action is not None:
                 await client.commit()
-                flush_count += 1
-                logger.debug(
-                    f"Flush {flush_count}/{MAX_FLUSHES}: "
-                    f"{chunks_since_commit} chunks"
-                )
+                trace.on_commit()
+                if action == "commit":
+                    self.noise_floors.update(floor_key, vad.noise_floor)
+                logger.debug(f"{action.capitalize()}: {chunks_since_commit} chunks")
                 chunks_since_commit = 0
 
         # Send final commit for any remaining audio
         if chunks_since_commit > 0:
             await client.commit()
+            trace.on_commit()
             logger.debug("Sent final commit")
 
-    def _on_source_exhausted(self) -> bool:
-        """Emit RecordingStopped when WAV replay finishes (called via GLib.idle_add)."""
+    def _post(self, kind: int, text: str = "",
+              stamps: TraceStamps | None = None) -> None:
+        """Queue an event for the GLib thread (called from asyncio)."""
+        if stamps is None:
+            ok = self._events.push(kind, text)
+        else:
+            ok = self._events.push(
+                kind, text, stamps.capture_us, stamps.send_us, stamps.server_us
+            )
+        if not ok:
+            logger.error(f"Event queue full; dropping event (kind {kind})")
+
+    def _on_events(self, fd: int, condition: GLib.IOCondition) -> bool:
+        """Emit every queued event in one main-loop iteration."""
+        for kind, text, capture_us, send_us, server_us in self._events.drain():
+            if kind == event_queue.DELTA:
+                self._emit_delta(
+                    text, TraceStamps(capture_us, send_us, server_us)
+                )
+            elif kind == event_queue.COMPLETED:
+                self._emit_completed(
+                    text, TraceStamps(capture_us, send_us, server_us)
+                )
+            elif kind == event_queue.ERROR:
+                self._emit_error(text)
+            elif kind == event_queue.EXHAUSTED:
+                self._on_source_exhausted()
+        return True  # Keep watching
+
+    def _on_source_exhausted(self) -> None:
+        """Emit RecordingStopped when WAV replay finishes."""
         if self.recording:
             logger.info("Auto-stopping: audio source exhausted")
             self.recording = False
             self.RecordingStopped()
-        return False
 
-    def _emit_delta(self, text: str) -> bool:
-        """Emit TranscriptionDelta signal (called via GLib.idle_add)."""
+    def _emit_delta(self, text: str, stamps: TraceStamps) -> None:
+        """Emit TranscriptionDelta signal."""
         logger.debug(f"Delta: {len(text)} chars")
-        self.TranscriptionDelta(text)
-        return False  # Don't repeat
+        if self.trace:
+            stamps.emit_us = monotonic_us()
+            _log_trace("Delta", stamps)
+            self.TranscriptionDeltaTraced(
+                text, stamps.capture_us, stamps.send_us,
+                stamps.server_us, stamps.emit_us,
+            )
+        else:
+            self.TranscriptionDelta(text)
+        self.channels.send(
+            event_channel.DELTA, text, stamps=stamps if self.trace else None
+        )
 
-    def _emit_completed(self, text: str) -> bool:
-        """Emit TranscriptionComplete signal (called via GLib.idle_add)."""
+    def _emit_completed(self, text: str, stamps: TraceStamps) -> None:
+        """Emit TranscriptionComplete signal."""
+        self._segment_num += 1
         if text:
-            logger.debug(f"Completed: {len(text)} chars")
-        self.TranscriptionComplete(text, 0)
-        return False  # Don't repeat
+            logger.debug(f"Completed #{self._segment_num}: {len(text)} chars")
+        if self.trace:
+            stamps.emit_us = monotonic_us()
+            _log_trace("Completed", stamps)
+            self.TranscriptionCompleteTraced(
+                text, self._segment_num, stamps.capture_us, stamps.send_us,
+                stamps.server_us, stamps.emit_us,
+            )
+        else:
+            self.TranscriptionComplete(text, self._segment_num)
+        self.channels.send(
+            event_channel.COMPLETED, text, self._segment_num,
+            stamps if self.trace else None,
+        )
 
-    def _emit_error(self, message: str) -> bool:
-        """Emit Error signal (called via GLib.idle_add)."""
+    def _emit_error(self, message: str) -> None:
+        """Emit Error signal."""
         logger.error(f"Emitting error signal: {message}")
         self.Error(message)
-        return False  # Don't repeat
+        self.channels.send(event_channel.ERROR, message)
 
     def cleanup(self):
         """Clean up resources."""
@@ -402,6 +635,59 @@ class VoiceDaemonService:
         if self.recording:
             self.recording = False
             self._stop_streaming()
+        self._stop_loop()
+        if self.peer_server:
+            self.peer_server.close()
+        if self._mic:
+            self._mic.close()
+        GLib.source_remove(self._events_source)
+        if self._events.dropped:
+            logger.debug(f"Superseded deltas dropped: {self._events.dropped}")
+        self.pcm_ring.close()
+        self.channels.close()
+
+
+def _log_trace(kind: str, stamps: TraceStamps) -> None:
+    logger.debug(
+        f"Trace {kind}: send +{(stamps.send_us - stamps.capture_us) / 1000:.1f}ms"
+        f" server +{(stamps.server_us - stamps.send_us) / 1000:.1f}ms"
+        f" emit +{(stamps.emit_us - stamps.server_us) / 1000:.1f}ms"
+    )
+
+
+def _register_channels(bus, service: VoiceDaemonService) -> int:
+    """Register the fd-passing Channels interface next to the main one."""
+    node = Gio.DBusNodeInfo.new_for_xml(CHANNELS_INTERFACE)
+
+    def on_method_call(connection, sender, path, interface, method,
+                       params, invocation):
+        if method == "OpenPcmRing":
+            fd_list = Gio.UnixFDList.new()
+            index = fd_list.append(service.pcm_ring.fileno())
+            logger.debug(f"D-Bus: OpenPcmRing from {sender}")
+            invocation.return_value_with_unix_fd_list(
+                GLib.Variant("(h)", (index,)), fd_list
+            )
+        elif method == "OpenEventChannel":
+            # Runs on the GLib thread, between emitted events: the reply
+            # follows every signal sent before the channel existed
+            fd = service.channels.open()
+            fd_list = Gio.UnixFDList.new()
+            index = fd_list.append(fd)
+            os.close(fd)
+            logger.debug(f"D-Bus: OpenEventChannel from {sender}")
+            invocation.return_value_with_unix_fd_list(
+                GLib.Variant("(h)", (index,)), fd_list
+            )
+        else:
+            invocation.return_dbus_error(
+                "org.freedesktop.DBus.Error.UnknownMethod",
+                f"Unknown method: {method}",
+            )
+
+    return bus.con.register_object(
+        DBUS_PATH, node.interfaces[0], on_method_call, None, None
+    )
 
 
 def start_dbus_service(
@@ -410,6 +696,14 @@ def start_dbus_service(
     language: str,
     compression: str | None = "deflate",
     replay_wav: str | None = None,
+    vad: str = DEFAULT_VAD,
+    vad_frame_ms: int = DEFAULT_FRAME_MS,
+    silence_commit_ms: int = DEFAULT_SILENCE_COMMIT_MS,
+    trace: bool = False,
+    standby_s: float = 0,
+    preroll_ms: int = 0,
+    calibration_cache: str | None = None,
+    peer: bool = True,
 ):
     """Start the D-Bus service and return the service object."""
     bus = SessionBus()
@@ -419,9 +713,28 @@ def start_dbus_service(
         language=language,
         compression=compression,
         replay_wav=replay_wav,
+        vad=vad,
+        vad_frame_ms=vad_frame_ms,
+        silence_commit_ms=silence_commit_ms,
+        trace=trace,
+        standby_s=standby_s,
+        preroll_ms=preroll_ms,
+        calibration_cache=calibration_cache,
     )
 
-    bus.publish("org.fcitx.Fcitx5.Voice", service)
-    logger.info("D-Bus service published: org.fcitx.Fcitx5.Voice")
+    bus.publish(DBUS_NAME, service)
+    _register_channels(bus, service)
+    logger.info(f"D-Bus service published: {DBUS_NAME}")
+
+    if peer:
+        def export(peer_bus):
+            registration = peer_bus.register_object(DBUS_PATH, service, None)
+            return registration, [_register_channels(peer_bus, service)]
+
+        try:
+            service.peer_server = PeerServer(DBUS_PATH, export)
+        except GLib.Error as e:
+            # Clients stay on the session bus
+            logger.warning(f"Cannot start peer D-Bus server: {e.message}")
 
     return service
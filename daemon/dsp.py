@@ -0,0 +1,38 @@
+"""Audio energy helpers for silence detection.
+
+Uses the SIMD kernel from the native module (daemon/_native, built along
+with the C++ plugin) when it is available, and numpy otherwise.
+"""
+
+import logging
+
+import numpy as np
+
+try:
+    from . import _native
+except ImportError:
+    _native = None
+
+logger = logging.getLogger(__name__)
+
+KERNEL = _native.kernel_name() if _native is not None else "numpy"
+
+
+def chunk_energy(chunk: bytes) -> tuple[float, int, int]:
+    """Return (rms, peak, zero_crossings) of a PCM16 chunk."""
+    if _native is not None:
+        return _native.energy(chunk)
+
+    samples = np.frombuffer(chunk, dtype=np.int16)
+    if len(samples) == 0:
+        return 0.0, 0, 0
+    wide = samples.astype(np.float64)
+    rms = float(np.sqrt(np.dot(wide, wide) / len(samples)))
+    peak = int(np.abs(samples.astype(np.int32)).max())
+    crossings = int(np.count_nonzero((samples[:-1] ^ samples[1:]) < 0))
+    return rms, peak, crossings
+
+
+def chunk_rms(chunk: bytes) -> float:
+    """Return the RMS energy of a PCM16 chunk."""
+    return chunk_energy(chunk)[0]
@@ -0,0 +1,109 @@
+"""Event handoff from the asyncio thread to the GLib main loop.
+
+Server events (deltas, completions, errors) are produced on the asyncio
+thread but must be emitted as D-Bus signals from the GLib thread. Rather
+than one GLib.idle_add closure (and main-loop wakeup) per event, they go
+through a single-producer/single-consumer queue with an eventfd that the
+main loop watches: the eventfd is written only for the first event after
+a drain, and the consumer takes the whole batch at once.
+
+Each delta fully replaces the previous one, so deltas do not queue: the
+producer keeps only the latest in a single slot, and a newer delta or
+any other event (a completion finalizes the segment) supersedes it. At
+most one delta per main-loop iteration reaches D-Bus, however fast the
+server streams partial results.
+
+Uses the native lock-free queue (daemon/_native, see plugin/event_queue.h)
+when it is available, and a deque with the same interface otherwise.
+"""
+
+import logging
+import os
+import threading
+from collections import deque
+
+try:
+    from . import _native
+except ImportError:
+    _native = None
+
+logger = logging.getLogger(__name__)
+
+# Event kinds (must match EventQueue::Kind in plugin/event_queue.h)
+DELTA = 0
+COMPLETED = 1
+ERROR = 2
+EXHAUSTED = 3  # Audio source ended; orders RecordingStopped after results
+
+DEFAULT_CAPACITY = 1024
+
+
+class _PyEventQueue:
+    """Pure-Python fallback for _native.EventQueue.
+
+    The queue and delta slot change under a lock, which keeps deltas
+    ordered after the events queued before them. push() queues before
+    checking the flag and drain() clears it before taking, so an event
+    is never left queued without a pending wakeup.
+    """
+
+    def __init__(self, capacity: int = DEFAULT_CAPACITY):
+        self._capacity = capacity
+        self._events: deque[tuple[int, str, int, int, int]] = deque()
+        self._fd = os.eventfd(0, os.EFD_CLOEXEC | os.EFD_NONBLOCK)
+        self._notified = False
+        self._lock = threading.Lock()
+        self._delta: tuple[int, str, int, int, int] | None = None
+        self.dropped = 0
+
+    def push(self, kind: int, text: str, capture_us: int = 0,
+             send_us: int = 0, server_us: int = 0) -> bool:
+        event = (kind, text, capture_us, send_us, server_us)
+        with self._lock:
+            if kind == DELTA:
+                if self._delta is not None:
+                    self.dropped += 1
+                self._delta = event
+            elif len(self._events) >= self._capacity:
+                return False
+            else:
+                if self._delta is not None:
+                    self._delta = None
+                    self.dropped += 1
+                self._events.append(event)
+        if not self._notified:
+            self._notified = True
+            os.eventfd_write(self._fd, 1)
+        return True
+
+    def drain(self) -> list[tuple[int, str, int, int, int]]:
+        try:
+            os.eventfd_read(self._fd)
+        except BlockingIOError:
+            pass
+        self._notified = False
+
+        with self._lock:
+            batch = list(self._events)
+            self._events.clear()
+            if self._delta is not None:
+                batch.append(self._delta)
+                self._delta = None
+        return batch
+
+    def clear_delta(self) -> None:
+        with self._lock:
+            if self._delta is not None:
+                self._delta = None
+                self.dropped += 1
+
+    def fileno(self) -> int:
+        return self._fd
+
+
+if _native is not None:
+    EventQueue = _native.EventQueue
+    IMPL = "native"
+else:
+    EventQueue = _PyEventQueue
+    IMPL = "python"
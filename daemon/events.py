@@ -0,0 +1,39 @@
+"""Parsing of server events from the Riva WebSocket protocol.
+
+Every partial result arrives as a JSON event, so this is the daemon's
+hot receive path. The native module (daemon/_native, built along with
+the C++ plugin) scans the message in place and only materializes the
+transcript string; the fallback uses json.loads.
+"""
+
+import json
+
+try:
+    from . import _native
+except ImportError:
+    _native = None
+
+DELTA_TYPE = "conversation.item.input_audio_transcription.delta"
+COMPLETED_TYPE = "conversation.item.input_audio_transcription.completed"
+
+PARSER = "native" if _native is not None else "json"
+
+
+def _parse_event_json(message: str | bytes) -> tuple[str | None, str | None]:
+    event = json.loads(message)
+    ev_type = event.get("type") if isinstance(event, dict) else None
+    if not isinstance(ev_type, str):
+        raise ValueError("malformed server event")
+    if ev_type == DELTA_TYPE:
+        return "delta", event.get("delta", "")
+    if ev_type == COMPLETED_TYPE:
+        return "completed", event.get("transcript", "")
+    if ev_type == "error":
+        return "error", None
+    return None, None
+
+
+# parse_event(message) -> (kind, text): kind is "delta", "completed",
+# "error" or None; text is the delta/transcript (None for other kinds).
+# Raises ValueError for anything but a JSON object with a string type.
+parse_event = _native.parse_event if _native is not None else _parse_event_json
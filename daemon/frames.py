@@ -0,0 +1,49 @@
+"""Preformatted outgoing messages for the Riva WebSocket protocol.
+
+input_audio_buffer.append is sent ten times a second and only its event
+id and audio change, so the JSON envelope is formatted once and each
+chunk is spliced in. The native module (daemon/_native, built along with
+the C++ plugin) writes the SIMD base64 encoding straight into the result
+string; the fallback uses a cached f-string template.
+"""
+
+import base64
+import uuid
+
+try:
+    from . import _native
+except ImportError:
+    _native = None
+
+KERNEL = _native.base64_kernel_name() if _native is not None else "binascii"
+
+_COUNTER_DIGITS = 12
+
+
+class _PyAppendFrame:
+    """Pure-Python AppendFrame with the same message and id format."""
+
+    def __init__(self):
+        self.reset()
+
+    def reset(self) -> None:
+        # event_<uuid4>, the last group replaced by a hex counter
+        prefix = str(uuid.uuid4())[: -_COUNTER_DIGITS]
+        self._head = f'{{"event_id":"event_{prefix}'
+        self._id_prefix = f"event_{prefix}"
+        self._counter = 0
+
+    def next_event_id(self) -> str:
+        self._counter += 1
+        return f"{self._id_prefix}{self._counter:012x}"
+
+    def build(self, pcm: bytes) -> str:
+        self._counter += 1
+        audio = base64.b64encode(pcm).decode("ascii")
+        return (
+            f'{self._head}{self._counter:012x}'
+            f'","type":"input_audio_buffer.append","audio":"{audio}"}}'
+        )
+
+
+AppendFrame = _native.AppendFrame if _native is not None else _PyAppendFrame
@@ -9,7 +9,9 @@ import sys
 
 from gi.repository import GLib
 
+from .calibration import default_path as default_calibration_cache
 from .dbus_service import start_dbus_service
+from .vad import DEFAULT_FRAME_MS, DEFAULT_SILENCE_COMMIT_MS, DEFAULT_VAD, VAD_NAMES
 from .ws_client import DEFAULT_URL, DEFAULT_MODEL, DEFAULT_LANGUAGE
 
 # Global service instance for cleanup
@@ -76,6 +78,65 @@ def main():
         help="Replay a WAV file instead of capturing from microphone. "
         "The WAV must be 16-bit PCM, mono, 16kHz.",
     )
+    parser.add_argument(
+        "--vad",
+        choices=VAD_NAMES,
+        default=DEFAULT_VAD,
+        help=f"Voice activity detector for commit timing (default: {DEFAULT_VAD})",
+    )
+    parser.add_argument(
+        "--vad-frame-ms",
+        type=int,
+        choices=(10, 20),
+        default=DEFAULT_FRAME_MS,
+        help=f"VAD frame size in ms (default: {DEFAULT_FRAME_MS})",
+    )
+    parser.add_argument(
+        "--silence-commit-ms",
+        type=int,
+        default=DEFAULT_SILENCE_COMMIT_MS,
+        help="Silence after speech before committing "
+        f"(default: {DEFAULT_SILENCE_COMMIT_MS})",
+    )
+    parser.add_argument(
+        "--trace",
+        action="store_true",
+        help="Emit latency-traced transcription signals (requires a plugin "
+        "that handles TranscriptionDeltaTraced/TranscriptionCompleteTraced)",
+    )
+    parser.add_argument(
+        "--standby",
+        type=float,
+        default=300,
+        metavar="SECONDS",
+        help="Keep a configured ASR session open for SECONDS after the last "
+        "recording or Prewarm call, so recording starts without connection "
+        "setup; 0 disables (default: 300)",
+    )
+    parser.add_argument(
+        "--preroll-ms",
+        type=int,
+        default=0,
+        metavar="MS",
+        help="Keep the microphone open between recordings and send the last "
+        "MS of audio before StartRecording; also calibrates the VAD from "
+        "idle audio (default: 0, off)",
+    )
+    parser.add_argument(
+        "--calibration-cache",
+        metavar="FILE",
+        default=str(default_calibration_cache()),
+        help="Per-device VAD noise-floor cache; an empty string keeps it in "
+        "memory only (default: $XDG_CACHE_HOME/fcitx5-voice/noise_floor.json)",
+    )
+    parser.add_argument(
+        "--peer",
+        action=BooleanOptionalAction,
+        default=True,
+        help="Offer clients a direct D-Bus connection that bypasses the bus "
+        "daemon (GetPeerAddress). Use --no-peer to keep all traffic on the "
+        "session bus.",
+    )
     args = parser.parse_args()
 
     setup_logging(args.debug)
@@ -97,6 +158,14 @@ def main():
             language=args.language,
             compression="deflate" if args.compression else None,
             replay_wav=args.replay_wav,
+            vad=args.vad,
+            vad_frame_ms=args.vad_frame_ms,
+            silence_commit_ms=args.silence_commit_ms,
+            trace=args.trace,
+            standby_s=args.standby,
+            preroll_ms=args.preroll_ms,
+            calibration_cache=args.calibration_cache,
+            peer=args.peer,
         )
     except Exception as e:
         logging.error(f"Failed to start D-Bus service: {e}")
@@ -0,0 +1,90 @@
+"""Shared-memory PCM16 ring for local audio metering.
+
+The daemon writes every captured chunk into a memfd-backed ring whose
+file descriptor is handed to the fcitx5 plugin over D-Bus. The plugin
+maps it read-only and computes input levels directly from the mapping,
+so metering needs no per-chunk D-Bus traffic.
+
+Layout (must match plugin/pcm_ring.h):
+  0   u32 magic ("VPCM")
+  4   u32 version
+  8   u32 sample rate
+  12  u32 capacity in samples (power of two)
+  64  u64 write position (total samples ever written)
+  128 int16 samples[capacity]
+
+Single producer: samples are stored first, then the write position is
+published with one aligned 8-byte store. Readers never block the writer.
+"""
+
+import fcntl
+import logging
+import mmap
+import os
+import struct
+
+import numpy as np
+
+from .recorder import SAMPLE_RATE
+
+logger = logging.getLogger(__name__)
+
+MAGIC = 0x4D435056  # "VPCM"
+VERSION = 1
+WRITE_POS_OFFSET = 64
+DATA_OFFSET = 128
+DEFAULT_CAPACITY = 1 << 15  # 32768 samples ≈ 2s at 16kHz
+
+
+class PcmRingWriter:
+    """Producer side of the shared PCM ring."""
+
+    def __init__(self, capacity: int = DEFAULT_CAPACITY):
+        if capacity <= 0 or capacity & (capacity - 1):
+            raise ValueError("capacity must be a power of two")
+
+        self._capacity = capacity
+        size = DATA_OFFSET + capacity * 2
+        self._fd = os.memfd_create(
+            "fcitx5-voice-pcm", os.MFD_CLOEXEC | os.MFD_ALLOW_SEALING
+        )
+        os.ftruncate(self._fd, size)
+        # Readers map the full size; forbid resizing underneath them
+        fcntl.fcntl(
+            self._fd, fcntl.F_ADD_SEALS, fcntl.F_SEAL_SHRINK | fcntl.F_SEAL_GROW
+        )
+
+        self._mm = mmap.mmap(self._fd, size)
+        struct.pack_into("<IIII", self._mm, 0, MAGIC, VERSION,
+                         SAMPLE_RATE, capacity)
+        self._write_pos = np.frombuffer(
+            self._mm, dtype=np.uint64, count=1, offset=WRITE_POS_OFFSET
+        )
+        self._data = np.frombuffer(
+            self._mm, dtype=np.int16, count=capacity, offset=DATA_OFFSET
+        )
+        self._pos = 0
+        logger.debug(f"PCM ring created: {capacity} samples, fd={self._fd}")
+
+    def fileno(self) -> int:
+        return self._fd
+
+    def write(self, chunk: bytes) -> None:
+        """Append a PCM16 chunk and publish it to readers."""
+        samples = np.frombuffer(chunk, dtype=np.int16)
+        if len(samples) > self._capacity:
+            samples = samples[-self._capacity:]
+
+        start = self._pos & (self._capacity - 1)
+        first = min(len(samples), self._capacity - start)
+        self._data[start:start + first] = samples[:first]
+        self._data[:len(samples) - first] = samples[first:]
+
+        self._pos += len(samples)
+        self._write_pos[0] = self._pos
+
+    def close(self) -> None:
+        self._write_pos = None
+        self._data = None
+        self._mm.close()
+        os.close(self._fd)
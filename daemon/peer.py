@@ -0,0 +1,142 @@
+"""Direct (peer-to-peer) D-Bus connections for the plugin.
+
+Every signal on the session bus is copied twice, daemon to bus daemon
+to plugin, and waits for the bus daemon to be scheduled in between.
+PeerServer listens on a private address (GetPeerAddress) where clients
+of the same user connect without a bus; the service object is then
+exported on that connection too, so signals reach the peer in one hop.
+
+Signals still go to the session bus as well, for other listeners, so a
+client must not handle both copies. The switch is ordered on the GLib
+thread:
+
+  1. The client connects and calls Hello on the peer, which returns an
+     id for the connection. Nothing is exported to it yet.
+  2. The client calls AttachPeer(id) on the bus. The handler exports
+     the service on the peer, and the reply follows every signal
+     already sent on the bus.
+  3. The client takes signals from the bus until that reply and from
+     the peer after it, so each signal is handled exactly once.
+"""
+
+import logging
+import os
+
+from gi.repository import Gio, GLib
+from pydbus.bus import Bus
+
+logger = logging.getLogger(__name__)
+
+PEER_INTERFACE = """
+<node>
+  <interface name='org.fcitx.Fcitx5.Voice.Peer'>
+    <method name='Hello'>
+      <arg type='s' name='id' direction='out'/>
+    </method>
+  </interface>
+</node>
+"""
+
+
+def default_address() -> str:
+    runtime_dir = os.environ.get("XDG_RUNTIME_DIR") or GLib.get_tmp_dir()
+    return f"unix:tmpdir={runtime_dir}"
+
+
+class _Peer:
+    def __init__(self, connection: Gio.DBusConnection):
+        self.connection = connection
+        self.bus = Bus(connection)
+        self.hello_id = 0
+        self.registration = None  # pydbus registration, once attached
+        self.object_ids: list[int] = []  # Raw Gio registrations
+        self.closed_id = 0
+
+
+class PeerServer:
+    """Private D-Bus server for direct connections from the plugin.
+
+    export(bus) publishes the service on an attached peer's pydbus Bus and
+    returns its pydbus registration and any raw Gio registration ids.
+    """
+
+    def __init__(self, path: str, export, address: str | None = None):
+        self._path = path
+        self._export = export
+        self._peers: dict[str, _Peer] = {}
+        self._next_id = 1
+        self._node = Gio.DBusNodeInfo.new_for_xml(PEER_INTERFACE)
+
+        observer = Gio.DBusAuthObserver.new()
+        observer.connect("allow-mechanism", self._allow_mechanism)
+        observer.connect("authorize-authenticated-peer", self._authorize)
+        self._server = Gio.DBusServer.new_sync(
+            address or default_address(), Gio.DBusServerFlags.NONE,
+            Gio.dbus_generate_guid(), observer, None,
+        )
+        self._server.connect("new-connection", self._on_new_connection)
+        self._server.start()
+        logger.info(f"Peer D-Bus address: {self.address}")
+
+    @property
+    def address(self) -> str:
+        return self._server.get_client_address()
+
+    def attach(self, peer_id: str) -> None:
+        """Start exporting the service on a connection that said Hello."""
+        peer = self._peers.get(peer_id)
+        if peer is None:
+            raise ValueError(f"Unknown peer: {peer_id}")
+        if peer.registration is not None:
+            return
+        peer.registration, peer.object_ids = self._export(peer.bus)
+        logger.debug(f"Peer {peer_id} attached")
+
+    def close(self) -> None:
+        self._server.stop()
+        for peer_id in list(self._peers):
+            self._drop(peer_id)
+
+    @staticmethod
+    def _allow_mechanism(observer, mechanism: str) -> bool:
+        return mechanism == "EXTERNAL"
+
+    @staticmethod
+    def _authorize(observer, stream, credentials) -> bool:
+        # Abstract sockets are reachable by every user in the network
+        # namespace, so the address alone grants nothing
+        return (credentials is not None
+                and credentials.get_unix_user() == os.getuid())
+
+    def _on_new_connection(self, server, connection) -> bool:
+        peer_id = str(self._next_id)
+        self._next_id += 1
+        peer = _Peer(connection)
+
+        def on_method_call(connection, sender, path, interface, method,
+                           params, invocation):
+            invocation.return_value(GLib.Variant("(s)", (peer_id,)))
+
+        peer.hello_id = connection.register_object(
+            self._path, self._node.interfaces[0], on_method_call, None, None
+        )
+        peer.closed_id = connection.connect(
+            "closed", lambda *args: self._drop(peer_id)
+        )
+        self._peers[peer_id] = peer
+        logger.debug(f"Peer {peer_id} connected")
+        return True  # Keep the connection
+
+    def _drop(self, peer_id: str) -> None:
+        peer = self._peers.pop(peer_id, None)
+        if peer is None:
+            return
+        connection = peer.connection
+        connection.disconnect(peer.closed_id)
+        if peer.registration is not None:
+            peer.registration.unregister()
+        for object_id in [peer.hello_id, *peer.object_ids]:
+            connection.unregister_object(object_id)
+        if not connection.is_closed():
+            connection.close(None, None, None)
+        logger.debug(f"Peer {peer_id} closed")
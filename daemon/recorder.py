@@ -6,6 +6,12 @@ Provides a common AudioSource protocol and two implementations:
 
 Both produce PCM16 (int16, 16kHz, mono) chunks via the same interface.
 All processing (silence detection, commit logic) belongs downstream.
+Each chunk is stamped with its CLOCK_MONOTONIC capture time for latency
+tracing (see tracing.py).
+
+MicSource can also run always-on (preroll_ms > 0): the stream stays open
+between sessions and idle audio goes to a fixed-size ring, so start()
+back-fills speech from just before the hotkey.
 """
 
 import logging
@@ -13,16 +19,24 @@ import queue
 import threading
 import time
 import wave
+from collections import deque
 from typing import Protocol, runtime_checkable
 
+from .tracing import monotonic_us
+
 logger = logging.getLogger(__name__)
 
 # Audio format constants (shared across the project)
 SAMPLE_RATE = 16000
 CHANNELS = 1
-CHUNK_DURATION_MS = 100
-CHUNK_SIZE = int(SAMPLE_RATE * CHUNK_DURATION_MS / 1000)  # 1600 samples
-CHUNK_BYTES = CHUNK_SIZE * 2  # 3200 bytes (int16 = 2 bytes per sample)
+# One chunk is one VAD decision point (segmenter.feed() runs per chunk),
+# so it is kept at the largest VAD frame rather than a network-friendly
+# size: a commit is never decided later than one chunk after the frame
+# that triggered it.
+CHUNK_DURATION_MS = 20
+CHUNK_SIZE = int(SAMPLE_RATE * CHUNK_DURATION_MS / 1000)  # 320 samples
+CHUNK_BYTES = CHUNK_SIZE * 2  # 640 bytes (int16 = 2 bytes per sample)
+AMBIENT_MS = 1000  # Idle audio kept beyond the pre-roll, for calibration
 
 
 @runtime_checkable
@@ -31,7 +45,12 @@ class AudioSource(Protocol):
 
     Implementations must provide PCM16 chunks (CHUNK_BYTES bytes each)
     via a blocking get_chunk() call. The source signals end-of-input
-    via the exhausted property.
+    via the exhausted property; last_capture_us is the monotonic capture
+    time (microseconds) of the chunk get_chunk() returned last. ambient
+    is audio from before start() that was not back-filled (empty unless
+    the source runs always-on), usable for noise calibration. device
+    names the capture device, for per-device calibration (see
+    calibration.py).
     """
 
     def start(self) -> None: ...
@@ -42,33 +61,74 @@ class AudioSource(Protocol):
     @property
     def exhausted(self) -> bool: ...
 
+    @property
+    def last_capture_us(self) -> int: ...
+
+    @property
+    def ambient(self) -> bytes: ...
+
+    @property
+    def device(self) -> str: ...
+
 
 class MicSource:
     """Live microphone input via sounddevice (PortAudio).
 
     Never exhausted — runs until explicitly stopped.
+
+    With preroll_ms > 0 the source is always-on: open() starts the stream
+    once, and between sessions the callback only appends to a ring of
+    preroll_ms + AMBIENT_MS (fixed memory, no processing). start() queues
+    the last preroll_ms of it ahead of live audio; stop() returns to the
+    ring instead of closing the stream.
     """
 
-    def __init__(self):
+    def __init__(self, preroll_ms: int = 0):
         import numpy as np
         import sounddevice as sd
         self._np = np
         self._sd = sd
-        self._audio_queue: queue.Queue[bytes] = queue.Queue()
+        self._audio_queue: queue.Queue[tuple[int, bytes]] = queue.Queue()
         self._stream: sd.InputStream | None = None
+        self._last_capture_us = 0
+        self._preroll_chunks = preroll_ms // CHUNK_DURATION_MS
+        self._ring: deque[tuple[int, bytes]] | None = None
+        if self._preroll_chunks > 0:
+            self._ring = deque(
+                maxlen=self._preroll_chunks + AMBIENT_MS // CHUNK_DURATION_MS
+            )
+        self._lock = threading.Lock()  # Guards _active against the callback
+        self._active = self._ring is None
+        self._ambient = b""
 
     @property
     def exhausted(self) -> bool:
         return False
 
-    def start(self) -> None:
+    @property
+    def last_capture_us(self) -> int:
+        return self._last_capture_us
+
+    @property
+    def ambient(self) -> bytes:
+        return self._ambient
+
+    @property
+    def device(self) -> str:
+        try:
+            return self._sd.query_devices(kind="input")["name"]
+        except Exception:
+            return "default"
+
+    def open(self) -> None:
+        """Open the stream without starting a session (always-on mode)."""
         if self._stream is not None:
-            logger.warning("Recording already started")
             return
-
         logger.info(
-            f"Starting mic source: {SAMPLE_RATE}Hz, "
+            f"Opening mic source: {SAMPLE_RATE}Hz, "
             f"{CHANNELS}ch, {CHUNK_DURATION_MS}ms chunks"
+            + (f", {self._preroll_chunks * CHUNK_DURATION_MS}ms pre-roll"
+               if self._ring is not None else "")
         )
         self._stream = self._sd.InputStream(
             samplerate=SAMPLE_RATE,
@@ -78,18 +138,53 @@ class MicSource:
             callback=self._audio_callback,
         )
         self._stream.start()
-        logger.info("Mic source started")
+
+    def start(self) -> None:
+        if self._ring is None:
+            if self._stream is not None:
+                logger.warning("Recording already started")
+                return
+            self.open()
+            logger.info("Mic source started")
+            return
+
+        with self._lock:
+            if self._active:
+                logger.warning("Recording already started")
+                return
+            idle = list(self._ring)
+            self._ring.clear()
+            split = max(0, len(idle) - self._preroll_chunks)
+            self._ambient = b"".join(chunk for _, chunk in idle[:split])
+            for item in idle[split:]:
+                self._audio_queue.put(item)
+            self._active = True
+        self.open()  # No-op unless the daemon's open() failed
+        logger.info(
+            f"Mic source started ({(len(idle) - split) * CHUNK_DURATION_MS}ms "
+            f"pre-roll)"
+        )
 
     def _audio_callback(self, indata, frames, time_info, status) -> None:
         if status:
             logger.warning(f"Audio stream status: {status}")
-        self._audio_queue.put(indata.copy().tobytes())
+        # tobytes() already copies out of PortAudio's buffer. The callback
+        # runs as soon as the block is complete, so now is its capture time.
+        item = (monotonic_us(), indata.tobytes())
+        with self._lock:
+            if self._active:
+                self._audio_queue.put(item)
+            else:
+                self._ring.append(item)
 
     def get_chunk(self, timeout: float = 0.2) -> bytes | None:
         try:
-            return self._audio_queue.get(timeout=timeout)
+            self._last_capture_us, chunk = self._audio_queue.get(
+                timeout=timeout
+            )
         except queue.Empty:
             return None
+        return chunk
 
     def drain(self) -> None:
         drained = 0
@@ -103,6 +198,17 @@ class MicSource:
             logger.debug(f"Drained {drained} stale chunks from queue")
 
     def stop(self) -> None:
+        if self._ring is not None:
+            with self._lock:
+                self._active = False
+            self._ambient = b""
+            self.drain()
+            logger.info("Mic source idle (pre-roll ring)")
+            return
+        self.close()
+
+    def close(self) -> None:
+        """Close the stream (also ends always-on mode's ring)."""
         if self._stream is None:
             return
 
@@ -132,21 +238,35 @@ class WavReplaySource:
 
     Args:
         wav_path: Path to the WAV file (must be 16-bit PCM, mono, 16kHz).
-        realtime: If True, feed chunks at real-time pace (100ms intervals).
+        realtime: If True, feed chunks at real-time pace
+                  (CHUNK_DURATION_MS intervals).
                   If False, feed as fast as the consumer can read.
     """
 
     def __init__(self, wav_path: str, realtime: bool = True):
         self._wav_path = wav_path
         self._realtime = realtime
-        self._audio_queue: queue.Queue[bytes] = queue.Queue()
+        self._audio_queue: queue.Queue[tuple[int, bytes]] = queue.Queue()
         self._exhausted = False
         self._feed_thread: threading.Thread | None = None
+        self._last_capture_us = 0
 
     @property
     def exhausted(self) -> bool:
         return self._exhausted and self._audio_queue.empty()
 
+    @property
+    def last_capture_us(self) -> int:
+        return self._last_capture_us
+
+    @property
+    def ambient(self) -> bytes:
+        return b""
+
+    @property
+    def device(self) -> str:
+        return "wav"
+
     def start(self) -> None:
         logger.info(f"Starting WAV replay: {self._wav_path}")
         self._exhausted = False
@@ -189,7 +309,7 @@ class WavReplaySource:
                         break
                     if len(raw) < CHUNK_BYTES:
                         raw += b"\x00" * (CHUNK_BYTES - len(raw))
-                    self._audio_queue.put(raw)
+                    self._audio_queue.put((monotonic_us(), raw))
                     if self._realtime:
                         time.sleep(CHUNK_DURATION_MS / 1000)
 
@@ -201,9 +321,12 @@ class WavReplaySource:
 
     def get_chunk(self, timeout: float = 0.2) -> bytes | None:
         try:
-            return self._audio_queue.get(timeout=timeout)
+            self._last_capture_us, chunk = self._audio_queue.get(
+                timeout=timeout
+            )
         except queue.Empty:
             return None
+        return chunk
 
     def drain(self) -> None:
         pass  # No stale data concern for file replay
@@ -0,0 +1,134 @@
+"""Warm standby: a configured ASR session kept open between recordings.
+
+Opening a session costs a TCP (and TLS) handshake plus two round trips
+(conversation.created, transcription_session.updated), all before the
+first audio chunk can be sent. With standby enabled the daemon keeps one
+configured session open, so StartRecording streams immediately.
+
+The session is kept for keep_s seconds after the last recording or
+Prewarm call, reconnected when the server drops it, and held open by
+WebSocket pings (see ws_client.KEEPALIVE_S). Everything except touch()
+runs on the daemon's asyncio loop.
+"""
+
+import asyncio
+import logging
+import time
+from typing import Awaitable, Callable
+
+from .ws_client import RivaWSClient
+
+logger = logging.getLogger(__name__)
+
+MAX_BACKOFF_S = 30.0
+
+
+class WarmStandby:
+    """Keeps at most one idle, configured RivaWSClient ready."""
+
+    def __init__(
+        self,
+        loop: asyncio.AbstractEventLoop,
+        connect: Callable[[], Awaitable[RivaWSClient]],
+        keep_s: float,
+    ):
+        self._loop = loop
+        self._connect = connect
+        self.keep_s = keep_s
+        self._client: RivaWSClient | None = None
+        self._deadline = 0.0
+        self._busy = False  # A recording owns the connection
+        self._wake = asyncio.Event()
+        self._task: asyncio.Task | None = None
+
+    def touch(self) -> None:
+        """Keep (or start) a standby session for keep_s (any thread)."""
+        self._loop.call_soon_threadsafe(self._extend)
+
+    def take(self) -> RivaWSClient | None:
+        """Hand the standby session to a recording, if one is open."""
+        self._busy = True
+        self._extend()
+        client, self._client = self._client, None
+        if client is not None and client.is_open:
+            logger.debug("Using standby session")
+            return client
+        if client is not None:
+            self._loop.create_task(client.close())
+        return None
+
+    def release(self) -> None:
+        """The recording ended; open a fresh standby session."""
+        self._busy = False
+        self._extend()
+
+    async def close(self) -> None:
+        if self._task is not None:
+            self._task.cancel()
+            try:
+                await self._task
+            except asyncio.CancelledError:
+                pass
+            self._task = None
+        if self._client is not None:
+            await self._client.close()
+            self._client = None
+
+    def _extend(self) -> None:
+        self._deadline = time.monotonic() + self.keep_s
+        self._wake.set()
+        if self._task is None:
+            self._task = self._loop.create_task(self._run())
+
+    async def _run(self) -> None:
+        backoff = 1.0
+        while True:
+            self._wake.clear()
+            remaining = self._deadline - time.monotonic()
+            if self._busy or remaining <= 0:
+                if self._client is not None:
+                    await self._client.close()
+                    self._client = None
+                    logger.debug("Standby session closed")
+                if not self._busy:
+                    self._task = None  # Restarted by the next touch()
+                    return
+                await self._wake.wait()
+                continue
+
+            if self._client is None or not self._client.is_open:
+                if self._client is not None:
+                    logger.debug("Standby session dropped; reconnecting")
+                    await self._client.close()
+                    self._client = None
+                try:
+                    client = await self._connect()
+                except Exception as e:
+                    logger.debug(
+                        f"Standby connect failed: {e}; retrying in {backoff:.0f}s"
+                    )
+                    await self._wait(None, min(backoff, remaining))
+                    backoff = min(backoff * 2, MAX_BACKOFF_S)
+                    continue
+                backoff = 1.0
+                if self._busy:
+                    # A recording started meanwhile and connected itself
+                    await client.close()
+                    continue
+                self._client = client
+                logger.info("Standby session ready")
+
+            await self._wait(self._client, remaining)
+
+    async def _wait(self, client: RivaWSClient | None, timeout: float) -> None:
+        """Sleep until woken, timeout, or client's connection closes."""
+        waiters = [asyncio.ensure_future(self._wake.wait())]
+        if client is not None:
+            waiters.append(asyncio.ensure_future(client.wait_closed()))
+        try:
+            await asyncio.wait(
+                waiters, timeout=timeout, return_when=asyncio.FIRST_COMPLETED
+            )
+        finally:
+            for waiter in waiters:
+                waiter.cancel()
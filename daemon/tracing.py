@@ -0,0 +1,60 @@
+"""Latency tracing from audio capture to the plugin.
+
+With tracing enabled (fcitx5-voice-daemon --trace) the daemon emits the
+*Traced variants of the transcription signals, which carry CLOCK_MONOTONIC
+timestamps in microseconds. CLOCK_MONOTONIC is system-wide, so the plugin
+can extend the trace with its own receive and display times:
+
+  capture_us  audio chunk captured (newest chunk the result can cover)
+  send_us     that chunk written to the WebSocket
+  server_us   server event received by the daemon
+  emit_us     D-Bus signal emitted
+"""
+
+import time
+from collections import deque
+from dataclasses import dataclass
+
+
+def monotonic_us() -> int:
+    """CLOCK_MONOTONIC in microseconds, the clock fcitx's now() uses."""
+    return time.monotonic_ns() // 1000
+
+
+@dataclass
+class TraceStamps:
+    capture_us: int = 0
+    send_us: int = 0
+    server_us: int = 0
+    emit_us: int = 0
+
+
+class LatencyTrace:
+    """Matches server events to the audio they answer.
+
+    A delta covers audio up to the newest chunk sent; a completed event
+    answers the oldest unanswered commit, which covers audio up to the
+    chunk sent just before it.
+    """
+
+    def __init__(self):
+        self._capture_us = 0
+        self._send_us = 0
+        self._commits: deque[tuple[int, int]] = deque()
+
+    def on_send(self, capture_us: int) -> None:
+        self._capture_us = capture_us
+        self._send_us = monotonic_us()
+
+    def on_commit(self) -> None:
+        self._commits.append((self._capture_us, self._send_us))
+
+    def delta(self, server_us: int) -> TraceStamps:
+        return TraceStamps(self._capture_us, self._send_us, server_us)
+
+    def completed(self, server_us: int) -> TraceStamps:
+        if self._commits:
+            capture_us, send_us = self._commits.popleft()
+        else:
+            capture_us, send_us = self._capture_us, self._send_us
+        return TraceStamps(capture_us, send_us, server_us)
@@ -0,0 +1,345 @@
+"""Voice activity detection and commit segmentation.
+
+Audio chunks are split into short frames (10-20ms) and classified by a
+VoiceActivityDetector. The Segmenter turns the per-frame decisions into
+commit points for the ASR server:
+
+  - speech followed by silence_commit_ms of silence  → commit
+  - every flush_interval_ms of further silence        → flush commit
+    (up to max_flushes, so trailing text is finalized)
+
+Two detectors are provided and selected by name via create_vad():
+
+  energy   - RMS energy against an adaptive noise floor
+  spectral - speech-band (300-3400Hz) energy plus spectral flux
+
+Both calibrate their noise floor from the first calibration_ms of audio
+(unless seeded with a known floor or calibrated from pre-roll ambient
+audio), keep adapting it on non-speech frames, and hold speech for
+hangover_ms to bridge short dips inside words.
+
+A seeded floor is only adapted on non-speech frames, so one that is too
+low for the room (every frame looks like speech) would never recover.
+The first calibration_ms after seeding is therefore checked: if even the
+quietest tenth of its frames counts as speech, the floor is re-based to
+that level.
+"""
+
+import logging
+import math
+from typing import Protocol, runtime_checkable
+
+import numpy as np
+
+from . import dsp
+from .recorder import SAMPLE_RATE
+
+logger = logging.getLogger(__name__)
+
+VAD_NAMES = ("energy", "spectral")
+DEFAULT_VAD = "energy"
+DEFAULT_FRAME_MS = 10
+DEFAULT_SILENCE_COMMIT_MS = 150
+
+
+@runtime_checkable
+class VoiceActivityDetector(Protocol):
+    """Classifies fixed-size PCM16 frames as speech or non-speech."""
+
+    frame_ms: int
+
+    def process(self, frame: bytes) -> bool | None:
+        """Return True for speech, False for silence, None while calibrating."""
+        ...
+
+    @property
+    def noise_floor(self) -> float: ...
+
+    @property
+    def calibrated(self) -> bool: ...
+
+    def seed(self, floor: float) -> None:
+        """Start from a known noise floor instead of calibrating."""
+        ...
+
+    def calibrate(self, audio: bytes) -> bool:
+        """Calibrate from ambient audio; False if it is too short."""
+        ...
+
+    def describe(self) -> str: ...
+
+
+class _AdaptiveVAD:
+    """Calibration, adaptive floor and hangover shared by the detectors.
+
+    Subclasses measure a per-frame level and decide whether it is active
+    relative to the current floor.
+    """
+
+    def __init__(
+        self,
+        frame_ms: int,
+        calibration_ms: int,
+        hangover_ms: int,
+        floor_alpha: float,
+    ):
+        self.frame_ms = frame_ms
+        self._frame_bytes = SAMPLE_RATE * frame_ms // 1000 * 2
+        self._calibration_frames = max(1, calibration_ms // frame_ms)
+        self._hangover_frames = hangover_ms // frame_ms
+        self._floor_alpha = floor_alpha
+        self._calibration: list[float] = []
+        self._floor: float | None = None
+        self._seed_check: list[float] | None = None  # Levels since seed()
+        self._hangover = 0
+
+    @property
+    def noise_floor(self) -> float:
+        return self._floor if self._floor is not None else 0.0
+
+    @property
+    def calibrated(self) -> bool:
+        return self._floor is not None
+
+    def seed(self, floor: float) -> None:
+        self._floor = floor
+        self._calibration.clear()
+        self._seed_check = []
+        logger.debug(f"VAD seeded: {self.describe()}")
+
+    def calibrate(self, audio: bytes) -> bool:
+        # The ambient audio may contain speech (the user talking before
+        # the hotkey), so take the median rather than the mean
+        usable = len(audio) - len(audio) % self._frame_bytes
+        if usable // self._frame_bytes < self._calibration_frames:
+            return False
+        view = memoryview(audio)
+        levels = sorted(
+            self._measure(view[offset:offset + self._frame_bytes])
+            for offset in range(0, usable, self._frame_bytes)
+        )
+        self._floor = levels[len(levels) // 2]
+        self._calibration.clear()
+        logger.info(f"VAD calibrated from ambient audio: {self.describe()}")
+        return True
+
+    def process(self, frame: bytes) -> bool | None:
+        level = self._measure(frame)
+
+        if self._floor is None:
+            self._calibration.append(level)
+            if len(self._calibration) == self._calibration_frames:
+                self._floor = sum(self._calibration) / len(self._calibration)
+                self._calibration.clear()
+                logger.info(f"VAD calibrated: {self.describe()}")
+            return None
+
+        if self._seed_check is not None:
+            self._check_seed(level)
+
+        if self._is_active(level):
+            self._hangover = self._hangover_frames
+            return True
+
+        # Track slow changes in background noise on non-speech frames only
+        self._floor += self._floor_alpha * (level - self._floor)
+        if self._hangover > 0:
+            self._hangover -= 1
+            return True
+        return False
+
+    def _check_seed(self, level: float) -> None:
+        self._seed_check.append(level)
+        if len(self._seed_check) < self._calibration_frames:
+            return
+        levels = sorted(self._seed_check)
+        self._seed_check = None
+        quiet = levels[len(levels) // 10]
+        if self._is_active(quiet):
+            self._floor = quiet
+            logger.info(f"VAD seed too low for the room, re-based: {self.describe()}")
+
+    def _measure(self, frame: bytes) -> float:
+        raise NotImplementedError
+
+    def _is_active(self, level: float) -> bool:
+        raise NotImplementedError
+
+
+class EnergyVAD(_AdaptiveVAD):
+    """RMS energy against noise_floor * multiplier (min min_threshold)."""
+
+    def __init__(
+        self,
+        frame_ms: int = DEFAULT_FRAME_MS,
+        calibration_ms: int = 1000,
+        hangover_ms: int = 50,
+        multiplier: float = 3.0,
+        min_threshold: float = 300.0,
+        floor_alpha: float = 0.02,
+    ):
+        super().__init__(frame_ms, calibration_ms, hangover_ms, floor_alpha)
+        self._multiplier = multiplier
+        self._min_threshold = min_threshold
+
+    @property
+    def threshold(self) -> float:
+        return max(self.noise_floor * self._multiplier, self._min_threshold)
+
+    def _measure(self, frame: bytes) -> float:
+        return dsp.chunk_rms(frame)
+
+    def _is_active(self, level: float) -> bool:
+        return level >= self.threshold
+
+    def describe(self) -> str:
+        return (
+            f"energy floor={self.noise_floor:.0f} "
+            f"threshold={self.threshold:.0f}"
+        )
+
+
+class SpectralVAD(_AdaptiveVAD):
+    """Speech-band energy (dB) with spectral flux for fast onsets.
+
+    Levels are in dB relative to one PCM16 step (RMS-equivalent), so
+    min_db=40 corresponds to an in-band RMS of 100. A frame is speech
+    when its 300-3400Hz energy exceeds the floor by
+    margin_db, or by half that margin while the spectrum is changing
+    quickly (flux above flux_threshold), which catches soft onsets that
+    broadband energy misses.
+    """
+
+    BAND_HZ = (300.0, 3400.0)
+
+    def __init__(
+        self,
+        frame_ms: int = DEFAULT_FRAME_MS,
+        calibration_ms: int = 1000,
+        hangover_ms: int = 50,
+        margin_db: float = 9.0,
+        min_db: float = 40.0,
+        flux_threshold: float = 0.6,
+        floor_alpha: float = 0.02,
+    ):
+        super().__init__(frame_ms, calibration_ms, hangover_ms, floor_alpha)
+        self._margin_db = margin_db
+        self._min_db = min_db
+        self._flux_threshold = flux_threshold
+
+        n = self._frame_bytes // 2
+        self._window = np.hanning(n)
+        # Normalize so white noise of RMS A measures 20*log10(A) dB
+        self._window_power = float(np.sum(self._window ** 2))
+        freqs = np.fft.rfftfreq(n, 1.0 / SAMPLE_RATE)
+        self._band = (freqs >= self.BAND_HZ[0]) & (freqs <= self.BAND_HZ[1])
+        self._prev_spectrum: np.ndarray | None = None
+        self._flux = 0.0
+
+    def _measure(self, frame: bytes) -> float:
+        samples = np.frombuffer(frame, dtype=np.int16).astype(np.float64)
+        spectrum = np.abs(np.fft.rfft(samples * self._window))[self._band]
+
+        if self._prev_spectrum is not None:
+            rise = np.maximum(spectrum - self._prev_spectrum, 0.0).sum()
+            self._flux = rise / (self._prev_spectrum.sum() + 1e-9)
+        self._prev_spectrum = spectrum
+
+        power = float(np.mean(spectrum * spectrum)) / self._window_power
+        return 10.0 * math.log10(power + 1e-9)
+
+    def _is_active(self, level: float) -> bool:
+        if level < self._min_db:
+            return False
+        margin = self._margin_db
+        if self._flux >= self._flux_threshold:
+            margin /= 2
+        return level >= self.noise_floor + margin
+
+    def describe(self) -> str:
+        return (
+            f"spectral floor={self.noise_floor:.1f}dB "
+            f"margin={self._margin_db:.1f}dB"
+        )
+
+
+def create_vad(name: str = DEFAULT_VAD,
+               frame_ms: int = DEFAULT_FRAME_MS) -> VoiceActivityDetector:
+    """Create a detector by name ("energy" or "spectral")."""
+    if name == "energy":
+        return EnergyVAD(frame_ms=frame_ms)
+    if name == "spectral":
+        return SpectralVAD(frame_ms=frame_ms)
+    raise ValueError(f"Unknown VAD: {name} (choose from {', '.join(VAD_NAMES)})")
+
+
+class Segmenter:
+    """Turns per-frame VAD decisions into commit points.
+
+    feed() takes an audio chunk (already sent to the server), classifies
+    it frame by frame and returns "commit", "flush" or None.
+    """
+
+    def __init__(
+        self,
+        vad: VoiceActivityDetector,
+        silence_commit_ms: int = DEFAULT_SILENCE_COMMIT_MS,
+        flush_interval_ms: int = 1000,
+        max_flushes: int = 3,
+    ):
+        self.vad = vad
+        self._frame_bytes = SAMPLE_RATE * vad.frame_ms // 1000 * 2
+        self._silence_commit_frames = max(1, silence_commit_ms // vad.frame_ms)
+        self._flush_frames = max(1, flush_interval_ms // vad.frame_ms)
+        self._max_flushes = max_flushes
+
+        self.has_speech = False
+        self.silence_frames = 0
+        self._flush_count = 0
+        self._silence_after_commit = 0
+        self._pending = b""
+
+    def feed(self, chunk: bytes) -> str | None:
+        data = self._pending + chunk if self._pending else chunk
+        usable = len(data) - len(data) % self._frame_bytes
+        self._pending = data[usable:]
+
+        action = None
+        view = memoryview(data)
+        for offset in range(0, usable, self._frame_bytes):
+            frame = view[offset:offset + self._frame_bytes]
+            result = self._step(self.vad.process(frame))
+            if result and action != "commit":
+                action = result
+        return action
+
+    def _step(self, is_speech: bool | None) -> str | None:
+        if is_speech is None:
+            return None  # Calibrating
+
+        if is_speech:
+            self.has_speech = True
+            self.silence_frames = 0
+            self._flush_count = 0
+            self._silence_after_commit = 0
+            return None
+
+        self.silence_frames += 1
+        if self._flush_count < self._max_flushes:
+            self._silence_after_commit += 1
+
+        # Commit after speech followed by silence
+        if self.has_speech and self.silence_frames >= self._silence_commit_frames:
+            self.has_speech = False
+            self._flush_count = 0
+            self._silence_after_commit = 0
+            return "commit"
+
+        # Periodic flush commits during silence to finalize text
+        if (self._flush_count < self._max_flushes
+                and self._silence_after_commit > 0
+                and self._silence_after_commit % self._flush_frames == 0):
+            self._flush_count += 1
+            return "flush"
+
+        return None
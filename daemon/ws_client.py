@@ -6,29 +6,29 @@ Implements the NIM Riva transcription WebSocket protocol:
   3. Send transcription_session.update with config
   4. Receive transcription_session.updated
   5. Stream audio as base64 PCM16 via input_audio_buffer.append
+     (preformatted, see frames.py)
   6. Periodically send input_audio_buffer.commit
   7. Receive delta (partial) and completed (final) transcription events
 """
 
 import asyncio
-import base64
 import json
 import logging
-import uuid
 from typing import Callable
 
 import websockets
+from websockets.protocol import State
+
+from .events import parse_event
+from .frames import AppendFrame
+from .tracing import monotonic_us
 
 logger = logging.getLogger(__name__)
 
 DEFAULT_URL = "ws://localhost:9000"
 DEFAULT_MODEL = "parakeet-rnnt-1.1b-unified-ml-cs-universal-multi-asr-streaming"
 DEFAULT_LANGUAGE = "ja-JP"
-DEFAULT_COMMIT_INTERVAL = 10  # Commit every N chunks (N * 100ms)
-
-
-def _event_id() -> str:
-    return f"event_{uuid.uuid4()}"
+KEEPALIVE_S = 20  # Ping interval; keeps idle standby sessions open
 
 
 def _clean_text(text: str, language: str) -> str:
@@ -63,6 +63,9 @@ class RivaWSClient:
         self.on_completed = on_completed
         self.on_error = on_error
         self._ws: websockets.ClientConnection | None = None
+        self._frame = AppendFrame()
+        # Receive time of the event being dispatched, for latency tracing
+        self.last_recv_us = 0
 
     async def connect(self) -> None:
         """Connect to NIM Riva and configure transcription session."""
@@ -70,8 +73,13 @@ class RivaWSClient:
         logger.debug(f"Connecting to {ws_url}")
 
         logger.debug(f"WebSocket compression: {self.compression}")
+        self._frame.reset()
         self._ws = await websockets.connect(
-            ws_url, compression=self.compression, open_timeout=10
+            ws_url,
+            compression=self.compression,
+            open_timeout=10,
+            ping_interval=KEEPALIVE_S,
+            ping_timeout=KEEPALIVE_S,
         )
 
         # Wait for conversation.created
@@ -85,7 +93,7 @@ class RivaWSClient:
         await self._ws.send(
             json.dumps(
                 {
-                    "event_id": _event_id(),
+                    "event_id": self._frame.next_event_id(),
                     "type": "transcription_session.update",
                     "session": {
                         "input_audio_format": "pcm16",
@@ -112,20 +120,21 @@ class RivaWSClient:
             f"language={self.language})"
         )
 
+    @property
+    def is_open(self) -> bool:
+        """True while the session is connected and usable."""
+        return self._ws is not None and self._ws.state is State.OPEN
+
+    async def wait_closed(self) -> None:
+        """Return once the connection has closed (e.g. keepalive timeout)."""
+        if self._ws:
+            await self._ws.wait_closed()
+
     async def send_audio(self, audio_bytes: bytes) -> None:
         """Send a PCM16 audio chunk to the server."""
         if not self._ws:
             return
-        audio_b64 = base64.b64encode(audio_bytes).decode("ascii")
-        await self._ws.send(
-            json.dumps(
-                {
-                    "event_id": _event_id(),
-                    "type": "input_audio_buffer.append",
-                    "audio": audio_b64,
-                }
-            )
-        )
+        await self._ws.send(self._frame.build(audio_bytes))
 
     async def commit(self) -> None:
         """Commit the current audio buffer for transcription."""
@@ -134,7 +143,7 @@ class RivaWSClient:
         await self._ws.send(
             json.dumps(
                 {
-                    "event_id": _event_id(),
+                    "event_id": self._frame.next_event_id(),
                     "type": "input_audio_buffer.commit",
                 }
             )
@@ -145,25 +154,32 @@ class RivaWSClient:
         if not self._ws:
             return
 
-        async for msg in self._ws:
-            event = json.loads(msg)
-            ev_type = event.get("type", "")
+        while True:
+            try:
+                # Raw bytes: the event parser scans the UTF-8 in place
+                msg = await self._ws.recv(decode=False)
+            except websockets.ConnectionClosedOK:
+                return
+            self.last_recv_us = monotonic_us()
+            try:
+                kind, text = parse_event(msg)
+            except ValueError:
+                logger.warning("Ignoring malformed server event")
+                continue
 
-            if ev_type == "conversation.item.input_audio_transcription.delta":
-                delta = _clean_text(event.get("delta", ""), self.language)
+            if kind == "delta":
+                delta = _clean_text(text, self.language)
                 if delta:
                     if self.on_delta:
                         self.on_delta(delta)
 
-            elif ev_type == "conversation.item.input_audio_transcription.completed":
-                transcript = _clean_text(
-                    event.get("transcript", ""), self.language
-                )
+            elif kind == "completed":
+                transcript = _clean_text(text, self.language)
                 if self.on_completed:
                     self.on_completed(transcript)
 
-            elif ev_type == "error":
-                error_msg = json.dumps(event, ensure_ascii=False)
+            elif kind == "error":
+                error_msg = json.dumps(json.loads(msg), ensure_ascii=False)
                 logger.error(f"Server error: {error_msg}")
                 if self.on_error:
                     self.on_error(error_msg)
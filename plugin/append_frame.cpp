@@ -0,0 +1,55 @@
+#include "append_frame.h"
+#include <cstdio>
+#include <cstring>
+#include <sys/random.h>
+
+namespace fcitx {
+
+AppendFrame::AppendFrame() {
+    auto* out = prefix_.data();
+    std::memcpy(out, HEAD.data(), HEAD.size());
+    std::memcpy(out + HEAD.size() + EVENT_ID_SIZE, TYPE.data(), TYPE.size());
+    reset();
+}
+
+void AppendFrame::reset() {
+    uint8_t r[10] = {};
+    getrandom(r, sizeof(r), 0);
+    // uuid4 layout: version nibble 4, variant bits 10
+    char id[EVENT_ID_SIZE + 1];
+    std::snprintf(id, sizeof(id),
+                  "event_%02x%02x%02x%02x-%02x%02x-4%01x%02x-%02x%02x-",
+                  r[0], r[1], r[2], r[3], r[4], r[5], r[6] & 0x0F, r[7],
+                  (r[8] & 0x3F) | 0x80, r[9]);
+    std::memcpy(prefix_.data() + HEAD.size(), id,
+                EVENT_ID_SIZE - COUNTER_DIGITS);
+    counter_ = 0;
+}
+
+std::string_view AppendFrame::nextEventId() {
+    static constexpr char HEX[] = "0123456789abcdef";
+    uint64_t v = ++counter_;
+    char* end = prefix_.data() + HEAD.size() + EVENT_ID_SIZE;
+    for (size_t i = 1; i <= COUNTER_DIGITS; ++i) {
+        end[-static_cast<ptrdiff_t>(i)] = HEX[v & 0xF];
+        v >>= 4;
+    }
+    return {prefix_.data() + HEAD.size(), EVENT_ID_SIZE};
+}
+
+void AppendFrame::write(const uint8_t* audio, size_t n, char* out) {
+    nextEventId();
+    std::memcpy(out, prefix_.data(), PREFIX_SIZE);
+    out += PREFIX_SIZE;
+    base64Encode(audio, n, out);
+    out += base64EncodedSize(n);
+    std::memcpy(out, TAIL.data(), TAIL.size());
+}
+
+std::string_view AppendFrame::build(const uint8_t* audio, size_t n) {
+    buffer_.resize(messageSize(n));
+    write(audio, n, buffer_.data());
+    return buffer_;
+}
+
+} // namespace fcitx
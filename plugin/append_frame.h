@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "base64.h"
+
+namespace fcitx {
+
+/**
+ * Preformatted input_audio_buffer.append message.
+ *
+ * The JSON envelope is formatted once; each message only advances the
+ * event id in place and base64-encodes the audio directly behind it, so
+ * a chunk costs one SIMD encode and no allocation or JSON serialization.
+ *
+ * Event ids keep the event_<uuid4> shape the daemon used: a random
+ * prefix per sequence with a 12-digit hex counter as the last group.
+ * Other messages of the session take their ids from the same sequence
+ * through nextEventId().
+ */
+class AppendFrame {
+public:
+    static constexpr std::string_view HEAD = R"({"event_id":")";
+    static constexpr std::string_view TYPE =
+        R"(","type":"input_audio_buffer.append","audio":")";
+    static constexpr std::string_view TAIL = R"("})";
+    static constexpr size_t EVENT_ID_SIZE = 42;  // "event_" + 36-char uuid
+
+    AppendFrame();
+
+    /** Start a new id sequence with a fresh random prefix. */
+    void reset();
+
+    /** Advance the sequence; the view is valid until the next call. */
+    std::string_view nextEventId();
+
+    /** Length of the message carrying n bytes of audio. */
+    static constexpr size_t messageSize(size_t n) {
+        return PREFIX_SIZE + base64EncodedSize(n) + TAIL.size();
+    }
+
+    /**
+     * Write the message for audio, with the next event id, to out
+     * (messageSize(n) chars, no terminator).
+     */
+    void write(const uint8_t* audio, size_t n, char* out);
+
+    /**
+     * Build the message in an internal buffer reused across calls; the
+     * view is valid until the next call.
+     */
+    std::string_view build(const uint8_t* audio, size_t n);
+
+private:
+    static constexpr size_t PREFIX_SIZE =
+        HEAD.size() + EVENT_ID_SIZE + TYPE.size();
+    static constexpr size_t COUNTER_DIGITS = 12;
+
+    // HEAD + event id + TYPE; the counter digits are rewritten in place
+    std::array<char, PREFIX_SIZE> prefix_;
+    uint64_t counter_ = 0;
+    std::string buffer_;
+};
+
+} // namespace fcitx
@@ -0,0 +1,121 @@
+// fcitx5-voice-asr-cli: drive the native ASR transport outside fcitx.
+//
+// Streams a WAV file to the ASR server (or tools/mock_riva_server.py)
+// through NativeAsrClient on a plain fcitx EventLoop and prints one line
+// per event to stdout:
+//
+//   ready
+//   delta<TAB>text
+//   completed<TAB>text
+//   error<TAB>message
+//
+// Exits 0 when the session finishes normally, 1 on error.
+
+#include <fcitx-utils/event.h>
+#include <getopt.h>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "native_asr.h"
+#include "wav_source.h"
+
+namespace {
+
+void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [options] FILE.wav\n"
+              << "\n"
+              << "  --url URL              ASR server (default: ws://localhost:9000)\n"
+              << "  --language CODE        Recognition language (default: ja-JP)\n"
+              << "  --model NAME           ASR model\n"
+              << "  --speed FACTOR         Replay speed (default: 1.0 = real time)\n"
+              << "  --vad-frame-ms MS      VAD frame size, 10 or 20 (default: 10)\n"
+              << "  --silence-commit-ms MS Silence before commit (default: 150)\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    fcitx::NativeAsrClient::Options options;
+    fcitx::WavReplaySource::Options source_options;
+
+    static const option long_options[] = {
+        {"url", required_argument, nullptr, 'u'},
+        {"language", required_argument, nullptr, 'l'},
+        {"model", required_argument, nullptr, 'm'},
+        {"speed", required_argument, nullptr, 's'},
+        {"vad-frame-ms", required_argument, nullptr, 'f'},
+        {"silence-commit-ms", required_argument, nullptr, 'c'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, nullptr)) != -1) {
+        switch (opt) {
+        case 'u':
+            options.url = optarg;
+            break;
+        case 'l':
+            options.language = optarg;
+            break;
+        case 'm':
+            options.model = optarg;
+            break;
+        case 's':
+            source_options.speed = std::atof(optarg);
+            break;
+        case 'f':
+            options.frame_ms = std::atoi(optarg);
+            break;
+        case 'c':
+            options.silence_commit_ms = std::atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind + 1 != argc || (options.frame_ms != 10 && options.frame_ms != 20)) {
+        usage(argv[0]);
+        return 2;
+    }
+    source_options.path = argv[optind];
+    source_options.chunk_ms = options.chunk_ms;
+
+    fcitx::EventLoop loop;
+    std::unique_ptr<fcitx::NativeAsrClient> client;
+    int status = 0;
+    try {
+        client = std::make_unique<fcitx::NativeAsrClient>(
+            &loop, options,
+            std::make_unique<fcitx::WavReplaySource>(source_options));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    client->setReadyCallback([]() { std::cout << "ready" << std::endl; });
+    client->setDeltaCallback([](const std::string& text) {
+        std::cout << "delta\t" << text << std::endl;
+    });
+    client->setCompleteCallback([](const std::string& text) {
+        std::cout << "completed\t" << text << std::endl;
+    });
+    client->setErrorCallback([&loop, &status](const std::string& message) {
+        std::cout << "error\t" << message << std::endl;
+        status = 1;
+        loop.exit();
+    });
+    client->setFinishedCallback([&loop]() { loop.exit(); });
+
+    try {
+        client->start();
+    } catch (const std::exception& e) {
+        std::cout << "error\t" << e.what() << std::endl;
+        return 1;
+    }
+
+    loop.exec();
+    return status;
+}
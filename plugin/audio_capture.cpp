@@ -0,0 +1,141 @@
+#include "audio_capture.h"
+#include <alsa/asoundlib.h>
+#include <fcitx-utils/log.h>
+#include <cerrno>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace fcitx {
+
+AudioCapture::AudioCapture(Options options)
+    : options_(std::move(options)),
+      chunk_samples_(options_.sample_rate * options_.chunk_ms / 1000),
+      period_samples_(options_.sample_rate * options_.period_ms / 1000),
+      ring_(options_.sample_rate * options_.buffer_ms / 1000),
+      overflow_(period_samples_) {
+    if (chunk_samples_ == 0 || period_samples_ == 0 ||
+        ring_.capacity() < chunk_samples_ * 2) {
+        throw std::runtime_error("Invalid audio capture options");
+    }
+
+    event_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (event_fd_ < 0) {
+        throw std::runtime_error("Failed to create capture eventfd");
+    }
+}
+
+AudioCapture::~AudioCapture() {
+    stop();
+    if (pcm_) {
+        snd_pcm_close(pcm_);
+    }
+    close(event_fd_);
+}
+
+void AudioCapture::open() {
+    int err = snd_pcm_open(&pcm_, options_.device.c_str(),
+                           SND_PCM_STREAM_CAPTURE, 0);
+    if (err < 0) {
+        pcm_ = nullptr;
+        throw std::runtime_error("Failed to open capture device " +
+                                 options_.device + ": " + snd_strerror(err));
+    }
+
+    // Let ALSA resample; keep a few periods of device-side latency
+    err = snd_pcm_set_params(pcm_, SND_PCM_FORMAT_S16_LE,
+                             SND_PCM_ACCESS_RW_INTERLEAVED, 1,
+                             options_.sample_rate, 1,
+                             options_.period_ms * 4000);
+    if (err < 0) {
+        snd_pcm_close(pcm_);
+        pcm_ = nullptr;
+        throw std::runtime_error(std::string("Failed to configure capture: ") +
+                                 snd_strerror(err));
+    }
+
+    FCITX_INFO() << "Audio capture opened: " << options_.device << " "
+                 << options_.sample_rate << "Hz, " << options_.chunk_ms
+                 << "ms chunks";
+}
+
+void AudioCapture::start() {
+    if (running_) {
+        return;
+    }
+    if (thread_.joinable()) {
+        // Capture thread exited on a device error
+        thread_.join();
+    }
+
+    if (!pcm_) {
+        open();
+    } else {
+        snd_pcm_prepare(pcm_);
+    }
+
+    running_ = true;
+    thread_ = std::thread(&AudioCapture::captureLoop, this);
+}
+
+void AudioCapture::stop() {
+    running_ = false;
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    thread_.join();
+    snd_pcm_drop(pcm_);
+    drain();
+}
+
+bool AudioCapture::readChunk(int16_t* out) {
+    return ring_.pop(out, chunk_samples_);
+}
+
+void AudioCapture::drain() {
+    ring_.discard(ring_.readable());
+    uint64_t count;
+    while (read(event_fd_, &count, sizeof(count)) > 0) {
+    }
+}
+
+void AudioCapture::captureLoop() {
+    // Each read blocks for at most one period, so stop() is noticed quickly
+    while (running_.load(std::memory_order_relaxed)) {
+        auto span = ring_.writableSpan();
+        bool full = span.empty();
+        int16_t* target = full ? overflow_.data() : span.data();
+        size_t frames = full ? period_samples_
+                             : std::min(span.size(), period_samples_);
+
+        snd_pcm_sframes_t n = snd_pcm_readi(pcm_, target, frames);
+        if (n < 0) {
+            if (n == -EPIPE) {
+                dropped_ += period_samples_;
+            }
+            int err = snd_pcm_recover(pcm_, static_cast<int>(n), 1);
+            if (err < 0) {
+                FCITX_ERROR() << "Audio capture failed: " << snd_strerror(err);
+                running_ = false;
+                break;
+            }
+            continue;
+        }
+
+        if (full) {
+            dropped_ += n;
+            continue;
+        }
+
+        ring_.commitWrite(n);
+        uint64_t before = written_;
+        written_ += n;
+        if (written_ / chunk_samples_ != before / chunk_samples_) {
+            uint64_t one = 1;
+            [[maybe_unused]] auto ret = write(event_fd_, &one, sizeof(one));
+        }
+    }
+}
+
+} // namespace fcitx
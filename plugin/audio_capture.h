@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "audio_source.h"
+#include "spsc_ring.h"
+
+typedef struct _snd_pcm snd_pcm_t;
+
+namespace fcitx {
+
+/**
+ * Native microphone capture (PCM16, mono) through ALSA.
+ *
+ * On PipeWire/PulseAudio desktops the "default" ALSA device is routed
+ * through the sound server. The device is opened once on the first
+ * start() and kept open across sessions. A capture thread reads one
+ * period at a time straight into a preallocated lock-free ring; the
+ * consumer takes fixed-size chunks out of it.
+ */
+class AudioCapture final : public AudioSource {
+public:
+    struct Options {
+        std::string device = "default";
+        unsigned sample_rate = 16000;
+        unsigned chunk_ms = 20;     // Chunk size handed to the consumer (10/20/100)
+        unsigned period_ms = 10;    // ALSA read granularity
+        unsigned buffer_ms = 2000;  // Ring capacity
+    };
+
+    explicit AudioCapture(Options options);
+    ~AudioCapture() override;
+
+    AudioCapture(const AudioCapture&) = delete;
+    AudioCapture& operator=(const AudioCapture&) = delete;
+
+    /**
+     * Start capturing. Opens the device on first use.
+     * @throws std::runtime_error if the device cannot be opened
+     */
+    void start() override;
+
+    /**
+     * Stop capturing and discard queued audio. The device stays open.
+     */
+    void stop() override;
+
+    /**
+     * Copy the oldest complete chunk into out (chunkSamples() samples).
+     * Non-blocking.
+     * @return false if no complete chunk is queued
+     */
+    bool readChunk(int16_t* out) override;
+
+    /**
+     * Discard all queued audio (e.g. after a reconnect gap).
+     */
+    void drain() override;
+
+    /**
+     * eventfd that becomes readable when at least one chunk is queued.
+     * The consumer should read() it to reset the counter before draining.
+     */
+    int eventFd() const override { return event_fd_; }
+
+    size_t chunkSamples() const override { return chunk_samples_; }
+    unsigned sampleRate() const override { return options_.sample_rate; }
+    bool isRunning() const { return running_.load(std::memory_order_relaxed); }
+
+    /** Samples lost because the consumer fell behind or ALSA overran. */
+    uint64_t droppedSamples() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+private:
+    void open();
+    void captureLoop();
+
+    Options options_;
+    size_t chunk_samples_;
+    size_t period_samples_;
+    SpscRing<int16_t> ring_;
+    std::vector<int16_t> overflow_;  // Read target when the ring is full
+    uint64_t written_ = 0;           // Capture thread only
+    snd_pcm_t* pcm_ = nullptr;
+    int event_fd_ = -1;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> dropped_{0};
+};
+
+} // namespace fcitx
@@ -0,0 +1,226 @@
+#include "audio_energy.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VOICE_ENERGY_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define VOICE_ENERGY_NEON 1
+#endif
+
+namespace fcitx {
+
+double EnergyStats::rms() const {
+    if (samples == 0) {
+        return 0.0;
+    }
+    return std::sqrt(static_cast<double>(sum_squares) / samples);
+}
+
+void EnergyStats::merge(const EnergyStats& next, bool crossing_at_boundary) {
+    sum_squares += next.sum_squares;
+    peak = std::max(peak, next.peak);
+    zero_crossings += next.zero_crossings + (crossing_at_boundary ? 1 : 0);
+    samples += next.samples;
+}
+
+namespace {
+
+// Accumulate samples [begin, n) and the crossings between them. The
+// vector loops stop one lane short so the pair (begin - 1, begin) has
+// already been counted.
+void accumulateTail(const int16_t* s, size_t begin, size_t n,
+                    EnergyStats& stats, int& max_value, int& min_value) {
+    for (size_t i = begin; i < n; ++i) {
+        int v = s[i];
+        stats.sum_squares += static_cast<int64_t>(v) * v;
+        max_value = std::max(max_value, v);
+        min_value = std::min(min_value, v);
+        if (i + 1 < n && (v ^ s[i + 1]) < 0) {
+            ++stats.zero_crossings;
+        }
+    }
+}
+
+EnergyStats finish(EnergyStats stats, size_t n, int max_value, int min_value) {
+    stats.samples = n;
+    stats.peak = n ? std::max(max_value, -min_value) : 0;
+    return stats;
+}
+
+#ifdef VOICE_ENERGY_X86
+
+__attribute__((target("avx2")))
+EnergyStats computeEnergyAvx2(const int16_t* s, size_t n) {
+    EnergyStats stats;
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = zero;
+    __m256i vmax = _mm256_set1_epi16(INT16_MIN);
+    __m256i vmin = _mm256_set1_epi16(INT16_MAX);
+
+    size_t i = 0;
+    for (; i + 16 < n; i += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+        __m256i w =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + 1));
+
+        // Pairwise sums of squares fit in u32 (max 2^31); widen to u64
+        __m256i sq = _mm256_madd_epi16(v, v);
+        acc = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(sq, zero));
+        acc = _mm256_add_epi64(acc, _mm256_unpackhi_epi32(sq, zero));
+
+        vmax = _mm256_max_epi16(vmax, v);
+        vmin = _mm256_min_epi16(vmin, v);
+
+        // Sign bit of each 16-bit lane is the top bit of its high byte
+        auto mask = static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_xor_si256(v, w)));
+        stats.zero_crossings += std::popcount(mask & 0xAAAAAAAAu);
+    }
+
+    alignas(32) uint64_t sums[4];
+    alignas(32) int16_t maxs[16];
+    alignas(32) int16_t mins[16];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(sums), acc);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(maxs), vmax);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(mins), vmin);
+    stats.sum_squares = sums[0] + sums[1] + sums[2] + sums[3];
+    int max_value = *std::max_element(maxs, maxs + 16);
+    int min_value = *std::min_element(mins, mins + 16);
+
+    accumulateTail(s, i, n, stats, max_value, min_value);
+    return finish(stats, n, max_value, min_value);
+}
+
+__attribute__((target("sse2")))
+EnergyStats computeEnergySse2(const int16_t* s, size_t n) {
+    EnergyStats stats;
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    __m128i vmax = _mm_set1_epi16(INT16_MIN);
+    __m128i vmin = _mm_set1_epi16(INT16_MAX);
+
+    size_t i = 0;
+    for (; i + 8 < n; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        __m128i w =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 1));
+
+        __m128i sq = _mm_madd_epi16(v, v);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(sq, zero));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(sq, zero));
+
+        vmax = _mm_max_epi16(vmax, v);
+        vmin = _mm_min_epi16(vmin, v);
+
+        auto mask = static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_xor_si128(v, w)));
+        stats.zero_crossings += std::popcount(mask & 0xAAAAu);
+    }
+
+    alignas(16) uint64_t sums[2];
+    alignas(16) int16_t maxs[8];
+    alignas(16) int16_t mins[8];
+    _mm_store_si128(reinterpret_cast<__m128i*>(sums), acc);
+    _mm_store_si128(reinterpret_cast<__m128i*>(maxs), vmax);
+    _mm_store_si128(reinterpret_cast<__m128i*>(mins), vmin);
+    stats.sum_squares = sums[0] + sums[1];
+    int max_value = *std::max_element(maxs, maxs + 8);
+    int min_value = *std::min_element(mins, mins + 8);
+
+    accumulateTail(s, i, n, stats, max_value, min_value);
+    return finish(stats, n, max_value, min_value);
+}
+
+#endif // VOICE_ENERGY_X86
+
+#ifdef VOICE_ENERGY_NEON
+
+EnergyStats computeEnergyNeon(const int16_t* s, size_t n) {
+    EnergyStats stats;
+    int64x2_t acc = vdupq_n_s64(0);
+    uint32x4_t crossings = vdupq_n_u32(0);
+    int16x8_t vmax = vdupq_n_s16(INT16_MIN);
+    int16x8_t vmin = vdupq_n_s16(INT16_MAX);
+
+    size_t i = 0;
+    for (; i + 8 < n; i += 8) {
+        int16x8_t v = vld1q_s16(s + i);
+        int16x8_t w = vld1q_s16(s + i + 1);
+
+        // Squares fit in s32 (max 2^30); pairwise-accumulate into s64
+        acc = vpadalq_s32(acc, vmull_s16(vget_low_s16(v), vget_low_s16(v)));
+        acc = vpadalq_s32(acc, vmull_high_s16(v, v));
+
+        vmax = vmaxq_s16(vmax, v);
+        vmin = vminq_s16(vmin, v);
+
+        uint16x8_t sign =
+            vshrq_n_u16(vreinterpretq_u16_s16(veorq_s16(v, w)), 15);
+        crossings = vpadalq_u16(crossings, sign);
+    }
+
+    stats.sum_squares = static_cast<uint64_t>(vaddvq_s64(acc));
+    stats.zero_crossings = vaddvq_u32(crossings);
+    int max_value = vmaxvq_s16(vmax);
+    int min_value = vminvq_s16(vmin);
+
+    accumulateTail(s, i, n, stats, max_value, min_value);
+    return finish(stats, n, max_value, min_value);
+}
+
+#endif // VOICE_ENERGY_NEON
+
+} // namespace
+
+namespace detail {
+
+EnergyStats computeEnergyScalar(const int16_t* s, size_t n) {
+    EnergyStats stats;
+    int max_value = INT16_MIN;
+    int min_value = INT16_MAX;
+    accumulateTail(s, 0, n, stats, max_value, min_value);
+    return finish(stats, n, max_value, min_value);
+}
+
+std::vector<EnergyKernel> energyKernels() {
+    std::vector<EnergyKernel> kernels;
+#ifdef VOICE_ENERGY_X86
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back({computeEnergyAvx2, "avx2"});
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        kernels.push_back({computeEnergySse2, "sse2"});
+    }
+#endif
+#ifdef VOICE_ENERGY_NEON
+    kernels.push_back({computeEnergyNeon, "neon"});
+#endif
+    kernels.push_back({computeEnergyScalar, "scalar"});
+    return kernels;
+}
+
+} // namespace detail
+
+namespace {
+
+const detail::EnergyKernel& kernel() {
+    static const detail::EnergyKernel selected =
+        detail::energyKernels().front();
+    return selected;
+}
+
+} // namespace
+
+EnergyStats computeEnergy(const int16_t* samples, size_t n) {
+    return kernel().fn(samples, n);
+}
+
+const char* energyKernelName() {
+    return kernel().name;
+}
+
+} // namespace fcitx
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fcitx {
+
+/**
+ * Energy statistics of a PCM16 buffer.
+ */
+struct EnergyStats {
+    uint64_t sum_squares = 0;   // Sum of squared samples
+    int peak = 0;               // Absolute peak (0..32768)
+    size_t zero_crossings = 0;  // Sign changes between adjacent samples
+    size_t samples = 0;
+
+    double rms() const;
+
+    /** Fold in the stats of a buffer that directly follows this one. */
+    void merge(const EnergyStats& next, bool crossing_at_boundary);
+};
+
+/**
+ * Compute energy, peak and zero crossings of PCM16 samples.
+ * Uses the widest SIMD kernel the CPU supports (AVX2/SSE2 on x86-64,
+ * NEON on AArch64) with a scalar fallback.
+ */
+EnergyStats computeEnergy(const int16_t* samples, size_t n);
+
+/**
+ * Name of the kernel selected for this CPU ("avx2", "sse2", "neon", "scalar").
+ */
+const char* energyKernelName();
+
+namespace detail {
+EnergyStats computeEnergyScalar(const int16_t* samples, size_t n);
+
+struct EnergyKernel {
+    EnergyStats (*fn)(const int16_t*, size_t);
+    const char* name;
+};
+
+/** Kernels this CPU can run, widest first and the scalar one last. */
+std::vector<EnergyKernel> energyKernels();
+} // namespace detail
+
+} // namespace fcitx
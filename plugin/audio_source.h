@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fcitx {
+
+/**
+ * Source of fixed-size PCM16 mono chunks for the native ASR transport
+ * (the counterpart of the daemon's recorder.AudioSource).
+ *
+ * eventFd() becomes readable when at least one chunk is queued; the
+ * consumer read()s it to reset the counter, then calls readChunk()
+ * until it returns false.
+ */
+class AudioSource {
+public:
+    virtual ~AudioSource() = default;
+
+    /** @throws std::runtime_error if the source cannot be started */
+    virtual void start() = 0;
+    virtual void stop() = 0;
+
+    /** Copy the oldest complete chunk into out. Non-blocking. */
+    virtual bool readChunk(int16_t* out) = 0;
+
+    /** Discard all queued audio. */
+    virtual void drain() = 0;
+
+    virtual int eventFd() const = 0;
+    virtual size_t chunkSamples() const = 0;
+    virtual unsigned sampleRate() const = 0;
+
+    /** True once a finite source has delivered all of its audio. */
+    virtual bool exhausted() const { return false; }
+};
+
+} // namespace fcitx
@@ -0,0 +1,204 @@
+#include "base64.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VOICE_BASE64_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define VOICE_BASE64_NEON 1
+#endif
+
+namespace fcitx {
+
+namespace {
+
+constexpr char ALPHABET[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+#ifdef VOICE_BASE64_X86
+
+// The x86 kernels follow Muła and Lemire, "Faster Base64 Encoding and
+// Decoding Using AVX2 Instructions": a byte shuffle spreads each 3-byte
+// group over a 32-bit lane, two multiplies move the four 6-bit fields
+// into separate bytes, and a 16-entry shuffle table turns each field into
+// the offset that maps it onto its alphabet range.
+
+// Per range: A-Z +65, a-z +71, 0-9 -4, '+' -19, '/' -16
+#define VOICE_BASE64_OFFSETS \
+    65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0
+
+__attribute__((target("ssse3")))
+__m128i splitSsse3(__m128i in) {
+    // Bytes a b c -> b a c b in each 32-bit lane
+    in = _mm_shuffle_epi8(
+        in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00));
+    __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003F03F0));
+    __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+__attribute__((target("ssse3")))
+__m128i translateSsse3(__m128i in) {
+    const __m128i offsets = _mm_setr_epi8(VOICE_BASE64_OFFSETS);
+    // 0 for A-Z, 1 for a-z, 2..13 for the rest
+    __m128i index = _mm_subs_epu8(in, _mm_set1_epi8(51));
+    index = _mm_sub_epi8(index, _mm_cmpgt_epi8(in, _mm_set1_epi8(25)));
+    return _mm_add_epi8(in, _mm_shuffle_epi8(offsets, index));
+}
+
+__attribute__((target("ssse3")))
+void encodeSsse3(const uint8_t* data, size_t n, char* out) {
+    size_t i = 0;
+    // Each step consumes 12 bytes but loads 16
+    for (; i + 16 <= n; i += 12) {
+        __m128i in =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                         translateSsse3(splitSsse3(in)));
+        out += 16;
+    }
+    detail::base64EncodeScalar(data + i, n - i, out);
+}
+
+__attribute__((target("avx2")))
+void encodeAvx2(const uint8_t* data, size_t n, char* out) {
+    const __m256i shuffle = _mm256_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i offsets = _mm256_setr_epi8(VOICE_BASE64_OFFSETS,
+                                             VOICE_BASE64_OFFSETS);
+
+    size_t i = 0;
+    // Each step consumes 24 bytes (12 per 128-bit lane) but loads 28
+    for (; i + 28 <= n; i += 24) {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i hi =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 12));
+        __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+        in = _mm256_shuffle_epi8(in, shuffle);
+        __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00));
+        __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0));
+        __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        __m256i v = _mm256_or_si256(t1, t3);
+
+        __m256i index = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+        index = _mm256_sub_epi8(index,
+                                _mm256_cmpgt_epi8(v, _mm256_set1_epi8(25)));
+        v = _mm256_add_epi8(v, _mm256_shuffle_epi8(offsets, index));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), v);
+        out += 32;
+    }
+    encodeSsse3(data + i, n - i, out);
+}
+
+#undef VOICE_BASE64_OFFSETS
+
+#endif // VOICE_BASE64_X86
+
+#ifdef VOICE_BASE64_NEON
+
+void encodeNeon(const uint8_t* data, size_t n, char* out) {
+    const uint8x16x4_t table = vld1q_u8_x4(
+        reinterpret_cast<const uint8_t*>(ALPHABET));
+    const uint8x16_t mask = vdupq_n_u8(0x3F);
+
+    size_t i = 0;
+    for (; i + 48 <= n; i += 48) {
+        // De-interleave 16 groups of 3 bytes, then split into 4 fields
+        uint8x16x3_t in = vld3q_u8(data + i);
+        uint8x16x4_t fields;
+        fields.val[0] = vshrq_n_u8(in.val[0], 2);
+        fields.val[1] = vandq_u8(
+            vorrq_u8(vshrq_n_u8(in.val[1], 4), vshlq_n_u8(in.val[0], 4)),
+            mask);
+        fields.val[2] = vandq_u8(
+            vorrq_u8(vshrq_n_u8(in.val[2], 6), vshlq_n_u8(in.val[1], 2)),
+            mask);
+        fields.val[3] = vandq_u8(in.val[2], mask);
+
+        for (auto& field : fields.val) {
+            field = vqtbl4q_u8(table, field);
+        }
+        vst4q_u8(reinterpret_cast<uint8_t*>(out), fields);
+        out += 64;
+    }
+    detail::base64EncodeScalar(data + i, n - i, out);
+}
+
+#endif // VOICE_BASE64_NEON
+
+} // namespace
+
+namespace detail {
+
+void base64EncodeScalar(const uint8_t* data, size_t n, char* out) {
+    size_t i = 0;
+    for (; i + 3 <= n; i += 3) {
+        uint32_t v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        *out++ = ALPHABET[(v >> 18) & 0x3F];
+        *out++ = ALPHABET[(v >> 12) & 0x3F];
+        *out++ = ALPHABET[(v >> 6) & 0x3F];
+        *out++ = ALPHABET[v & 0x3F];
+    }
+
+    if (i < n) {
+        uint32_t v = data[i] << 16;
+        if (i + 1 < n) {
+            v |= data[i + 1] << 8;
+        }
+        *out++ = ALPHABET[(v >> 18) & 0x3F];
+        *out++ = ALPHABET[(v >> 12) & 0x3F];
+        *out++ = i + 1 < n ? ALPHABET[(v >> 6) & 0x3F] : '=';
+        *out++ = '=';
+    }
+}
+
+std::vector<Base64Kernel> base64Kernels() {
+    std::vector<Base64Kernel> kernels;
+#ifdef VOICE_BASE64_X86
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back({encodeAvx2, "avx2"});
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        kernels.push_back({encodeSsse3, "ssse3"});
+    }
+#endif
+#ifdef VOICE_BASE64_NEON
+    kernels.push_back({encodeNeon, "neon"});
+#endif
+    kernels.push_back({base64EncodeScalar, "scalar"});
+    return kernels;
+}
+
+} // namespace detail
+
+namespace {
+
+const detail::Base64Kernel& kernel() {
+    static const detail::Base64Kernel selected =
+        detail::base64Kernels().front();
+    return selected;
+}
+
+} // namespace
+
+void base64Encode(const uint8_t* data, size_t n, char* out) {
+    kernel().fn(data, n, out);
+}
+
+void base64Append(const uint8_t* data, size_t n, std::string& out) {
+    size_t pos = out.size();
+    out.resize(pos + base64EncodedSize(n));
+    base64Encode(data, n, out.data() + pos);
+}
+
+const char* base64KernelName() {
+    return kernel().name;
+}
+
+} // namespace fcitx
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fcitx {
+
+/** Length of the padded base64 encoding of n bytes. */
+constexpr size_t base64EncodedSize(size_t n) { return (n + 2) / 3 * 4; }
+
+/**
+ * Write the padded base64 (RFC 4648) encoding of data to out, which must
+ * have room for base64EncodedSize(n) chars. No terminator is written.
+ * Uses the widest SIMD kernel the CPU supports (AVX2/SSSE3 on x86-64,
+ * NEON on AArch64) with a scalar fallback.
+ */
+void base64Encode(const uint8_t* data, size_t n, char* out);
+
+/**
+ * Append the padded base64 encoding of data to out.
+ */
+void base64Append(const uint8_t* data, size_t n, std::string& out);
+
+/**
+ * Name of the kernel selected for this CPU ("avx2", "ssse3", "neon", "scalar").
+ */
+const char* base64KernelName();
+
+namespace detail {
+void base64EncodeScalar(const uint8_t* data, size_t n, char* out);
+
+struct Base64Kernel {
+    void (*fn)(const uint8_t*, size_t, char*);
+    const char* name;
+};
+
+/** Kernels this CPU can run, widest first and the scalar one last. */
+std::vector<Base64Kernel> base64Kernels();
+} // namespace detail
+
+} // namespace fcitx
@@ -0,0 +1,213 @@
+// fcitx5-voice-dbus-bench: the plugin's D-Bus receive path, headless.
+//
+// Connects a DBusClient to fcitx5-voice-daemon on the session bus (run
+// the daemon with --trace, usually on a private bus started by
+// tools/bench_latency.py), starts recording and prints one line per
+// signal to stdout, stamped when DBusClient dispatched it:
+//
+//   ready
+//   delta<TAB>receive_us<TAB>capture_us<TAB>send_us<TAB>server_us<TAB>emit_us<TAB>text
+//   completed<TAB>receive_us<TAB>capture_us<TAB>send_us<TAB>server_us<TAB>emit_us<TAB>text
+//   error<TAB>message
+//   dispatch<TAB>count<TAB>mean_us<TAB>p50_us<TAB>p99_us<TAB>max_us
+//
+// Stamps other than receive_us are 0 when the daemon runs without
+// --trace. Exits once no signal has arrived for --idle-ms after the
+// first one (the daemon's WAV replay has ended), 0 on success.
+//
+// With --peer the client first calls Prewarm, waits until it has moved
+// to the daemon's direct connection (printing "peer") and only then
+// starts recording, so every signal skips the bus daemon. --channel
+// does the same with the daemon's binary event channel (printing
+// "channel"), so no event is a D-Bus message at all.
+
+#include <fcitx-utils/event.h>
+#include <getopt.h>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "dbus_client.h"
+#include "stats.h"
+
+namespace {
+
+void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [options]\n"
+              << "\n"
+              << "  --idle-ms MS     Exit after MS without a signal (default: 2000)\n"
+              << "  --timeout-ms MS  Give up after MS in total (default: 120000)\n"
+              << "  --peer           Record over the daemon's direct connection\n"
+              << "  --channel        Record over the daemon's event channel\n";
+}
+
+void printEvent(const char* kind, const std::string& text,
+                const fcitx::TraceStamps* trace) {
+    fcitx::TraceStamps stamps;
+    if (trace) {
+        stamps = *trace;
+    } else {
+        stamps.receive_us = fcitx::now(CLOCK_MONOTONIC);
+    }
+    std::cout << kind << '\t' << stamps.receive_us << '\t' << stamps.capture_us
+              << '\t' << stamps.send_us << '\t' << stamps.server_us << '\t'
+              << stamps.emit_us << '\t' << text << '\n';
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    uint64_t idle_us = 2000000;
+    uint64_t timeout_us = 120000000;
+    bool peer = false;
+    bool channel = false;
+
+    static const option long_options[] = {
+        {"idle-ms", required_argument, nullptr, 'i'},
+        {"timeout-ms", required_argument, nullptr, 't'},
+        {"peer", no_argument, nullptr, 'p'},
+        {"channel", no_argument, nullptr, 'c'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, nullptr)) != -1) {
+        switch (opt) {
+        case 'i':
+            idle_us = std::strtoull(optarg, nullptr, 10) * 1000;
+            break;
+        case 't':
+            timeout_us = std::strtoull(optarg, nullptr, 10) * 1000;
+            break;
+        case 'p':
+            peer = true;
+            break;
+        case 'c':
+            channel = true;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind != argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    fcitx::EventLoop loop;
+    fcitx::StatsRegistry stats;
+    std::unique_ptr<fcitx::DBusClient> client;
+    try {
+        client = std::make_unique<fcitx::DBusClient>(&loop);
+    } catch (const std::exception& e) {
+        std::cout << "error\t" << e.what() << std::endl;
+        return 1;
+    }
+    client->exportStats(&stats);
+
+    int status = 0;
+    uint64_t start = fcitx::now(CLOCK_MONOTONIC);
+    uint64_t last_event = 0;
+    client->setTranscriptionDeltaCallback(
+        [&last_event](const std::string& text, const fcitx::TraceStamps* trace) {
+            printEvent("delta", text, trace);
+            last_event = fcitx::now(CLOCK_MONOTONIC);
+        });
+    client->setTranscriptionCallback([&last_event](const std::string& text, int,
+                                                   const fcitx::TraceStamps* trace) {
+        printEvent("completed", text, trace);
+        last_event = fcitx::now(CLOCK_MONOTONIC);
+    });
+    client->setErrorCallback([&loop, &status](const std::string& message) {
+        std::cout << "error\t" << message << std::endl;
+        status = 1;
+        loop.exit();
+    });
+
+    // Also reported when the session bus connection drops
+    client->setDaemonCallback([&](bool running) {
+        if (!running) {
+            std::cout << "error\tvoice daemon exited" << std::endl;
+            status = 1;
+            loop.exit();
+        }
+    });
+
+    auto start_recording = [&]() {
+        client->startRecording([&loop, &status](bool ok, const std::string& error) {
+            if (!ok) {
+                std::cout << "error\t" << error << std::endl;
+                status = 1;
+                loop.exit();
+                return;
+            }
+            std::cout << "ready" << std::endl;
+        });
+    };
+
+    // Waits for the peer connection or event channel to attach, then
+    // starts recording
+    bool upgrading = peer || channel;
+    auto ticker = loop.addTimeEvent(
+        CLOCK_MONOTONIC, start + 100000, 0,
+        [&](fcitx::EventSourceTime* source, uint64_t time) {
+            if (upgrading &&
+                (channel ? client->transport() ==
+                               fcitx::DBusClient::Transport::Channel
+                         : client->hasPeer())) {
+                upgrading = false;
+                std::cout << (channel ? "channel" : "peer") << std::endl;
+                try {
+                    start_recording();
+                } catch (const std::exception& e) {
+                    std::cout << "error\t" << e.what() << std::endl;
+                    status = 1;
+                    loop.exit();
+                    return true;
+                }
+            }
+            if ((last_event && time - last_event >= idle_us) ||
+                time - start >= timeout_us) {
+                if (!last_event) {
+                    std::cout << "error\tno signal received" << std::endl;
+                    status = 1;
+                }
+                loop.exit();
+                return true;
+            }
+            source->setTime(time + 100000);
+            source->setOneShot();
+            return true;
+        });
+
+    client->enableEventChannel(channel);
+    client->enablePeer(peer);
+
+    try {
+        if (peer || channel) {
+            client->prewarm([&loop, &status](bool ok, const std::string& error) {
+                if (!ok) {
+                    std::cout << "error\t" << error << std::endl;
+                    status = 1;
+                    loop.exit();
+                }
+            });
+        } else {
+            start_recording();
+        }
+    } catch (const std::exception& e) {
+        std::cout << "error\t" << e.what() << std::endl;
+        return 1;
+    }
+
+    loop.exec();
+
+    const auto& dispatch = stats.histogram(fcitx::StatsRegistry::DBusDispatch);
+    std::cout << "dispatch\t" << dispatch.count() << '\t' << dispatch.mean()
+              << '\t' << dispatch.percentile(0.5) << '\t'
+              << dispatch.percentile(0.99) << '\t' << dispatch.max()
+              << std::endl;
+    return status;
+}
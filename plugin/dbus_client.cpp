@@ -1,15 +1,116 @@
 #include "dbus_client.h"
+#include <fcitx-module/dbus/dbus_public.h>
+#include <fcitx-utils/dbus/message.h>
+#include <fcitx-utils/dbus/objectvtable.h>
+#include <fcitx-utils/event.h>
 #include <fcitx-utils/log.h>
+#include <fcitx/addonmanager.h>
+#include <fcitx/instance.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iterator>
+#include <tuple>
+#include <utility>
 #include <stdexcept>
-#include <cstring>
+#include <vector>
 
 namespace fcitx {
 
 static const char* DBUS_SERVICE = "org.fcitx.Fcitx5.Voice";
 static const char* DBUS_PATH = "/org/fcitx/Fcitx5/Voice";
 static const char* DBUS_INTERFACE = "org.fcitx.Fcitx5.Voice";
+static const char* DBUS_CHANNELS_INTERFACE = "org.fcitx.Fcitx5.Voice.Channels";
+static const char* DBUS_PEER_INTERFACE = "org.fcitx.Fcitx5.Voice.Peer";
+static const char* STATS_SERVICE = "org.fcitx.Fcitx5.Voice.Plugin";
+static const char* STATS_PATH = "/org/fcitx/Fcitx5/Voice/Stats";
+static const char* STATS_INTERFACE = "org.fcitx.Fcitx5.Voice.Stats";
+static const char* LOCAL_PATH = "/org/freedesktop/DBus/Local";
+static const char* LOCAL_INTERFACE = "org.freedesktop.DBus.Local";
+static const char* BUS_DAEMON_SERVICE = "org.freedesktop.DBus";
+static const char* NO_REPLY_ERROR = "org.freedesktop.DBus.Error.NoReply";
+static const int DBUS_CALL_TIMEOUT_MS = 1000;
+// Calls that may start the daemon through D-Bus activation
+static const int DBUS_ACTIVATION_TIMEOUT_MS = 10000;
+// Backoff between attempts to reopen a lost session bus connection
+static const uint64_t RECONNECT_MIN_US = 100000;
+static const uint64_t RECONNECT_MAX_US = 5000000;
+
+/** org.fcitx.Fcitx5.Voice.Stats, served from a StatsRegistry. */
+class StatsService : public dbus::ObjectVTable<StatsService> {
+public:
+    using Counters = std::vector<dbus::DictEntry<std::string, uint64_t>>;
+    // (name, count, mean, p50, p90, p99, p99.9, max)
+    using Histograms = std::vector<
+        dbus::DBusStruct<std::string, uint64_t, uint64_t, uint64_t, uint64_t,
+                         uint64_t, uint64_t, uint64_t>>;
+
+    explicit StatsService(StatsRegistry* stats) : stats_(stats) {}
+
+    std::tuple<Counters, Histograms> getStats() {
+        Counters counters;
+        for (int i = 0; i < StatsRegistry::COUNTER_COUNT; ++i) {
+            auto counter = static_cast<StatsRegistry::Counter>(i);
+            counters.emplace_back(StatsRegistry::name(counter),
+                                  stats_->counter(counter));
+        }
+        Histograms histograms;
+        for (int i = 0; i < StatsRegistry::HISTOGRAM_COUNT; ++i) {
+            auto id = static_cast<StatsRegistry::Histogram>(i);
+            const auto& h = stats_->histogram(id);
+            histograms.emplace_back(
+                StatsRegistry::name(id), h.count(), h.mean(),
+                h.percentile(0.5), h.percentile(0.9), h.percentile(0.99),
+                h.percentile(0.999), h.max());
+        }
+        return {std::move(counters), std::move(histograms)};
+    }
+
+    void reset() { stats_->reset(); }
+
+private:
+    StatsRegistry* stats_;
+    FCITX_OBJECT_VTABLE_METHOD(getStats, "GetStats", "", "a{st}a(sttttttt)");
+    FCITX_OBJECT_VTABLE_METHOD(reset, "Reset", "", "");
+};
+
+/** Reads signal arguments from a bus message. */
+class MessageArgReader : public DBusArgReader {
+public:
+    explicit MessageArgReader(dbus::Message& msg) : msg_(msg) {}
+
+    bool read(std::string& value) override {
+        return static_cast<bool>(msg_ >> value);
+    }
+    bool read(int32_t& value) override {
+        return static_cast<bool>(msg_ >> value);
+    }
+    bool read(uint64_t& value) override {
+        return static_cast<bool>(msg_ >> value);
+    }
+
+private:
+    dbus::Message& msg_;
+};
+
+// fcitx's session bus connection, or nullptr without the dbus addon
+// (fcitx5-voice-engine-bench)
+static dbus::Bus* fcitxBus(Instance* instance) {
+    auto* dbus = instance->addonManager().addon("dbus", true);
+    return dbus ? dbus->call<IDBusModule::bus>() : nullptr;
+}
+
+DBusClient::DBusClient(EventLoop* loop) : DBusClient(loop, nullptr) {}
+
+DBusClient::DBusClient(Instance* instance)
+    : DBusClient(&instance->eventLoop(), fcitxBus(instance)) {}
 
-DBusClient::DBusClient() {
+DBusClient::DBusClient(EventLoop* loop, dbus::Bus* bus)
+    : loop_(loop), bus_(bus) {
+    dispatch_event_ = loop_->addDeferEvent([this](EventSource*) {
+        processEvents();
+        return true;
+    });
+    dispatch_event_->setEnabled(false);
     connect();
 }
 
@@ -18,98 +119,226 @@ DBusClient::~DBusClient() {
 }
 
 void DBusClient::connect() {
-    DBusError error;
-    dbus_error_init(&error);
-
-    // Connect to session bus
-    conn_ = dbus_bus_get(DBUS_BUS_SESSION, &error);
-    if (dbus_error_is_set(&error)) {
-        std::string msg = "Failed to connect to D-Bus: ";
-        msg += error.message;
-        dbus_error_free(&error);
-        throw std::runtime_error(msg);
+    if (!bus_) {
+        // Not given fcitx's connection (the benches): open one whose
+        // loss is ours to handle
+        own_bus_ = std::make_unique<dbus::Bus>(dbus::BusType::Session);
+        own_bus_->attachEventLoop(loop_);
+        bus_ = own_bus_.get();
+        // Synthesized by libdbus, so it has no sender to match
+        disconnect_slot_ = bus_->addMatch(
+            dbus::MatchRule("", LOCAL_PATH, LOCAL_INTERFACE, "Disconnected"),
+            [this](dbus::Message&) {
+                // The bus goes away with the next pass, outside its dispatch
+                bus_lost_ = true;
+                scheduleDispatch();
+                return true;
+            });
     }
 
-    if (!conn_) {
-        throw std::runtime_error("D-Bus connection is null");
+    watchSignals();
+    // Also reports the daemon already running, once the bus answers
+    service_watch_ = std::make_unique<dbus::ServiceWatch>(*bus_);
+    daemon_watch_ = service_watch_->watchService(
+        DBUS_SERVICE, [this](const std::string&, const std::string& old_owner,
+                             const std::string& new_owner) {
+            onNameOwnerChanged(old_owner, new_owner);
+        });
+    if (stats_) {
+        registerStats();
     }
 
-    // Add filter for signals
-    // Note: Don't use sender='org.fcitx.Fcitx5.Voice' because D-Bus matches on unique names (:1.XXX), not well-known names
-    const char* match_rule = "type='signal',interface='org.fcitx.Fcitx5.Voice',path='/org/fcitx/Fcitx5/Voice'";
-    dbus_bus_add_match(conn_, match_rule, &error);
-    if (dbus_error_is_set(&error)) {
-        FCITX_ERROR() << "Failed to add D-Bus match: " << error.message;
-        dbus_error_free(&error);
-    }
-    dbus_connection_flush(conn_);
+    connected_ = true;
+}
 
-    dbus_connection_add_filter(conn_, messageFilter, this, nullptr);
+void DBusClient::watchSignals() {
+    if (signal_slot_) {
+        return;
+    }
+    // Note: Don't match sender='org.fcitx.Fcitx5.Voice'; signals carry the
+    // daemon's unique name (:1.XXX), not the well-known one
+    signal_slot_ = bus_->addMatch(
+        dbus::MatchRule("", DBUS_PATH, DBUS_INTERFACE),
+        [this](dbus::Message& msg) {
+            if (stats_) {
+                stats_->add(StatsRegistry::DBusSignals);
+            }
+            MessageArgReader args(msg);
+            handleSignal(msg.member(), args);
+            // Delivers the held delta once the queued messages are handled
+            scheduleDispatch();
+            return true;
+        });
+}
 
-    connected_ = true;
+void DBusClient::scheduleDispatch() {
+    if (dispatch_event_) {
+        dispatch_event_->setOneShot();
+    }
 }
 
 void DBusClient::disconnect() {
-    if (conn_) {
-        dbus_connection_remove_filter(conn_, messageFilter, this);
-        dbus_connection_unref(conn_);
-        conn_ = nullptr;
+    cancelPendingCalls();
+    closePeer();
+    closeEventChannel();
+    held_delta_.reset();
+    closeConnection();
+    channel_event_.reset();
+    reconnect_timer_.reset();
+    dispatch_event_.reset();
+}
+
+void DBusClient::closeConnection() {
+    connected_ = false;
+    signal_slot_.reset();
+    daemon_watch_.reset();
+    service_watch_.reset();
+    daemon_owner_.clear();
+    if (stats_service_) {
+        if (bus_->isOpen()) {
+            bus_->releaseName(STATS_SERVICE);
+        }
+        stats_service_.reset();
+    }
+    disconnect_slot_.reset();
+    if (own_bus_) {
+        own_bus_.reset();
+        bus_ = nullptr;
     }
+}
+
+void DBusClient::connectionLost() {
+    FCITX_WARN() << "D-Bus connection lost, reconnecting";
+    // Calls from the handlers below fail rather than reach the old bus
     connected_ = false;
+    // A daemon on the old bus is unreachable (and exits with it)
+    closePeer();
+    closeEventChannel();
+    failPendingCalls("D-Bus connection lost");
+    closeConnection();
+    daemon_exited_ = true;
+    daemon_started_ = false;
+    reconnect_delay_ = RECONNECT_MIN_US;
+    scheduleReconnect();
+}
+
+void DBusClient::scheduleReconnect() {
+    uint64_t time = now(CLOCK_MONOTONIC) + reconnect_delay_;
+    if (reconnect_timer_) {
+        reconnect_timer_->setTime(time);
+        reconnect_timer_->setOneShot();
+        return;
+    }
+    reconnect_timer_ = loop_->addTimeEvent(
+        CLOCK_MONOTONIC, time, 0, [this](EventSourceTime*, uint64_t) {
+            reconnect();
+            return true;
+        });
 }
 
-void DBusClient::startRecording() {
+void DBusClient::reconnect() {
+    try {
+        connect();
+    } catch (const std::exception& e) {
+        reconnect_delay_ = std::min(reconnect_delay_ * 2, RECONNECT_MAX_US);
+        FCITX_DEBUG() << e.what() << "; retrying in "
+                      << reconnect_delay_ / 1000 << " ms";
+        scheduleReconnect();
+        return;
+    }
+    FCITX_INFO() << "D-Bus connection restored";
+    // Unique names start over on a new bus
+    upgrade_owner_.clear();
+    if (stats_) {
+        stats_->add(StatsRegistry::BusReconnects);
+    }
+}
+
+void DBusClient::onNameOwnerChanged(const std::string& old_owner,
+                                    const std::string& new_owner) {
+    daemon_owner_ = new_owner;
+    // Reported once the pass has handled the events sent before it
+    if (!old_owner.empty()) {
+        FCITX_INFO() << "Voice daemon " << old_owner << " exited";
+        daemon_exited_ = true;
+        daemon_started_ = false;
+        if (stats_) {
+            stats_->add(StatsRegistry::DaemonExits);
+        }
+    }
+    if (!new_owner.empty()) {
+        FCITX_DEBUG() << "Voice daemon started as " << new_owner;
+        daemon_started_ = true;
+    }
+    scheduleDispatch();
+}
+
+void DBusClient::startRecording(ReplyCallback cb) {
     if (!connected_) {
         throw std::runtime_error("Not connected to D-Bus");
     }
-    callMethod("StartRecording");
+    callMethodAsync(DBUS_INTERFACE, "StartRecording",
+                    DBUS_ACTIVATION_TIMEOUT_MS, replyHandler(std::move(cb)));
 }
 
-void DBusClient::stopRecording() {
+void DBusClient::stopRecording(ReplyCallback cb) {
     if (!connected_) {
         throw std::runtime_error("Not connected to D-Bus");
     }
-    callMethod("StopRecording");
+    callMethodAsync(DBUS_INTERFACE, "StopRecording", DBUS_CALL_TIMEOUT_MS,
+                    replyHandler(std::move(cb)));
 }
 
-std::string DBusClient::getStatus() {
+void DBusClient::prewarm(ReplyCallback cb) {
     if (!connected_) {
         throw std::runtime_error("Not connected to D-Bus");
     }
+    callMethodAsync(DBUS_INTERFACE, "Prewarm", DBUS_ACTIVATION_TIMEOUT_MS,
+                    replyHandler(std::move(cb)));
+}
 
-    DBusMessage* msg = dbus_message_new_method_call(
-        DBUS_SERVICE, DBUS_PATH, DBUS_INTERFACE, "GetStatus");
-    if (!msg) {
-        throw std::runtime_error("Failed to create D-Bus message");
+void DBusClient::openPcmRing(FdCallback cb) {
+    if (!connected_) {
+        throw std::runtime_error("Not connected to D-Bus");
     }
+    callMethodAsync(
+        DBUS_CHANNELS_INTERFACE, "OpenPcmRing", DBUS_CALL_TIMEOUT_MS,
+        [cb = std::move(cb)](Reply* reply, const std::string& error) {
+            int fd = -1;
+            if (!reply) {
+                FCITX_WARN() << "OpenPcmRing failed: " << error;
+            } else if (reply->fd < 0) {
+                FCITX_WARN() << "Failed to parse OpenPcmRing reply";
+            } else {
+                fd = std::exchange(reply->fd, -1);
+            }
+            cb(fd);
+        });
+}
 
-    DBusError error;
-    dbus_error_init(&error);
-
-    DBusMessage* reply = dbus_connection_send_with_reply_and_block(
-        conn_, msg, 1000, &error);
-    dbus_message_unref(msg);
-
-    if (dbus_error_is_set(&error)) {
-        std::string err_msg = "D-Bus call failed: ";
-        err_msg += error.message;
-        dbus_error_free(&error);
-        throw std::runtime_error(err_msg);
+void DBusClient::queryStatus(StatusCallback cb) {
+    if (!connected_) {
+        throw std::runtime_error("Not connected to D-Bus");
     }
-
-    const char* status = nullptr;
-    if (!dbus_message_get_args(reply, &error, DBUS_TYPE_STRING, &status,
-                               DBUS_TYPE_INVALID)) {
-        dbus_message_unref(reply);
-        std::string err_msg = "Failed to parse reply: ";
-        err_msg += error.message;
-        dbus_error_free(&error);
-        throw std::runtime_error(err_msg);
+    auto handler = [cb = std::move(cb)](Reply* reply,
+                                        const std::string& error) {
+        cb(reply ? reply->text : "", error);
+    };
+    if (peer_attached_) {
+        // A peer connection has no activation
+        callPeerAsync(DBUS_INTERFACE, "GetStatus", DBUS_CALL_TIMEOUT_MS,
+                      std::move(handler));
+        return;
     }
-
-    std::string result(status);
-    dbus_message_unref(reply);
-    return result;
+    // Sent to the unique name, which (unlike the service name) never
+    // activates a daemon
+    if (daemon_owner_.empty()) {
+        throw std::runtime_error(
+            "D-Bus call failed: GetStatus (voice daemon not running)");
+    }
+    auto msg = bus_->createMethodCall(daemon_owner_.c_str(), DBUS_PATH,
+                                      DBUS_INTERFACE, "GetStatus");
+    callBusAsync(std::move(msg), DBUS_CALL_TIMEOUT_MS, std::move(handler));
 }
 
 void DBusClient::setTranscriptionCallback(TranscriptionCallback cb) {
@@ -124,126 +353,537 @@ void DBusClient::setErrorCallback(ErrorCallback cb) {
     error_cb_ = std::move(cb);
 }
 
-void DBusClient::processEvents() {
-    if (!conn_) return;
+void DBusClient::setDaemonCallback(DaemonCallback cb) {
+    daemon_cb_ = std::move(cb);
+}
+
+void DBusClient::setLevelCallback(LevelCallback cb) {
+    level_cb_ = std::move(cb);
+}
+
+void DBusClient::enablePeer(bool enable) {
+    peer_enabled_ = enable;
+}
+
+void DBusClient::enableEventChannel(bool enable) {
+    channel_enabled_ = enable;
+}
+
+void DBusClient::exportStats(StatsRegistry* stats) {
+    if (stats_ || !connected_) {
+        return;
+    }
+    stats_ = stats;
+    registerStats();
+}
 
-    // Read any incoming messages (non-blocking)
-    if (!dbus_connection_read_write(conn_, 0)) {
-        FCITX_WARN() << "D-Bus connection lost";
+void DBusClient::registerStats() {
+    auto service = std::make_unique<StatsService>(stats_);
+    if (!bus_->addObjectVTable(STATS_PATH, STATS_INTERFACE, *service)) {
+        FCITX_WARN() << "Failed to register " << STATS_PATH;
         return;
     }
+    stats_service_ = std::move(service);
 
-    // Dispatch all pending messages
-    while (dbus_connection_dispatch(conn_) == DBUS_DISPATCH_DATA_REMAINS) {
-        // Keep dispatching
+    if (!bus_->requestName(STATS_SERVICE, dbus::RequestNameFlag::None)) {
+        // Another fcitx5 instance has it; stats stay reachable by unique name
+        FCITX_WARN() << STATS_SERVICE << " is already owned";
     }
 }
 
-int DBusClient::getFileDescriptor() {
-    if (!conn_) return -1;
+void DBusClient::processEvents() {
+    uint64_t start = stats_ ? now(CLOCK_MONOTONIC) : 0;
+
+    // fcitx has dispatched the bus, whose AttachPeer reply may have just
+    // switched over. Before that the peer only carries the Hello reply.
+    if (peer_) {
+        if (!peer_->dispatch()) {
+            if (peer_attached_) {
+                FCITX_WARN() << "Peer D-Bus connection lost, back to the bus";
+            }
+            closePeer();
+        } else if (peer_failed_) {
+            closePeer();
+        }
+    }
+    if (channel_) {
+        readEventChannel();
+    }
+    flushDelta();
+
+    if (std::exchange(bus_lost_, false)) {
+        connectionLost();
+    }
 
-    int fd = -1;
-    if (!dbus_connection_get_unix_fd(conn_, &fd)) {
-        FCITX_WARN() << "Failed to get D-Bus file descriptor";
-        return -1;
+    if (std::exchange(daemon_exited_, false) && daemon_cb_) {
+        daemon_cb_(false);
+    }
+    if (std::exchange(daemon_started_, false) && daemon_cb_) {
+        daemon_cb_(true);
     }
 
-    return fd;
+    if (stats_) {
+        stats_->record(StatsRegistry::DBusDispatch,
+                       now(CLOCK_MONOTONIC) - start);
+    }
 }
 
-void DBusClient::callMethod(const char* method) {
-    DBusMessage* msg = dbus_message_new_method_call(
-        DBUS_SERVICE, DBUS_PATH, DBUS_INTERFACE, method);
-    if (!msg) {
-        throw std::runtime_error("Failed to create D-Bus message");
+DBusClient::MessageHandler DBusClient::replyHandler(ReplyCallback cb) {
+    return [cb = std::move(cb)](Reply* reply, const std::string& error) {
+        if (cb) {
+            cb(reply != nullptr, error);
+        }
+    };
+}
+
+dbus::Message DBusClient::newBusCall(const char* interface,
+                                     const char* method) const {
+    return bus_->createMethodCall(DBUS_SERVICE, DBUS_PATH, interface, method);
+}
+
+void DBusClient::callMethodAsync(const char* interface, const char* method,
+                                 int timeout_ms, MessageHandler handler) {
+    if (peer_attached_) {
+        callPeerAsync(interface, method, timeout_ms, std::move(handler));
+        return;
     }
+    callBusAsync(newBusCall(interface, method), timeout_ms,
+                 std::move(handler));
+}
 
-    DBusError error;
-    dbus_error_init(&error);
+void DBusClient::callBusAsync(dbus::Message msg, int timeout_ms,
+                              MessageHandler handler) {
+    std::string method = msg.member();
+    if (!connected_) {
+        throw std::runtime_error("D-Bus call failed: " + method +
+                                 " (not connected)");
+    }
+    uint64_t id = next_call_id_++;
+    auto slot = msg.callAsync(timeout_ms * 1000ULL,
+                              [this, id](dbus::Message& reply) {
+                                  completeBusCall(id, reply);
+                                  return true;
+                              });
+    if (!slot) {
+        throw std::runtime_error("D-Bus call failed: " + method +
+                                 " could not be sent");
+    }
+    pending_calls_.push_back(PendingCall{id, std::move(slot), 0, method,
+                                         now(CLOCK_MONOTONIC),
+                                         std::move(handler)});
+}
 
-    DBusMessage* reply = dbus_connection_send_with_reply_and_block(
-        conn_, msg, 1000, &error);
-    dbus_message_unref(msg);
+void DBusClient::callPeerAsync(const char* interface, const char* method,
+                               int timeout_ms, MessageHandler handler) {
+    uint64_t id = next_call_id_++;
+    uint64_t peer_call = peer_->call(
+        DBUS_PATH, interface, method, timeout_ms,
+        [this, id](DBusPeer::Reply* reply, const std::string& error) {
+            completePeerCall(id, reply, error);
+        });
+    pending_calls_.push_back(PendingCall{id, nullptr, peer_call, method,
+                                         now(CLOCK_MONOTONIC),
+                                         std::move(handler)});
+}
 
-    if (dbus_error_is_set(&error)) {
-        std::string err_msg = "D-Bus call failed: ";
-        err_msg += error.message;
-        dbus_error_free(&error);
-        throw std::runtime_error(err_msg);
+void DBusClient::completeBusCall(uint64_t id, dbus::Message& message) {
+    auto it = std::find_if(pending_calls_.begin(), pending_calls_.end(),
+                           [id](const PendingCall& pending) {
+                               return pending.id == id;
+                           });
+    if (it == pending_calls_.end()) {
+        return;
     }
 
-    if (reply) {
-        dbus_message_unref(reply);
+    Reply reply;
+    std::string err_msg;
+    if (message.errorName() == NO_REPLY_ERROR) {
+        // Also what fcitx delivers when the call's timer expires
+        FCITX_WARN() << "D-Bus call " << it->method << " timed out";
+        err_msg = "D-Bus call timed out: " + it->method;
+    } else if (message.isError()) {
+        err_msg = "D-Bus call failed: ";
+        err_msg += message.errorMessage().empty() ? message.errorName()
+                                                  : message.errorMessage();
+    } else {
+        reply.sender = message.sender();
+        std::string signature = message.signature();
+        if (signature.starts_with('s')) {
+            message >> reply.text;
+        } else if (signature.starts_with('h')) {
+            dbus::UnixFD fd;
+            message >> fd;
+            reply.fd = fd.release();
+        }
     }
+    finishPendingCall(it, err_msg.empty() ? &reply : nullptr, err_msg);
 }
 
-void DBusClient::handleMessage(DBusMessage* msg) {
-    if (dbus_message_is_signal(msg, DBUS_INTERFACE, "TranscriptionComplete")) {
-        const char* text = nullptr;
-        int segment_num = 0;
+void DBusClient::completePeerCall(uint64_t id, DBusPeer::Reply* peer_reply,
+                                  const std::string& error) {
+    auto it = std::find_if(pending_calls_.begin(), pending_calls_.end(),
+                           [id](const PendingCall& pending) {
+                               return pending.id == id;
+                           });
+    if (it == pending_calls_.end()) {
+        if (peer_reply && peer_reply->fd >= 0) {
+            close(peer_reply->fd);
+        }
+        return;
+    }
+    if (!peer_reply) {
+        finishPendingCall(it, nullptr, error);
+        return;
+    }
+    Reply reply{"", std::move(peer_reply->text), peer_reply->fd};
+    finishPendingCall(it, &reply, error);
+}
 
-        DBusError error;
-        dbus_error_init(&error);
+void DBusClient::finishPendingCall(std::list<PendingCall>::iterator it,
+                                   Reply* reply, const std::string& error) {
+    MessageHandler handler = std::move(it->handler);
+    uint64_t sent = it->sent;
+    // Erasing the entry drops a bus call's slot from its own callback,
+    // which fcitx allows
+    pending_calls_.erase(it);
 
-        if (dbus_message_get_args(msg, &error,
-                                 DBUS_TYPE_STRING, &text,
-                                 DBUS_TYPE_INT32, &segment_num,
-                                 DBUS_TYPE_INVALID)) {
-            if (transcription_cb_) {
-                transcription_cb_(text, segment_num);
-            }
-        } else {
-            FCITX_WARN() << "Failed to parse TranscriptionComplete: "
-                        << error.message;
-            dbus_error_free(&error);
+    if (handler) {
+        handler(reply, error);
+    }
+    if (reply) {
+        // The first answer from a daemon instance (a new unique name)
+        // shows it is up; ask it for a faster transport
+        if (!reply->sender.empty() && reply->sender != BUS_DAEMON_SERVICE &&
+            upgrade_owner_ != reply->sender && !peer_ && !channel_) {
+            upgrade(reply->sender);
         }
-    } else if (dbus_message_is_signal(msg, DBUS_INTERFACE, "TranscriptionDelta")) {
-        const char* text = nullptr;
+        if (reply->fd >= 0) {
+            close(reply->fd);
+        }
+    }
+    if (stats_) {
+        stats_->record(StatsRegistry::DBusCall, now(CLOCK_MONOTONIC) - sent);
+        if (!error.empty()) {
+            stats_->add(StatsRegistry::DBusCallErrors);
+        }
+    }
+}
 
-        DBusError error;
-        dbus_error_init(&error);
+void DBusClient::cancelCall(PendingCall& pending) {
+    pending.slot.reset();
+    if (pending.peer_call && peer_) {
+        peer_->cancel(pending.peer_call);
+    }
+    pending.peer_call = 0;
+}
 
-        if (dbus_message_get_args(msg, &error,
-                                 DBUS_TYPE_STRING, &text,
-                                 DBUS_TYPE_INVALID)) {
-            if (transcription_delta_cb_) {
-                transcription_delta_cb_(text);
-            }
-        } else {
-            FCITX_WARN() << "Failed to parse TranscriptionDelta: "
-                        << error.message;
-            dbus_error_free(&error);
+void DBusClient::failPendingCalls(const std::string& error, bool peer_only) {
+    std::list<PendingCall> failed;
+    for (auto it = pending_calls_.begin(); it != pending_calls_.end();) {
+        auto next = std::next(it);
+        if (!peer_only || it->peer_call) {
+            failed.splice(failed.end(), pending_calls_, it);
+        }
+        it = next;
+    }
+    for (auto& pending : failed) {
+        cancelCall(pending);
+    }
+    for (auto& pending : failed) {
+        if (stats_) {
+            stats_->add(StatsRegistry::DBusCallErrors);
+        }
+        if (pending.handler) {
+            pending.handler(nullptr, error + " (" + pending.method + ")");
         }
-    } else if (dbus_message_is_signal(msg, DBUS_INTERFACE, "Error")) {
-        const char* message = nullptr;
+    }
+}
+
+void DBusClient::cancelPendingCalls() {
+    for (auto& pending : pending_calls_) {
+        cancelCall(pending);
+    }
+    pending_calls_.clear();
+}
+
+void DBusClient::upgrade(const std::string& owner) {
+    upgrade_owner_ = owner;
+    if (channel_enabled_) {
+        requestEventChannel();
+    } else if (peer_enabled_) {
+        requestPeer();
+    }
+}
 
-        DBusError error;
-        dbus_error_init(&error);
+void DBusClient::requestPeer() {
+    try {
+        callBusAsync(
+            newBusCall(DBUS_INTERFACE, "GetPeerAddress"), DBUS_CALL_TIMEOUT_MS,
+            [this](Reply* reply, const std::string& error) {
+                if (!reply) {
+                    // Older daemons lack the method; stay on the bus
+                    FCITX_DEBUG() << "No peer D-Bus address: " << error;
+                } else if (!reply->text.empty() && !peer_) {
+                    openPeer(reply->text);
+                }
+            });
+    } catch (const std::exception& e) {
+        FCITX_WARN() << e.what();
+    }
+}
 
-        if (dbus_message_get_args(msg, &error,
-                                 DBUS_TYPE_STRING, &message,
-                                 DBUS_TYPE_INVALID)) {
-            if (error_cb_) {
-                error_cb_(message);
+void DBusClient::openPeer(const std::string& address) {
+    try {
+        peer_ = std::make_unique<DBusPeer>(loop_, address,
+                                           [this]() { scheduleDispatch(); });
+    } catch (const std::exception& e) {
+        FCITX_WARN() << e.what();
+        return;
+    }
+
+    // Learn the daemon's id for this connection. Until AttachPeer only
+    // the reply arrives on it.
+    try {
+        callPeerAsync(DBUS_PEER_INTERFACE, "Hello", DBUS_CALL_TIMEOUT_MS,
+                      [this](Reply* reply, const std::string& error) {
+                          if (!reply || reply->text.empty()) {
+                              FCITX_WARN() << "Peer D-Bus handshake failed: "
+                                           << error;
+                              // Not from inside the peer's dispatch
+                              peer_failed_ = true;
+                              scheduleDispatch();
+                              return;
+                          }
+                          requestAttach(reply->text);
+                      });
+    } catch (const std::exception& e) {
+        FCITX_WARN() << e.what();
+        closePeer();
+    }
+}
+
+void DBusClient::requestAttach(const std::string& id) {
+    // Attach over the bus: the reply arrives after every signal the
+    // daemon sent there before the peer started getting copies
+    auto attach = newBusCall(DBUS_INTERFACE, "AttachPeer");
+    attach << id;
+    try {
+        callBusAsync(std::move(attach), DBUS_CALL_TIMEOUT_MS,
+                     [this](Reply* reply, const std::string& error) {
+                         if (!reply) {
+                             FCITX_WARN() << "AttachPeer failed: " << error;
+                             closePeer();
+                         } else if (peer_) {
+                             attachPeer();
+                         }
+                     });
+    } catch (const std::exception& e) {
+        FCITX_WARN() << e.what();
+        peer_failed_ = true;
+        scheduleDispatch();
+    }
+}
+
+void DBusClient::attachPeer() {
+    peer_->watchSignals(
+        DBUS_INTERFACE, [this](const std::string& member, DBusArgReader& args) {
+            if (stats_) {
+                stats_->add(StatsRegistry::DBusSignals);
             }
-        } else {
-            dbus_error_free(&error);
+            handleSignal(member, args);
+        });
+    peer_attached_ = true;
+    // Stop the bus copies; later signals come from the peer
+    signal_slot_.reset();
+    // The peer may have read messages already
+    scheduleDispatch();
+    FCITX_INFO() << "Using a direct D-Bus connection to the daemon";
+}
+
+void DBusClient::closePeer() {
+    if (!peer_) {
+        return;
+    }
+    peer_.reset();
+    if (std::exchange(peer_attached_, false) && connected_) {
+        watchSignals();
+    }
+    // Calls still waiting on it get no reply
+    failPendingCalls("Peer D-Bus connection closed", true);
+    peer_failed_ = false;
+}
+
+void DBusClient::requestEventChannel() {
+    try {
+        callBusAsync(
+            newBusCall(DBUS_CHANNELS_INTERFACE, "OpenEventChannel"),
+            DBUS_CALL_TIMEOUT_MS,
+            [this](Reply* reply, const std::string& error) {
+                if (!reply || reply->fd < 0) {
+                    // Older daemons lack the method
+                    FCITX_DEBUG() << "No event channel: " << error;
+                    if (peer_enabled_ && !peer_) {
+                        requestPeer();
+                    }
+                    return;
+                }
+                // Dispatched in order with the bus signals: those before
+                // the reply are already handled, later events come here
+                int fd = std::exchange(reply->fd, -1);
+                channel_ = std::make_unique<EventChannelReader>(fd);
+                channel_event_ = loop_->addIOEvent(
+                    fd, IOEventFlag::In,
+                    [this](EventSourceIO*, int, IOEventFlags) {
+                        processEvents();
+                        return true;
+                    });
+                signal_slot_.reset();
+                FCITX_INFO() << "Using the daemon's event channel";
+            });
+    } catch (const std::exception& e) {
+        FCITX_WARN() << e.what();
+    }
+}
+
+void DBusClient::readEventChannel() {
+    ChannelEvent event;
+    for (;;) {
+        auto status = channel_->read(event);
+        if (status == EventChannelReader::Status::Empty) {
+            return;
         }
+        if (status == EventChannelReader::Status::Closed) {
+            FCITX_WARN() << "Event channel closed, back to D-Bus signals";
+            closeEventChannel();
+            return;
+        }
+        if (stats_) {
+            stats_->add(StatsRegistry::ChannelEvents);
+        }
+        const TraceStamps* trace = event.traced() ? &event.trace : nullptr;
+        switch (event.kind) {
+        case event_channel::Kind::Delta:
+            onDelta(event.text.c_str(), trace);
+            break;
+        case event_channel::Kind::Completed:
+            onCompleted(event.text.c_str(), event.segment_num, trace);
+            break;
+        case event_channel::Kind::Error:
+            onError(event.text.c_str());
+            break;
+        case event_channel::Kind::Level:
+            if (level_cb_) {
+                level_cb_(event.level);
+            }
+            break;
+        }
+    }
+}
+
+void DBusClient::closeEventChannel() {
+    if (!channel_) {
+        return;
+    }
+    // May run from channel_event_'s own callback; it is replaced by the
+    // next channel
+    channel_event_->setEnabled(false);
+    channel_.reset();
+    if (connected_) {
+        watchSignals();
+    }
+}
+
+void DBusClient::onDelta(const char* text, const TraceStamps* trace) {
+    // Each delta replaces the previous one, so hold only the newest until
+    // the pass ends or another event needs it delivered first
+    if (held_delta_ && stats_) {
+        stats_->add(StatsRegistry::DeltasSuperseded);
+    }
+    held_delta_ = HeldDelta{text, trace ? *trace : TraceStamps{},
+                            trace != nullptr};
+}
+
+void DBusClient::onCompleted(const char* text, int segment_num,
+                             const TraceStamps* trace) {
+    // The completion replaces the segment's deltas
+    dropDelta();
+    if (transcription_cb_) {
+        transcription_cb_(text, segment_num, trace);
+    }
+}
+
+void DBusClient::onError(const char* message) {
+    flushDelta();
+    if (error_cb_) {
+        error_cb_(message);
     }
 }
 
-DBusHandlerResult DBusClient::messageFilter(DBusConnection* conn,
-                                           DBusMessage* msg,
-                                           void* user_data) {
-    auto* client = static_cast<DBusClient*>(user_data);
+void DBusClient::flushDelta() {
+    if (!held_delta_) {
+        return;
+    }
+    HeldDelta delta = std::move(*held_delta_);
+    held_delta_.reset();
+    if (transcription_delta_cb_) {
+        transcription_delta_cb_(delta.text,
+                                delta.traced ? &delta.trace : nullptr);
+    }
+}
 
-    const char* interface = dbus_message_get_interface(msg);
-    if (interface && std::strcmp(interface, DBUS_INTERFACE) == 0) {
-        client->handleMessage(msg);
-        return DBUS_HANDLER_RESULT_HANDLED;
+void DBusClient::dropDelta() {
+    if (!held_delta_) {
+        return;
     }
+    held_delta_.reset();
+    if (stats_) {
+        stats_->add(StatsRegistry::DeltasSuperseded);
+    }
+}
 
-    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+static bool readTrace(DBusArgReader& args, TraceStamps& trace) {
+    return args.read(trace.capture_us) && args.read(trace.send_us) &&
+           args.read(trace.server_us) && args.read(trace.emit_us);
+}
+
+void DBusClient::handleSignal(const std::string& member,
+                              DBusArgReader& args) {
+    std::string text;
+    int32_t segment_num = 0;
+    if (member == "TranscriptionComplete") {
+        if (args.read(text) && args.read(segment_num)) {
+            onCompleted(text.c_str(), segment_num, nullptr);
+        } else {
+            FCITX_WARN() << "Failed to parse TranscriptionComplete";
+        }
+    } else if (member == "TranscriptionDelta") {
+        if (args.read(text)) {
+            onDelta(text.c_str(), nullptr);
+        } else {
+            FCITX_WARN() << "Failed to parse TranscriptionDelta";
+        }
+    } else if (member == "TranscriptionCompleteTraced") {
+        TraceStamps trace;
+        trace.receive_us = now(CLOCK_MONOTONIC);
+        if (args.read(text) && args.read(segment_num) &&
+            readTrace(args, trace)) {
+            onCompleted(text.c_str(), segment_num, &trace);
+        } else {
+            FCITX_WARN() << "Failed to parse TranscriptionCompleteTraced";
+        }
+    } else if (member == "TranscriptionDeltaTraced") {
+        TraceStamps trace;
+        trace.receive_us = now(CLOCK_MONOTONIC);
+        if (args.read(text) && readTrace(args, trace)) {
+            onDelta(text.c_str(), &trace);
+        } else {
+            FCITX_WARN() << "Failed to parse TranscriptionDeltaTraced";
+        }
+    } else if (member == "Error") {
+        if (args.read(text)) {
+            onError(text.c_str());
+        }
+    }
 }
 
 } // namespace fcitx
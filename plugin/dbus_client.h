@@ -1,42 +1,115 @@
 #pragma once
 
-#include <dbus/dbus.h>
+#include <fcitx-utils/dbus/bus.h>
+#include <fcitx-utils/dbus/servicewatch.h>
+#include <fcitx-utils/event.h>
+#include <cstdint>
 #include <functional>
+#include <list>
 #include <memory>
+#include <optional>
 #include <string>
+#include "dbus_peer.h"
+#include "event_channel.h"
+#include "latency_trace.h"
+#include "stats.h"
 
 namespace fcitx {
 
+class Instance;
+class StatsService;
+
 /**
  * D-Bus client for communicating with fcitx5-voice daemon.
+ *
+ * Talks over the session bus through fcitx's dbus API, on fcitx's own
+ * connection when constructed from the Instance (the dbus addon's), so
+ * the process keeps a single session bus connection. With enablePeer() it moves to a direct
+ * connection to the daemon once it offers one, so signals skip the bus
+ * daemon. The bus stays in use for activation, the stats service and as
+ * the fallback when the peer connection drops.
+ *
+ * Watches the daemon's bus name and reports when a daemon exits or
+ * starts, so the owner can reconcile its state. A session bus
+ * connection the client opened itself is reopened with backoff if it
+ * drops; fcitx exits when its own one does.
+ *
+ * Runs entirely from the given event loop: fcitx dispatches the bus,
+ * and the client dispatches the peer connection (see dbus_peer.h).
+ * Callbacks run from loop dispatch and must not destroy the client.
+ *
+ * Transcription events arrive through one of two transports: D-Bus
+ * signals, or with enableEventChannel() the daemon's binary event
+ * channel (see event_channel.h). Both feed the same callbacks.
  */
 class DBusClient {
 public:
-    using TranscriptionCallback = std::function<void(const std::string&, int)>;
-    using TranscriptionDeltaCallback = std::function<void(const std::string&)>;
+    /**
+     * Transcription callbacks get the event's latency stamps when the
+     * daemon runs with --trace, nullptr otherwise.
+     */
+    using TranscriptionCallback = std::function<void(
+        const std::string&, int, const TraceStamps* trace)>;
+    using TranscriptionDeltaCallback =
+        std::function<void(const std::string&, const TraceStamps* trace)>;
     using ErrorCallback = std::function<void(const std::string&)>;
+    /** Completion of an asynchronous method call; error is empty on success. */
+    using ReplyCallback = std::function<void(bool ok, const std::string& error)>;
+    /** Receives a duplicated fd owned by the callee, or -1 on failure. */
+    using FdCallback = std::function<void(int fd)>;
+    /** Input level of a chunk of captured audio (event channel only). */
+    using LevelCallback = std::function<void(const AudioLevel& level)>;
+
+    /** A daemon took (true) or released (false) the service name. */
+    using DaemonCallback = std::function<void(bool running)>;
+    /** GetStatus result ("recording" or "idle"), or empty and an error. */
+    using StatusCallback = std::function<void(const std::string& status,
+                                              const std::string& error)>;
+
+    /** How transcription events currently arrive. */
+    enum class Transport { Signals, Channel };
 
-    DBusClient();
+    /**
+     * Opens a session bus connection of its own on loop.
+     * @throws std::runtime_error if the connection fails
+     */
+    explicit DBusClient(EventLoop* loop);
+
+    /**
+     * Shares fcitx's session bus connection (the dbus addon's), or opens
+     * one of its own on the instance's loop if the addon is not loaded.
+     * @throws std::runtime_error if that connection fails
+     */
+    explicit DBusClient(Instance* instance);
     ~DBusClient();
 
     /**
-     * Start audio recording via D-Bus.
-     * @throws std::runtime_error if connection fails
+     * Start audio recording via D-Bus without blocking.
+     * The reply is delivered to cb from the event loop. Waits long
+     * enough for the bus to activate a daemon that is not running.
+     * @throws std::runtime_error if the call cannot be sent
      */
-    void startRecording();
+    void startRecording(ReplyCallback cb);
 
     /**
-     * Stop audio recording via D-Bus.
-     * @throws std::runtime_error if connection fails
+     * Stop audio recording via D-Bus without blocking.
+     * The reply is delivered to cb from the event loop.
+     * @throws std::runtime_error if the call cannot be sent
      */
-    void stopRecording();
+    void stopRecording(ReplyCallback cb = nullptr);
 
     /**
-     * Get current recording status.
-     * @return "recording" or "idle"
-     * @throws std::runtime_error if connection fails
+     * Ask the daemon to open a standby ASR session without blocking,
+     * starting the daemon through D-Bus activation if needed.
+     * @throws std::runtime_error if the call cannot be sent
      */
-    std::string getStatus();
+    void prewarm(ReplyCallback cb = nullptr);
+
+    /**
+     * Request the daemon's shared PCM ring (see pcm_ring.h) without blocking.
+     * @throws std::runtime_error if the call cannot be sent
+     */
+    void openPcmRing(FdCallback cb);
 
     /**
      * Set callback for transcription completion.
@@ -54,15 +127,57 @@ public:
     void setErrorCallback(ErrorCallback cb);
 
     /**
-     * Process pending D-Bus messages (call from event loop).
+     * Query the daemon's status without blocking; cb runs from the event
+     * loop. Does not start a daemon that is not running.
+     * @throws std::runtime_error if the call cannot be sent
      */
-    void processEvents();
+    void queryStatus(StatusCallback cb);
+
+    /**
+     * Set callback for daemon exits and starts, run after the events
+     * that arrived before them. Also reports the daemon found running
+     * on (re)connecting.
+     */
+    void setDaemonCallback(DaemonCallback cb);
+
+    /**
+     * Set callback for input levels (sent about every 100 ms while
+     * recording, only over the event channel).
+     */
+    void setLevelCallback(LevelCallback cb);
+
+    /**
+     * Record D-Bus dispatch and call metrics into stats and serve it as
+     * org.fcitx.Fcitx5.Voice.Stats at /org/fcitx/Fcitx5/Voice/Stats under
+     * the name org.fcitx.Fcitx5.Voice.Plugin. stats must outlive the
+     * client.
+     */
+    void exportStats(StatsRegistry* stats);
+
+    /**
+     * Upgrade to a direct connection after the first successful reply
+     * from each daemon instance, if the daemon offers one
+     * (GetPeerAddress). Without this, all traffic stays on the session
+     * bus.
+     */
+    void enablePeer(bool enable);
+
+    /** Whether signals and calls currently use the direct connection. */
+    bool hasPeer() const { return peer_attached_; }
 
     /**
-     * Get the D-Bus connection file descriptor for event loop integration.
-     * @return file descriptor, or -1 if not connected
+     * Take transcription events from the daemon's event channel
+     * (OpenEventChannel) instead of D-Bus signals, opened after the
+     * first successful reply from each daemon instance. Preferred over
+     * a peer connection, which is tried only if the daemon offers no
+     * channel. Takes effect from the next daemon instance; an open
+     * channel stays.
      */
-    int getFileDescriptor();
+    void enableEventChannel(bool enable);
+
+    Transport transport() const {
+        return channel_ ? Transport::Channel : Transport::Signals;
+    }
 
     /**
      * Check if connected to daemon.
@@ -70,19 +185,123 @@ public:
     bool isConnected() const { return connected_; }
 
 private:
+    DBusClient(EventLoop* loop, dbus::Bus* bus);
+
+    /**
+     * Ends a dispatch pass: runs the peer connection and the event
+     * channel, then delivers the held delta and daemon changes. Bus
+     * messages are dispatched by fcitx and schedule a pass. Of the
+     * deltas read in one pass, only the newest is delivered, and none
+     * that a completion follows.
+     */
+    void processEvents();
+    void scheduleDispatch();
     void connect();
     void disconnect();
-    void callMethod(const char* method);
-    void handleMessage(DBusMessage* msg);
-    static DBusHandlerResult messageFilter(DBusConnection* conn,
-                                          DBusMessage* msg,
-                                          void* user_data);
+    void closeConnection();
+    void connectionLost();
+    void scheduleReconnect();
+    void reconnect();
+    void registerStats();
+    void watchSignals();
+    void onNameOwnerChanged(const std::string& old_owner,
+                            const std::string& new_owner);
+
+    /** What handlers read from a method reply. */
+    struct Reply {
+        std::string sender;  // Unique name; empty on the peer connection
+        std::string text;    // First argument, if a string
+        int fd = -1;         // First argument, if an fd; closed unless taken
+    };
+    /** Receives the reply, or nullptr and an error description. */
+    using MessageHandler =
+        std::function<void(Reply* reply, const std::string& error)>;
+
+    struct PendingCall {
+        uint64_t id;
+        std::unique_ptr<dbus::Slot> slot;  // On the bus
+        uint64_t peer_call;                // On the peer connection, else 0
+        std::string method;
+        uint64_t sent;
+        MessageHandler handler;
+    };
+
+    /** On the peer connection once attached, else the bus. */
+    void callMethodAsync(const char* interface, const char* method,
+                         int timeout_ms, MessageHandler handler);
+    void callBusAsync(dbus::Message msg, int timeout_ms,
+                      MessageHandler handler);
+    void callPeerAsync(const char* interface, const char* method,
+                       int timeout_ms, MessageHandler handler);
+    dbus::Message newBusCall(const char* interface, const char* method) const;
+    void upgrade(const std::string& owner);
+    void requestPeer();
+    void openPeer(const std::string& address);
+    void requestAttach(const std::string& id);
+    void attachPeer();
+    void closePeer();
+    void requestEventChannel();
+    void readEventChannel();
+    void closeEventChannel();
+    static MessageHandler replyHandler(ReplyCallback cb);
+    void completeBusCall(uint64_t id, dbus::Message& message);
+    void completePeerCall(uint64_t id, DBusPeer::Reply* peer_reply,
+                          const std::string& error);
+    void finishPendingCall(std::list<PendingCall>::iterator it, Reply* reply,
+                           const std::string& error);
+    void cancelCall(PendingCall& pending);
+    void cancelPendingCalls();
+    void failPendingCalls(const std::string& error, bool peer_only = false);
+    /** Decodes a daemon signal from either connection. */
+    void handleSignal(const std::string& member, DBusArgReader& args);
+    // Event sink shared by both transports
+    void onDelta(const char* text, const TraceStamps* trace);
+    void onCompleted(const char* text, int segment_num,
+                     const TraceStamps* trace);
+    void onError(const char* message);
+    void flushDelta();
+    void dropDelta();
+
+    EventLoop* loop_;
+    std::unique_ptr<EventSource> dispatch_event_;  // Deferred processEvents()
+    dbus::Bus* bus_;                     // fcitx's connection, or own_bus_
+    std::unique_ptr<dbus::Bus> own_bus_;  // Without one from fcitx
+    std::unique_ptr<dbus::Slot> signal_slot_;      // Daemon signals on the bus
+    std::unique_ptr<dbus::Slot> disconnect_slot_;  // own_bus_ only
+    bool bus_lost_ = false;                        // Handled by the next pass
+    std::unique_ptr<dbus::ServiceWatch> service_watch_;
+    std::unique_ptr<HandlerTableEntry<dbus::ServiceWatchCallback>>
+        daemon_watch_;
+    std::string daemon_owner_;  // Unique name of the running daemon
+    std::unique_ptr<StatsService> stats_service_;
+    std::unique_ptr<EventSourceTime> reconnect_timer_;  // While own_bus_ is gone
+    std::unique_ptr<DBusPeer> peer_;  // Private connection to the daemon
+    bool peer_attached_ = false;      // Signals and calls use peer_
+    bool peer_failed_ = false;        // Handshake failed; closed next pass
+    bool peer_enabled_ = false;
+    std::string upgrade_owner_;  // Daemon bus name last asked to upgrade
+    std::unique_ptr<EventChannelReader> channel_;  // Replaces the signals
+    std::unique_ptr<EventSourceIO> channel_event_;
+    bool channel_enabled_ = false;
+    std::list<PendingCall> pending_calls_;
+    uint64_t next_call_id_ = 0;
 
-    DBusConnection* conn_ = nullptr;
+    struct HeldDelta {
+        std::string text;
+        TraceStamps trace;
+        bool traced = false;
+    };
+    std::optional<HeldDelta> held_delta_;  // Newest delta of this pass
     TranscriptionCallback transcription_cb_;
     TranscriptionDeltaCallback transcription_delta_cb_;
     ErrorCallback error_cb_;
+    LevelCallback level_cb_;
+    DaemonCallback daemon_cb_;
+    StatsRegistry* stats_ = nullptr;
     bool connected_ = false;
+    bool daemon_exited_ = false;  // Reported at the end of the pass
+    bool daemon_started_ = false;
+    uint64_t reconnect_delay_ = 0;  // Doubles per failed attempt
 };
 
 } // namespace fcitx
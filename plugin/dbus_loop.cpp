@@ -0,0 +1,198 @@
+#include "dbus_loop.h"
+#include <algorithm>
+#include <utility>
+
+namespace fcitx {
+
+DBusLoopBinding::DBusLoopBinding(EventLoop* loop, DBusConnection* conn,
+                                 std::function<void()> wake)
+    : loop_(loop), conn_(conn), wake_(std::move(wake)) {
+    dbus_connection_set_watch_functions(conn_, addWatch, removeWatch,
+                                        toggleWatch, this, nullptr);
+    dbus_connection_set_timeout_functions(conn_, addTimeout, removeTimeout,
+                                          toggleTimeout, this, nullptr);
+    dbus_connection_set_dispatch_status_function(conn_, dispatchStatus, this,
+                                                 nullptr);
+}
+
+DBusLoopBinding::~DBusLoopBinding() {
+    // libdbus removes every watch and timeout through the old functions
+    dbus_connection_set_dispatch_status_function(conn_, nullptr, nullptr,
+                                                 nullptr);
+    dbus_connection_set_watch_functions(conn_, nullptr, nullptr, nullptr,
+                                        nullptr, nullptr);
+    dbus_connection_set_timeout_functions(conn_, nullptr, nullptr, nullptr,
+                                          nullptr, nullptr);
+}
+
+dbus_bool_t DBusLoopBinding::addWatch(DBusWatch* watch, void* data) {
+    auto* self = static_cast<DBusLoopBinding*>(data);
+    int fd = dbus_watch_get_unix_fd(watch);
+    self->fds_[fd].watches.push_back(watch);
+    self->updateFd(fd);
+    return true;
+}
+
+void DBusLoopBinding::removeWatch(DBusWatch* watch, void* data) {
+    auto* self = static_cast<DBusLoopBinding*>(data);
+    int fd = dbus_watch_get_unix_fd(watch);
+    auto it = self->fds_.find(fd);
+    if (it == self->fds_.end()) {
+        return;
+    }
+    auto& watches = it->second.watches;
+    watches.erase(std::remove(watches.begin(), watches.end(), watch),
+                  watches.end());
+    if (!watches.empty()) {
+        self->updateFd(fd);
+        return;
+    }
+    std::unique_ptr<EventSource> event = std::move(it->second.event);
+    self->fds_.erase(it);
+    self->retire(std::move(event));
+}
+
+void DBusLoopBinding::toggleWatch(DBusWatch* watch, void* data) {
+    auto* self = static_cast<DBusLoopBinding*>(data);
+    self->updateFd(dbus_watch_get_unix_fd(watch));
+}
+
+void DBusLoopBinding::updateFd(int fd) {
+    auto& entry = fds_[fd];
+    IOEventFlags flags;
+    for (DBusWatch* watch : entry.watches) {
+        if (!dbus_watch_get_enabled(watch)) {
+            continue;
+        }
+        unsigned wanted = dbus_watch_get_flags(watch);
+        if (wanted & DBUS_WATCH_READABLE) {
+            flags |= IOEventFlag::In;
+        }
+        if (wanted & DBUS_WATCH_WRITABLE) {
+            flags |= IOEventFlag::Out;
+        }
+    }
+
+    if (!flags) {
+        if (entry.event) {
+            entry.event->setEnabled(false);
+        }
+        return;
+    }
+    if (!entry.event) {
+        entry.event = loop_->addIOEvent(
+            fd, flags, [this, fd](EventSourceIO*, int, IOEventFlags revents) {
+                handleFd(fd, revents);
+                return true;
+            });
+        return;
+    }
+    entry.event->setEvents(flags);
+    entry.event->setEnabled(true);
+}
+
+void DBusLoopBinding::handleFd(int fd, IOEventFlags revents) {
+    retired_.clear();
+
+    unsigned condition = 0;
+    if (revents.test(IOEventFlag::In)) {
+        condition |= DBUS_WATCH_READABLE;
+    }
+    if (revents.test(IOEventFlag::Out)) {
+        condition |= DBUS_WATCH_WRITABLE;
+    }
+    if (revents.test(IOEventFlag::Err)) {
+        condition |= DBUS_WATCH_ERROR;
+    }
+    if (revents.test(IOEventFlag::Hup)) {
+        condition |= DBUS_WATCH_HANGUP;
+    }
+
+    // Handling one watch may remove the others (on disconnect)
+    auto it = fds_.find(fd);
+    if (it == fds_.end()) {
+        return;
+    }
+    std::vector<DBusWatch*> watches = it->second.watches;
+    for (DBusWatch* watch : watches) {
+        it = fds_.find(fd);
+        if (it == fds_.end()) {
+            return;
+        }
+        const auto& current = it->second.watches;
+        if (std::find(current.begin(), current.end(), watch) ==
+                current.end() ||
+            !dbus_watch_get_enabled(watch)) {
+            continue;
+        }
+        unsigned wanted = dbus_watch_get_flags(watch) | DBUS_WATCH_ERROR |
+                          DBUS_WATCH_HANGUP;
+        if (condition & wanted) {
+            dbus_watch_handle(watch, condition & wanted);
+        }
+    }
+}
+
+dbus_bool_t DBusLoopBinding::addTimeout(DBusTimeout* timeout, void* data) {
+    auto* self = static_cast<DBusLoopBinding*>(data);
+    self->timeouts_[timeout] = self->loop_->addTimeEvent(
+        CLOCK_MONOTONIC, 0, 0,
+        [self, timeout](EventSourceTime* source, uint64_t time) {
+            self->retired_.clear();
+            // libdbus timeouts repeat until removed or disabled, which
+            // handling them may do
+            source->setTime(time +
+                            dbus_timeout_get_interval(timeout) * 1000ULL);
+            source->setOneShot();
+            dbus_timeout_handle(timeout);
+            return true;
+        });
+    self->armTimeout(timeout);
+    return true;
+}
+
+void DBusLoopBinding::removeTimeout(DBusTimeout* timeout, void* data) {
+    auto* self = static_cast<DBusLoopBinding*>(data);
+    auto it = self->timeouts_.find(timeout);
+    if (it == self->timeouts_.end()) {
+        return;
+    }
+    std::unique_ptr<EventSource> event = std::move(it->second);
+    self->timeouts_.erase(it);
+    self->retire(std::move(event));
+}
+
+void DBusLoopBinding::toggleTimeout(DBusTimeout* timeout, void* data) {
+    static_cast<DBusLoopBinding*>(data)->armTimeout(timeout);
+}
+
+void DBusLoopBinding::armTimeout(DBusTimeout* timeout) {
+    auto it = timeouts_.find(timeout);
+    if (it == timeouts_.end()) {
+        return;
+    }
+    if (!dbus_timeout_get_enabled(timeout)) {
+        it->second->setEnabled(false);
+        return;
+    }
+    it->second->setTime(now(CLOCK_MONOTONIC) +
+                        dbus_timeout_get_interval(timeout) * 1000ULL);
+    it->second->setOneShot();
+}
+
+void DBusLoopBinding::dispatchStatus(DBusConnection*,
+                                     DBusDispatchStatus status,
+                                     void* data) {
+    if (status == DBUS_DISPATCH_DATA_REMAINS) {
+        static_cast<DBusLoopBinding*>(data)->wake_();
+    }
+}
+
+void DBusLoopBinding::retire(std::unique_ptr<EventSource> event) {
+    if (event) {
+        event->setEnabled(false);
+        retired_.push_back(std::move(event));
+    }
+}
+
+} // namespace fcitx
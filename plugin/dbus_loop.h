@@ -0,0 +1,68 @@
+#pragma once
+
+#include <dbus/dbus.h>
+#include <fcitx-utils/event.h>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace fcitx {
+
+/**
+ * Runs a libdbus connection from the fcitx event loop.
+ *
+ * libdbus asks for its socket to be watched, for reading always and for
+ * writing while messages wait in its outgoing queue, and for timers that
+ * expire method calls. Each watched fd gets one IO event listening for
+ * the union of its enabled watches (the loop allows one source per fd),
+ * and each timeout a time event. Outgoing messages are written as the
+ * socket accepts them, without a blocking flush.
+ *
+ * libdbus does not allow dispatching from its own callbacks, so when it
+ * has queued incoming messages the binding calls wake(); the owner then
+ * dispatches from a deferred event.
+ *
+ * Destroy the binding before closing the connection. Sources libdbus
+ * removes from inside their own callback are only disabled, and freed
+ * from a later callback.
+ */
+class DBusLoopBinding {
+public:
+    DBusLoopBinding(EventLoop* loop, DBusConnection* conn,
+                    std::function<void()> wake);
+    ~DBusLoopBinding();
+
+    DBusLoopBinding(const DBusLoopBinding&) = delete;
+    DBusLoopBinding& operator=(const DBusLoopBinding&) = delete;
+
+private:
+    struct FdWatch {
+        std::vector<DBusWatch*> watches;
+        std::unique_ptr<EventSourceIO> event;
+    };
+
+    static dbus_bool_t addWatch(DBusWatch* watch, void* data);
+    static void removeWatch(DBusWatch* watch, void* data);
+    static void toggleWatch(DBusWatch* watch, void* data);
+    static dbus_bool_t addTimeout(DBusTimeout* timeout, void* data);
+    static void removeTimeout(DBusTimeout* timeout, void* data);
+    static void toggleTimeout(DBusTimeout* timeout, void* data);
+    static void dispatchStatus(DBusConnection* conn, DBusDispatchStatus status,
+                               void* data);
+
+    void updateFd(int fd);
+    void handleFd(int fd, IOEventFlags flags);
+    void armTimeout(DBusTimeout* timeout);
+    void retire(std::unique_ptr<EventSource> event);
+
+    EventLoop* loop_;
+    DBusConnection* conn_;
+    std::function<void()> wake_;
+    std::unordered_map<int, FdWatch> fds_;
+    std::unordered_map<DBusTimeout*, std::unique_ptr<EventSourceTime>>
+        timeouts_;
+    std::vector<std::unique_ptr<EventSource>> retired_;  // Disabled, to free
+};
+
+} // namespace fcitx
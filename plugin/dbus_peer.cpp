@@ -0,0 +1,224 @@
+#include "dbus_peer.h"
+#include <dbus/dbus.h>
+#include <fcitx-utils/log.h>
+#include <unistd.h>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include "dbus_loop.h"
+
+namespace fcitx {
+
+namespace {
+
+/** Reads the arguments of a libdbus message through its iterator. */
+class IterArgReader : public DBusArgReader {
+public:
+    explicit IterArgReader(DBusMessage* msg)
+        : ok_(dbus_message_iter_init(msg, &iter_)) {}
+
+    bool read(std::string& value) override {
+        const char* text = nullptr;
+        if (!next(DBUS_TYPE_STRING, &text)) {
+            return false;
+        }
+        value = text;
+        return true;
+    }
+    bool read(int32_t& value) override {
+        dbus_int32_t v = 0;
+        if (!next(DBUS_TYPE_INT32, &v)) {
+            return false;
+        }
+        value = v;
+        return true;
+    }
+    bool read(uint64_t& value) override {
+        dbus_uint64_t v = 0;
+        if (!next(DBUS_TYPE_UINT64, &v)) {
+            return false;
+        }
+        value = v;
+        return true;
+    }
+
+private:
+    bool next(int type, void* value) {
+        if (ok_ && !first_) {
+            ok_ = dbus_message_iter_next(&iter_);
+        }
+        first_ = false;
+        if (!ok_ || dbus_message_iter_get_arg_type(&iter_) != type) {
+            ok_ = false;
+            return false;
+        }
+        dbus_message_iter_get_basic(&iter_, value);
+        return true;
+    }
+
+    DBusMessageIter iter_;
+    bool ok_;
+    bool first_ = true;
+};
+
+} // namespace
+
+struct DBusPeer::Callbacks {
+    static void pendingCallNotify(DBusPendingCall* pending, void* data) {
+        static_cast<DBusPeer*>(data)->complete(pending);
+    }
+    static DBusHandlerResult messageFilter(DBusConnection*, DBusMessage* msg,
+                                           void* data) {
+        return static_cast<DBusPeer*>(data)->handleMessage(msg)
+                   ? DBUS_HANDLER_RESULT_HANDLED
+                   : DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+};
+
+DBusPeer::DBusPeer(EventLoop* loop, const std::string& address,
+                   std::function<void()> wake) {
+    DBusError error;
+    dbus_error_init(&error);
+    conn_ = dbus_connection_open_private(address.c_str(), &error);
+    if (!conn_) {
+        std::string message = "Failed to open peer D-Bus connection: ";
+        message += error.message ? error.message : address;
+        dbus_error_free(&error);
+        throw std::runtime_error(message);
+    }
+    dbus_connection_set_exit_on_disconnect(conn_, false);
+    dbus_connection_add_filter(conn_, Callbacks::messageFilter, this, nullptr);
+    binding_ = std::make_unique<DBusLoopBinding>(loop, conn_, std::move(wake));
+}
+
+DBusPeer::~DBusPeer() {
+    for (auto& call : calls_) {
+        dbus_pending_call_cancel(call.pending);
+        dbus_pending_call_unref(call.pending);
+    }
+    calls_.clear();
+    dbus_connection_remove_filter(conn_, Callbacks::messageFilter, this);
+    binding_.reset();
+    dbus_connection_close(conn_);
+    dbus_connection_unref(conn_);
+}
+
+uint64_t DBusPeer::call(const char* path, const char* interface,
+                        const char* method, int timeout_ms,
+                        ReplyHandler handler) {
+    // A peer connection has no bus to route by name, nor to activate
+    DBusMessage* msg =
+        dbus_message_new_method_call(nullptr, path, interface, method);
+    if (!msg) {
+        throw std::runtime_error("Failed to create D-Bus message");
+    }
+    DBusPendingCall* pending = nullptr;
+    bool sent =
+        dbus_connection_send_with_reply(conn_, msg, &pending, timeout_ms);
+    dbus_message_unref(msg);
+    if (!sent || !pending) {
+        throw std::runtime_error(std::string("D-Bus call failed: ") + method +
+                                 " could not be sent");
+    }
+
+    // libdbus expires the call through the loop binding's timers; the
+    // request itself is written out as the socket accepts it
+    uint64_t id = next_id_++;
+    calls_.push_back(Call{id, pending, method, std::move(handler)});
+    dbus_pending_call_set_notify(pending, Callbacks::pendingCallNotify, this,
+                                 nullptr);
+    return id;
+}
+
+void DBusPeer::cancel(uint64_t id) {
+    auto it = std::find_if(calls_.begin(), calls_.end(),
+                           [id](const Call& call) { return call.id == id; });
+    if (it == calls_.end()) {
+        return;
+    }
+    dbus_pending_call_cancel(it->pending);
+    dbus_pending_call_unref(it->pending);
+    calls_.erase(it);
+}
+
+void DBusPeer::watchSignals(const char* interface, SignalHandler handler) {
+    signal_interface_ = interface;
+    signal_handler_ = std::move(handler);
+}
+
+bool DBusPeer::dispatch() {
+    while (dbus_connection_dispatch(conn_) == DBUS_DISPATCH_DATA_REMAINS) {
+    }
+    // Dispatching a lost connection fails its pending calls first
+    return dbus_connection_get_is_connected(conn_);
+}
+
+void DBusPeer::complete(DBusPendingCall* pending) {
+    auto it = std::find_if(
+        calls_.begin(), calls_.end(),
+        [pending](const Call& call) { return call.pending == pending; });
+    if (it == calls_.end()) {
+        return;
+    }
+    DBusMessage* message = dbus_pending_call_steal_reply(pending);
+    dbus_pending_call_unref(pending);
+    std::string method = std::move(it->method);
+    ReplyHandler handler = std::move(it->handler);
+    calls_.erase(it);
+
+    Reply reply;
+    std::string err_msg;
+    if (!message) {
+        err_msg = "D-Bus call failed: no reply to " + method;
+    } else if (dbus_message_is_error(message, DBUS_ERROR_NO_REPLY)) {
+        // Also what libdbus synthesizes when the call's timer expires
+        FCITX_WARN() << "D-Bus call " << method << " timed out";
+        err_msg = "D-Bus call timed out: " + method;
+    } else if (dbus_message_get_type(message) == DBUS_MESSAGE_TYPE_ERROR) {
+        DBusError error;
+        dbus_error_init(&error);
+        dbus_set_error_from_message(&error, message);
+        err_msg = "D-Bus call failed: ";
+        err_msg += error.message ? error.message
+                                 : dbus_message_get_error_name(message);
+        dbus_error_free(&error);
+    } else {
+        DBusMessageIter args;
+        if (dbus_message_iter_init(message, &args)) {
+            int type = dbus_message_iter_get_arg_type(&args);
+            if (type == DBUS_TYPE_STRING) {
+                const char* text = nullptr;
+                dbus_message_iter_get_basic(&args, &text);
+                reply.text = text;
+            } else if (type == DBUS_TYPE_UNIX_FD) {
+                // A duplicate, owned by the handler
+                dbus_message_iter_get_basic(&args, &reply.fd);
+            }
+        }
+    }
+    if (message) {
+        dbus_message_unref(message);
+    }
+    if (handler) {
+        handler(err_msg.empty() ? &reply : nullptr, err_msg);
+    } else if (reply.fd >= 0) {
+        close(reply.fd);
+    }
+}
+
+bool DBusPeer::handleMessage(DBusMessage* msg) {
+    if (!signal_handler_ ||
+        dbus_message_get_type(msg) != DBUS_MESSAGE_TYPE_SIGNAL) {
+        return false;
+    }
+    const char* interface = dbus_message_get_interface(msg);
+    const char* member = dbus_message_get_member(msg);
+    if (!interface || !member || signal_interface_ != interface) {
+        return false;
+    }
+    IterArgReader args(msg);
+    signal_handler_(member, args);
+    return true;
+}
+
+} // namespace fcitx
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <fcitx-utils/event.h>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+
+// libdbus types, used only by dbus_peer.cpp
+struct DBusConnection;
+struct DBusMessage;
+struct DBusPendingCall;
+
+namespace fcitx {
+
+class DBusLoopBinding;
+
+/**
+ * Reads the arguments of a D-Bus message in order, whichever connection
+ * it arrived on. A read fails on a type mismatch or past the last
+ * argument, and so do all reads after it.
+ */
+class DBusArgReader {
+public:
+    virtual ~DBusArgReader() = default;
+    virtual bool read(std::string& value) = 0;
+    virtual bool read(int32_t& value) = 0;
+    virtual bool read(uint64_t& value) = 0;
+};
+
+/**
+ * Private connection to the daemon's peer-to-peer D-Bus server.
+ *
+ * Uses libdbus directly: fcitx's dbus::Bus says Hello to a bus daemon on
+ * connecting, which a peer-to-peer server does not answer. The
+ * connection runs from the event loop through DBusLoopBinding, which
+ * calls wake when messages are queued; the owner then calls dispatch()
+ * from outside libdbus' callbacks, and replies and signals are delivered
+ * from there. Handlers must not destroy the peer.
+ */
+class DBusPeer {
+public:
+    /** What a handler reads from a method reply. */
+    struct Reply {
+        std::string text;  // First argument, if a string
+        int fd = -1;       // First argument, if an fd; owned by the handler
+    };
+    /** Receives the reply, or nullptr and an error description. */
+    using ReplyHandler =
+        std::function<void(Reply* reply, const std::string& error)>;
+    using SignalHandler =
+        std::function<void(const std::string& member, DBusArgReader& args)>;
+
+    /** @throws std::runtime_error if the connection cannot be opened */
+    DBusPeer(EventLoop* loop, const std::string& address,
+             std::function<void()> wake);
+    /** Closes the connection. Pending calls are dropped unanswered. */
+    ~DBusPeer();
+
+    DBusPeer(const DBusPeer&) = delete;
+    DBusPeer& operator=(const DBusPeer&) = delete;
+
+    /**
+     * Call a method without arguments on the daemon's object at path.
+     * Returns an id for cancel().
+     * @throws std::runtime_error if the call cannot be sent
+     */
+    uint64_t call(const char* path, const char* interface, const char* method,
+                  int timeout_ms, ReplyHandler handler);
+
+    /** Drop a pending call; its handler does not run. */
+    void cancel(uint64_t id);
+
+    /** Deliver the signals of interface to handler from now on. */
+    void watchSignals(const char* interface, SignalHandler handler);
+
+    /**
+     * Run the handlers of the messages read so far. Returns false once
+     * the connection is lost, after failing its pending calls.
+     */
+    bool dispatch();
+
+private:
+    struct Call {
+        uint64_t id;
+        DBusPendingCall* pending;
+        std::string method;
+        ReplyHandler handler;
+    };
+
+    struct Callbacks;  // libdbus entry points, in dbus_peer.cpp
+
+    void complete(DBusPendingCall* pending);
+    bool handleMessage(DBusMessage* msg);
+
+    DBusConnection* conn_ = nullptr;
+    std::unique_ptr<DBusLoopBinding> binding_;
+    std::list<Call> calls_;
+    uint64_t next_id_ = 1;
+    std::string signal_interface_;
+    SignalHandler signal_handler_;
+};
+
+} // namespace fcitx
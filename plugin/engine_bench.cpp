@@ -0,0 +1,351 @@
+// fcitx5-voice-engine-bench: VoiceEngine without a running fcitx5.
+//
+// Instantiates the engine on a bare fcitx Instance (no addons, no UI)
+// with a fake InputContext that records preedit updates and commits.
+// The engine's DBusClient talks to a private dbus-daemon started here,
+// on which a second connection plays the daemon and fires synthetic
+// TranscriptionDelta/TranscriptionComplete signals: per session, one
+// delta per character of a growing sentence, then the completion.
+//
+// Reports the event loop thread's CPU time and heap allocations per
+// signal (the whole receive path: D-Bus dispatch, DBusClient, engine,
+// InputContext), plus what reached the fake application:
+//
+//   signals N  preedit N  commits N
+//   wall MS ms  cpu MS ms  US us/signal
+//   allocations N/signal  BYTES B/signal
+//
+// Run under perf, heaptrack or valgrind to profile the same workload.
+
+#include <dbus/dbus.h>
+#include <fcitx-config/rawconfig.h>
+#include <fcitx-utils/event.h>
+#include <fcitx/inputcontext.h>
+#include <fcitx/inputcontextmanager.h>
+#include <fcitx/instance.h>
+#include <getopt.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include "voice_engine.h"
+
+extern char** environ;
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> allocated_bytes{0};
+
+constexpr const char* DBUS_PATH = "/org/fcitx/Fcitx5/Voice";
+constexpr const char* DBUS_INTERFACE = "org.fcitx.Fcitx5.Voice";
+constexpr const char* END_MARKER = "<end>";
+constexpr uint64_t WATCHDOG_US = 120000000;  // Give up if signals go missing
+
+// Stands in for the application: counts what the engine sends it
+class BenchInputContext : public fcitx::InputContext {
+public:
+    BenchInputContext(fcitx::InputContextManager& manager,
+                      fcitx::EventLoop& loop)
+        : InputContext(manager, "fcitx5-voice-engine-bench"), loop_(loop) {
+        created();
+        setCapabilityFlags(fcitx::CapabilityFlag::Preedit);
+    }
+    ~BenchInputContext() override { destroy(); }
+
+    const char* frontend() const override { return "bench"; }
+
+    uint64_t preedits = 0;
+    uint64_t commits = 0;
+
+protected:
+    void commitStringImpl(const std::string& text) override {
+        if (text == END_MARKER) {
+            loop_.exit();
+            return;
+        }
+        ++commits;
+    }
+    void deleteSurroundingTextImpl(int, unsigned int) override {}
+    void forwardKeyImpl(const fcitx::ForwardKeyEvent&) override {}
+    void updatePreeditImpl() override { ++preedits; }
+
+private:
+    fcitx::EventLoop& loop_;
+};
+
+void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [options]\n"
+              << "\n"
+              << "  --sessions N      Utterances to simulate (default: 200)\n"
+              << "  --fps N           PreeditFps (default: 0 = paint every delta)\n"
+              << "  --early-commit    Enable EarlyCommit\n"
+              << "  --rate N          Signals per second (default: 0 = all at once)\n"
+              << "  --session-bus     Use the current session bus instead of a\n"
+              << "                    private dbus-daemon\n";
+}
+
+uint64_t threadCpuUs() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+// Start dbus-daemon --session and point DBUS_SESSION_BUS_ADDRESS at it
+pid_t startPrivateBus() {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+    char arg0[] = "dbus-daemon";
+    char arg1[] = "--session";
+    char arg2[] = "--nofork";
+    char arg3[] = "--print-address=1";
+    char* argv[] = {arg0, arg1, arg2, arg3, nullptr};
+    pid_t pid = -1;
+    int err = posix_spawnp(&pid, "dbus-daemon", &actions, nullptr, argv,
+                           environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (err != 0) {
+        close(fds[0]);
+        return -1;
+    }
+
+    std::string address;
+    char c;
+    while (read(fds[0], &c, 1) == 1 && c != '\n') {
+        address.push_back(c);
+    }
+    close(fds[0]);
+    if (address.empty()) {
+        kill(pid, SIGTERM);
+        waitpid(pid, nullptr, 0);
+        return -1;
+    }
+    setenv("DBUS_SESSION_BUS_ADDRESS", address.c_str(), 1);
+    return pid;
+}
+
+// The synthetic daemon: growing partial results, then the final text
+std::vector<DBusMessage*> buildSignals(unsigned sessions) {
+    static const std::vector<std::string> sentences = {
+        "音声認識のテストを行います。",
+        "日本語をリアルタイムでテキストに変換します。",
+        "認識結果が表示されます。",
+    };
+    std::vector<DBusMessage*> messages;
+    for (unsigned s = 0; s < sessions; ++s) {
+        const std::string& sentence = sentences[s % sentences.size()];
+        std::string partial;
+        for (size_t i = 0; i < sentence.size();) {
+            // Grow by one UTF-8 character
+            size_t len = 1;
+            while (i + len < sentence.size() &&
+                   (static_cast<unsigned char>(sentence[i + len]) & 0xC0) == 0x80) {
+                ++len;
+            }
+            partial.append(sentence, i, len);
+            i += len;
+
+            DBusMessage* msg = dbus_message_new_signal(
+                DBUS_PATH, DBUS_INTERFACE, "TranscriptionDelta");
+            const char* text = partial.c_str();
+            dbus_message_append_args(msg, DBUS_TYPE_STRING, &text,
+                                     DBUS_TYPE_INVALID);
+            messages.push_back(msg);
+        }
+        DBusMessage* msg = dbus_message_new_signal(DBUS_PATH, DBUS_INTERFACE,
+                                                   "TranscriptionComplete");
+        const char* text = sentence.c_str();
+        dbus_int32_t segment = s + 1;
+        dbus_message_append_args(msg, DBUS_TYPE_STRING, &text, DBUS_TYPE_INT32,
+                                 &segment, DBUS_TYPE_INVALID);
+        messages.push_back(msg);
+    }
+
+    DBusMessage* msg = dbus_message_new_signal(DBUS_PATH, DBUS_INTERFACE,
+                                               "TranscriptionComplete");
+    const char* text = END_MARKER;
+    dbus_int32_t segment = 0;
+    dbus_message_append_args(msg, DBUS_TYPE_STRING, &text, DBUS_TYPE_INT32,
+                             &segment, DBUS_TYPE_INVALID);
+    messages.push_back(msg);
+    return messages;
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+int main(int argc, char* argv[]) {
+    unsigned sessions = 200;
+    int fps = 0;
+    bool early_commit = false;
+    unsigned rate = 0;
+    bool session_bus = false;
+
+    static const option long_options[] = {
+        {"sessions", required_argument, nullptr, 'n'},
+        {"fps", required_argument, nullptr, 'f'},
+        {"early-commit", no_argument, nullptr, 'e'},
+        {"rate", required_argument, nullptr, 'r'},
+        {"session-bus", no_argument, nullptr, 's'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, nullptr)) != -1) {
+        switch (opt) {
+        case 'n':
+            sessions = std::atoi(optarg);
+            break;
+        case 'f':
+            fps = std::atoi(optarg);
+            break;
+        case 'e':
+            early_commit = true;
+            break;
+        case 'r':
+            rate = std::atoi(optarg);
+            break;
+        case 's':
+            session_bus = true;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind != argc || sessions == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    pid_t bus_pid = -1;
+    if (!session_bus) {
+        bus_pid = startPrivateBus();
+        if (bus_pid < 0) {
+            std::cerr << "Failed to start dbus-daemon" << std::endl;
+            return 1;
+        }
+    }
+    // Keep the engine's config writes away from the user's
+    char config_dir[] = "/tmp/fcitx5-voice-bench-XXXXXX";
+    if (mkdtemp(config_dir)) {
+        setenv("XDG_CONFIG_HOME", config_dir, 1);
+    }
+
+    int status = 0;
+    {
+        char arg0[] = "fcitx5-voice-engine-bench";
+        char arg1[] = "--disable=all";
+        char* instance_argv[] = {arg0, arg1};
+        fcitx::Instance instance(2, instance_argv);
+        fcitx::VoiceEngine engine(&instance);
+
+        fcitx::RawConfig config;
+        config.setValueByPath("PreeditFps", std::to_string(fps));
+        config.setValueByPath("EarlyCommit", early_commit ? "True" : "False");
+        engine.setConfig(config);
+
+        BenchInputContext ic(instance.inputContextManager(),
+                             instance.eventLoop());
+
+        DBusError error;
+        dbus_error_init(&error);
+        DBusConnection* sender = dbus_bus_get_private(DBUS_BUS_SESSION, &error);
+        if (!sender) {
+            std::cerr << "Failed to connect: " << error.message << std::endl;
+            dbus_error_free(&error);
+            status = 1;
+        } else {
+            std::vector<DBusMessage*> messages = buildSignals(sessions);
+            size_t next = 0;
+            uint64_t interval = rate ? 1000000 / rate : 0;
+
+            uint64_t cpu_start = threadCpuUs();
+            uint64_t wall_start = fcitx::now(CLOCK_MONOTONIC);
+            uint64_t allocs_start = allocations.load();
+            uint64_t bytes_start = allocated_bytes.load();
+
+            auto feeder = instance.eventLoop().addTimeEvent(
+                CLOCK_MONOTONIC, wall_start, 0,
+                [&](fcitx::EventSourceTime* source, uint64_t time) {
+                    do {
+                        dbus_connection_send(sender, messages[next++], nullptr);
+                    } while (!interval && next < messages.size());
+                    dbus_connection_flush(sender);
+                    if (next < messages.size()) {
+                        source->setTime(time + interval);
+                        source->setOneShot();
+                    }
+                    return true;
+                });
+            auto watchdog = instance.eventLoop().addTimeEvent(
+                CLOCK_MONOTONIC, wall_start + WATCHDOG_US, 0,
+                [&](fcitx::EventSourceTime*, uint64_t) {
+                    std::cerr << "Timed out after " << next << " of "
+                              << messages.size() << " signals sent"
+                              << std::endl;
+                    status = 1;
+                    instance.eventLoop().exit();
+                    return true;
+                });
+            instance.eventLoop().exec();
+
+            uint64_t cpu = threadCpuUs() - cpu_start;
+            uint64_t wall = fcitx::now(CLOCK_MONOTONIC) - wall_start;
+            uint64_t allocs = allocations.load() - allocs_start;
+            uint64_t bytes = allocated_bytes.load() - bytes_start;
+            double n = messages.size();
+
+            std::printf("signals %zu  preedit %llu  commits %llu\n",
+                        messages.size(),
+                        static_cast<unsigned long long>(ic.preedits),
+                        static_cast<unsigned long long>(ic.commits));
+            std::printf("wall %.1f ms  cpu %.1f ms  %.1f us/signal\n",
+                        wall / 1000.0, cpu / 1000.0, cpu / n);
+            std::printf("allocations %.1f/signal  %.0f B/signal\n",
+                        allocs / n, bytes / n);
+
+            for (auto* msg : messages) {
+                dbus_message_unref(msg);
+            }
+            dbus_connection_close(sender);
+            dbus_connection_unref(sender);
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(config_dir, ec);
+    if (bus_pid > 0) {
+        kill(bus_pid, SIGTERM);
+        waitpid(bus_pid, nullptr, 0);
+    }
+    return status;
+}
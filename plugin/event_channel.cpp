@@ -0,0 +1,89 @@
+#include "event_channel.h"
+#include <fcitx-utils/event.h>
+#include <fcitx-utils/log.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace fcitx {
+
+namespace {
+
+template <typename T>
+T load(const char* data, size_t offset) {
+    T value;
+    std::memcpy(&value, data + offset, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+EventChannelReader::EventChannelReader(int fd)
+    : fd_(fd), buffer_(event_channel::MAX_MESSAGE) {
+    int flags = fcntl(fd_, F_GETFL);
+    if (flags >= 0) {
+        fcntl(fd_, F_SETFL, flags | O_NONBLOCK);
+    }
+}
+
+EventChannelReader::~EventChannelReader() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+EventChannelReader::Status EventChannelReader::read(ChannelEvent& event) {
+    using event_channel::Kind;
+
+    for (;;) {
+        // MSG_TRUNC reports the full length of an oversized message
+        ssize_t n = recv(fd_, buffer_.data(), buffer_.size(), MSG_TRUNC);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return Status::Empty;
+            }
+            FCITX_WARN() << "Event channel read failed: "
+                         << std::strerror(errno);
+            return Status::Closed;
+        }
+        if (n == 0) {
+            return Status::Closed;
+        }
+
+        const char* data = buffer_.data();
+        size_t size = static_cast<size_t>(n);
+        if (size < event_channel::HEADER_SIZE || size > buffer_.size() ||
+            load<uint8_t>(data, 1) != event_channel::VERSION ||
+            load<uint32_t>(data, 4) != size - event_channel::HEADER_SIZE) {
+            FCITX_WARN() << "Skipping malformed event channel message";
+            continue;
+        }
+
+        auto kind = static_cast<Kind>(load<uint8_t>(data, 0));
+        if (kind != Kind::Delta && kind != Kind::Completed &&
+            kind != Kind::Error && kind != Kind::Level) {
+            continue;
+        }
+
+        event.kind = kind;
+        event.text.assign(data + event_channel::HEADER_SIZE,
+                          size - event_channel::HEADER_SIZE);
+        event.segment_num = load<int32_t>(data, 8);
+        event.level.samples = load<uint32_t>(data, 12);
+        event.level.peak = static_cast<int>(load<uint32_t>(data, 16));
+        event.level.rms = load<float>(data, 20);
+        event.trace.capture_us = load<uint64_t>(data, 24);
+        event.trace.send_us = load<uint64_t>(data, 32);
+        event.trace.server_us = load<uint64_t>(data, 40);
+        event.trace.emit_us = load<uint64_t>(data, 48);
+        event.trace.receive_us = now(CLOCK_MONOTONIC);
+        return Status::Event;
+    }
+}
+
+} // namespace fcitx
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "latency_trace.h"
+#include "pcm_ring.h"
+
+namespace fcitx {
+
+/**
+ * Binary event channel from the daemon (daemon/event_channel.py), an
+ * alternative to the transcription signals on D-Bus.
+ *
+ * One SOCK_SEQPACKET message per event: a fixed header (little-endian)
+ * followed by the event's UTF-8 text:
+ *   0   u8  kind (event_channel::Kind)
+ *   1   u8  version
+ *   2   u16 reserved
+ *   4   u32 text length in bytes
+ *   8   i32 segment number (Completed)
+ *   12  u32 samples the level covers (Level)
+ *   16  u32 peak (Level, 0..32768)
+ *   20  f32 rms (Level, 0..32768)
+ *   24  u64 capture_us  \
+ *   32  u64 send_us      | Delta and Completed; 0 unless the daemon
+ *   40  u64 server_us    | runs with --trace
+ *   48  u64 emit_us     /
+ *   56  text
+ *
+ * The socket is one end of a socketpair handed over by
+ * org.fcitx.Fcitx5.Voice.Channels.OpenEventChannel.
+ */
+namespace event_channel {
+constexpr uint8_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 56;
+constexpr size_t MAX_MESSAGE = 64 * 1024;
+
+enum class Kind : uint8_t { Delta = 1, Completed = 2, Error = 3, Level = 4 };
+} // namespace event_channel
+
+struct ChannelEvent {
+    event_channel::Kind kind = event_channel::Kind::Delta;
+    std::string text;
+    int segment_num = 0;
+    AudioLevel level;
+    TraceStamps trace;  // capture_us == 0 when untraced
+
+    bool traced() const { return trace.capture_us != 0; }
+};
+
+/**
+ * Consumer side of the event channel.
+ */
+class EventChannelReader {
+public:
+    enum class Status { Event, Empty, Closed };
+
+    /** Takes ownership of fd and makes it non-blocking. */
+    explicit EventChannelReader(int fd);
+    ~EventChannelReader();
+
+    EventChannelReader(const EventChannelReader&) = delete;
+    EventChannelReader& operator=(const EventChannelReader&) = delete;
+
+    int fd() const { return fd_; }
+
+    /**
+     * Read the next message without blocking. Malformed messages and
+     * unknown kinds are skipped. Closed once the daemon has hung up.
+     */
+    Status read(ChannelEvent& event);
+
+private:
+    int fd_ = -1;
+    std::vector<char> buffer_;
+};
+
+} // namespace fcitx
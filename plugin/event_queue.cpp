@@ -0,0 +1,111 @@
+#include "event_queue.h"
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace fcitx {
+
+EventQueue::EventQueue(size_t capacity)
+    : capacity_(std::bit_ceil(std::max<size_t>(capacity, 2))),
+      mask_(capacity_ - 1),
+      slots_(std::make_unique<Event[]>(capacity_)) {
+    fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fd_ < 0) {
+        throw std::runtime_error(std::string("eventfd: ") +
+                                 std::strerror(errno));
+    }
+}
+
+EventQueue::~EventQueue() {
+    delete delta_.load();
+    close(fd_);
+}
+
+bool EventQueue::push(Event&& event) {
+    size_t head = head_.load(std::memory_order_relaxed);
+
+    if (event.kind == Kind::Delta) {
+        event.after = head;
+        discardDelta(delta_.exchange(new Event(std::move(event))));
+        notify();
+        return true;
+    }
+
+    if (head - tail_.load(std::memory_order_acquire) == capacity_) {
+        return false;
+    }
+    // Completions finalize the segment; errors and end of input end it.
+    // Cleared before publishing so the delta can never follow the event.
+    discardDelta(delta_.exchange(nullptr));
+    slots_[head & mask_] = std::move(event);
+    head_.store(head + 1, std::memory_order_release);
+    notify();
+    return true;
+}
+
+void EventQueue::notify() {
+    // seq_cst pairs with the consumer's clear: either it sees this event
+    // after clearing, or this exchange sees the clear and wakes it again
+    if (!notified_.exchange(true)) {
+        uint64_t one = 1;
+        ssize_t n;
+        do {
+            n = write(fd_, &one, sizeof(one));
+        } while (n < 0 && errno == EINTR);
+    }
+}
+
+void EventQueue::discardDelta(Event* delta) {
+    if (delta) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        delete delta;
+    }
+}
+
+void EventQueue::drain(std::vector<Event>& out) {
+    out.clear();
+    uint64_t count;
+    while (read(fd_, &count, sizeof(count)) < 0 && errno == EINTR) {
+    }
+    notified_.store(false);
+
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_acquire);
+    for (; tail != head; ++tail) {
+        out.push_back(std::move(slots_[tail & mask_]));
+    }
+    tail_.store(tail, std::memory_order_release);
+
+    std::unique_ptr<Event> delta(delta_.exchange(nullptr));
+    if (!delta) {
+        return;
+    }
+    if (delta->after == head) {
+        out.push_back(std::move(*delta));
+        return;
+    }
+    if (delta->after < head) {
+        // A ring event followed it (possible only after a put-back below)
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // Ring events queued before the delta arrived after the head was
+    // read; put it back for the wakeup they caused unless superseded
+    Event* expected = nullptr;
+    if (delta_.compare_exchange_strong(expected, delta.get())) {
+        delta.release();
+    } else {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void EventQueue::clearDelta() {
+    discardDelta(delta_.exchange(nullptr));
+}
+
+} // namespace fcitx
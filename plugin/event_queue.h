@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fcitx {
+
+/**
+ * Daemon-side event handoff from the asyncio thread to the GLib main
+ * loop (exposed to Python as daemon._native.EventQueue).
+ *
+ * A lock-free single-producer/single-consumer ring of preallocated
+ * slots plus an eventfd. The producer writes the eventfd only for the
+ * first event after the consumer last drained, so a burst of server
+ * events costs one main-loop wakeup, and drain() returns everything
+ * queued at once.
+ *
+ * Deltas bypass the ring: each fully replaces the previous one, so the
+ * producer keeps only the latest in a single slot (an atomic pointer).
+ * A newer delta or any ring event (a completion finalizes the segment)
+ * supersedes it, so at most one delta per drain reaches D-Bus and the
+ * work is bounded by the main loop's rate, not the server's. The slot
+ * records how many ring events preceded it; drain() leaves it for the
+ * next wakeup until those have been taken, preserving order.
+ */
+class EventQueue {
+public:
+    enum class Kind : uint8_t { Delta, Completed, Error, Exhausted };
+
+    struct Event {
+        Kind kind = Kind::Delta;
+        std::string text;
+        uint64_t capture_us = 0;
+        uint64_t send_us = 0;
+        uint64_t server_us = 0;
+        size_t after = 0;  // Delta slot: ring events pushed before it
+    };
+
+    /** Capacity is rounded up to a power of two. */
+    explicit EventQueue(size_t capacity = 1024);
+    ~EventQueue();
+
+    EventQueue(const EventQueue&) = delete;
+    EventQueue& operator=(const EventQueue&) = delete;
+
+    /** eventfd that becomes readable when events are queued. */
+    int fd() const { return fd_; }
+
+    /**
+     * Producer: queue an event (a delta replaces the pending one);
+     * false if the ring is full.
+     */
+    bool push(Event&& event);
+
+    /**
+     * Consumer: clear the wakeup and move all queued events into out
+     * (cleared first), the pending delta last.
+     */
+    void drain(std::vector<Event>& out);
+
+    /** Consumer: drop the pending delta (e.g. a new session starts). */
+    void clearDelta();
+
+    /** Deltas superseded before they were drained. */
+    uint64_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+private:
+    void notify();
+    void discardDelta(Event* delta);
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<Event[]> slots_;
+    int fd_ = -1;
+    std::atomic<uint64_t> dropped_{0};
+    alignas(64) std::atomic<size_t> head_{0};  // Written by producer
+    alignas(64) std::atomic<size_t> tail_{0};  // Written by consumer
+    alignas(64) std::atomic<Event*> delta_{nullptr};  // Latest delta
+    alignas(64) std::atomic<bool> notified_{false};  // eventfd written, not drained
+};
+
+} // namespace fcitx
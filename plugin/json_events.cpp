@@ -0,0 +1,296 @@
+#include "json_events.h"
+#include <cstdint>
+#include <cstring>
+
+namespace fcitx {
+
+namespace {
+
+constexpr std::string_view DELTA_TYPE =
+    "conversation.item.input_audio_transcription.delta";
+constexpr std::string_view COMPLETED_TYPE =
+    "conversation.item.input_audio_transcription.completed";
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+void skipSpace(std::string_view s, size_t& pos) {
+    while (pos < s.size() && isSpace(s[pos])) {
+        ++pos;
+    }
+}
+
+// Find the closing quote of the string whose contents start at begin.
+// Both searches are memchr, so plain text is scanned a word at a time.
+size_t findStringEnd(std::string_view s, size_t begin, bool& escaped) {
+    size_t pos = begin;
+    while (true) {
+        size_t quote = s.find('"', pos);
+        if (quote == std::string_view::npos) {
+            return quote;
+        }
+        size_t slashes = 0;
+        while (quote - slashes > begin && s[quote - slashes - 1] == '\\') {
+            ++slashes;
+        }
+        if (slashes % 2 == 0) {
+            escaped = std::memchr(s.data() + begin, '\\', quote - begin);
+            return quote;
+        }
+        pos = quote + 1;
+    }
+}
+
+// Skip a non-string value; pos ends on the delimiter that follows it
+bool skipValue(std::string_view s, size_t& pos) {
+    int depth = 0;
+    while (pos < s.size()) {
+        char c = s[pos];
+        if (c == '"') {
+            bool escaped = false;
+            size_t end = findStringEnd(s, pos + 1, escaped);
+            if (end == std::string_view::npos) {
+                return false;
+            }
+            pos = end + 1;
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            ++depth;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0) {
+                return true;
+            }
+            --depth;
+        } else if (c == ',' && depth == 0) {
+            return true;
+        }
+        ++pos;
+    }
+    return false;
+}
+
+bool parseHex4(std::string_view s, size_t pos, uint32_t& value) {
+    if (pos + 4 > s.size()) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = pos; i < pos + 4; ++i) {
+        char c = s[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') {
+            value |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            value |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            value |= c - 'A' + 10;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void appendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+} // namespace
+
+JsonObjectReader::JsonObjectReader(std::string_view json) : json_(json) {}
+
+bool JsonObjectReader::fail() {
+    error_ = true;
+    pos_ = json_.size();
+    return false;
+}
+
+bool JsonObjectReader::next() {
+    if (done_ || error_) {
+        return false;
+    }
+    skipSpace(json_, pos_);
+    if (!started_) {
+        started_ = true;
+        if (pos_ >= json_.size() || json_[pos_] != '{') {
+            return fail();
+        }
+        ++pos_;
+        skipSpace(json_, pos_);
+        if (pos_ < json_.size() && json_[pos_] == '}') {
+            done_ = true;
+            return false;
+        }
+    } else {
+        if (pos_ < json_.size() && json_[pos_] == '}') {
+            done_ = true;
+            return false;
+        }
+        if (pos_ >= json_.size() || json_[pos_] != ',') {
+            return fail();
+        }
+        ++pos_;
+        skipSpace(json_, pos_);
+    }
+
+    // "key"
+    if (pos_ >= json_.size() || json_[pos_] != '"') {
+        return fail();
+    }
+    bool escaped = false;
+    size_t end = findStringEnd(json_, pos_ + 1, escaped);
+    if (end == std::string_view::npos) {
+        return fail();
+    }
+    key_ = json_.substr(pos_ + 1, end - pos_ - 1);
+    pos_ = end + 1;
+
+    skipSpace(json_, pos_);
+    if (pos_ >= json_.size() || json_[pos_] != ':') {
+        return fail();
+    }
+    ++pos_;
+    skipSpace(json_, pos_);
+    if (pos_ >= json_.size()) {
+        return fail();
+    }
+
+    if (json_[pos_] == '"') {
+        end = findStringEnd(json_, pos_ + 1, escaped_);
+        if (end == std::string_view::npos) {
+            return fail();
+        }
+        is_string_ = true;
+        value_ = json_.substr(pos_ + 1, end - pos_ - 1);
+        pos_ = end + 1;
+        return true;
+    }
+
+    size_t begin = pos_;
+    if (!skipValue(json_, pos_)) {
+        return fail();
+    }
+    size_t value_end = pos_;
+    while (value_end > begin && isSpace(json_[value_end - 1])) {
+        --value_end;
+    }
+    is_string_ = false;
+    escaped_ = false;
+    value_ = json_.substr(begin, value_end - begin);
+    return true;
+}
+
+bool parseTranscriptionEvent(std::string_view json, TranscriptionEvent& event) {
+    event = {};
+    std::string_view delta;
+    std::string_view transcript;
+    bool delta_escaped = false;
+    bool transcript_escaped = false;
+    bool have_type = false;
+
+    JsonObjectReader reader(json);
+    while (reader.next()) {
+        if (!reader.isString()) {
+            continue;
+        }
+        std::string_view key = reader.key();
+        if (key == "type") {
+            event.type = reader.value();
+            have_type = true;
+        } else if (key == "delta") {
+            delta = reader.value();
+            delta_escaped = reader.escaped();
+        } else if (key == "transcript") {
+            transcript = reader.value();
+            transcript_escaped = reader.escaped();
+        }
+    }
+    if (reader.error() || !have_type) {
+        return false;
+    }
+
+    if (event.type == DELTA_TYPE) {
+        event.kind = TranscriptionEvent::Kind::Delta;
+        event.text = delta;
+        event.text_escaped = delta_escaped;
+    } else if (event.type == COMPLETED_TYPE) {
+        event.kind = TranscriptionEvent::Kind::Completed;
+        event.text = transcript;
+        event.text_escaped = transcript_escaped;
+    } else if (event.type == "error") {
+        event.kind = TranscriptionEvent::Kind::Error;
+    }
+    return true;
+}
+
+bool appendJsonUnescaped(std::string_view raw, std::string& out) {
+    size_t pos = 0;
+    while (pos < raw.size()) {
+        size_t slash = raw.find('\\', pos);
+        if (slash == std::string_view::npos) {
+            out.append(raw.substr(pos));
+            return true;
+        }
+        out.append(raw.substr(pos, slash - pos));
+        if (slash + 1 >= raw.size()) {
+            return false;
+        }
+        pos = slash + 2;
+        uint32_t cp = 0;
+        switch (raw[slash + 1]) {
+        case 'n': cp = '\n'; break;
+        case 't': cp = '\t'; break;
+        case 'r': cp = '\r'; break;
+        case 'b': cp = '\b'; break;
+        case 'f': cp = '\f'; break;
+        case 'u':
+            if (!parseHex4(raw, pos, cp)) {
+                return false;
+            }
+            pos += 4;
+            if (cp < 0xD800 || cp >= 0xE000) {
+                break;
+            }
+            // Combine a surrogate pair into one code point; a surrogate
+            // without its other half has no UTF-8 form
+            if (cp < 0xDC00 && pos + 1 < raw.size() && raw[pos] == '\\' &&
+                raw[pos + 1] == 'u') {
+                uint32_t low;
+                if (parseHex4(raw, pos + 2, low) && low >= 0xDC00 &&
+                    low < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 6;
+                    break;
+                }
+            }
+            cp = 0xFFFD;
+            break;
+        case '"':
+        case '\\':
+        case '/':
+            cp = static_cast<unsigned char>(raw[slash + 1]);
+            break;
+        default:
+            return false;
+        }
+        appendUtf8(out, cp);
+    }
+    return true;
+}
+
+} // namespace fcitx
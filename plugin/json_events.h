@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace fcitx {
+
+/**
+ * Pull parser over the top-level members of one JSON object.
+ *
+ * Each next() steps to the following member and exposes its key and
+ * value as views into the input; strings are returned raw (without the
+ * quotes, escapes not decoded) and nested objects and arrays are skipped
+ * without being materialized. Nothing is allocated.
+ *
+ * This is a scanner for trusted, well-formed server messages rather than
+ * a validator: structural errors are reported, but e.g. bad literals in
+ * skipped values are not.
+ */
+class JsonObjectReader {
+public:
+    explicit JsonObjectReader(std::string_view json);
+
+    /**
+     * Advance to the next member. Returns false at the end of the object
+     * or on malformed input (then error() is true).
+     */
+    bool next();
+
+    /** Raw key of the current member. */
+    std::string_view key() const { return key_; }
+    /** Raw string contents, or the value's text if it is not a string. */
+    std::string_view value() const { return value_; }
+    bool isString() const { return is_string_; }
+    /** The string value contains backslash escapes (see appendJsonUnescaped). */
+    bool escaped() const { return escaped_; }
+    bool error() const { return error_; }
+
+private:
+    bool fail();
+
+    std::string_view json_;
+    size_t pos_ = 0;
+    bool started_ = false;
+    bool done_ = false;
+    std::string_view key_;
+    std::string_view value_;
+    bool is_string_ = false;
+    bool escaped_ = false;
+    bool error_ = false;
+};
+
+/**
+ * Server event of the Riva realtime protocol, as far as the clients act
+ * on it. Views point into the parsed message.
+ */
+struct TranscriptionEvent {
+    enum class Kind { Other, Delta, Completed, Error };
+
+    Kind kind = Kind::Other;
+    std::string_view type;      // Raw "type" member
+    std::string_view text;      // Raw "delta" (Delta) or "transcript" (Completed)
+    bool text_escaped = false;  // text needs appendJsonUnescaped()
+};
+
+/**
+ * Classify a server message and locate its transcript text. Returns
+ * false if it is not a JSON object with a string "type" member.
+ */
+bool parseTranscriptionEvent(std::string_view json, TranscriptionEvent& event);
+
+/**
+ * Append the decoded UTF-8 of raw JSON string contents (\uXXXX escapes
+ * and surrogate pairs included; a lone surrogate becomes U+FFFD).
+ * Returns false on a malformed or unknown escape.
+ */
+bool appendJsonUnescaped(std::string_view raw, std::string& out);
+
+} // namespace fcitx
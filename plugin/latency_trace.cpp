@@ -0,0 +1,84 @@
+#include "latency_trace.h"
+#include <cstdio>
+
+namespace fcitx {
+
+namespace {
+
+constexpr const char* STAGE_NAMES[] = {"send",    "server", "daemon",
+                                       "dbus",    "display", "total"};
+
+// Duration between two stamps, or -1 when either is missing or they are
+// out of order
+int64_t span(uint64_t from, uint64_t to) {
+    if (from == 0 || to == 0 || to < from) {
+        return -1;
+    }
+    return static_cast<int64_t>(to - from);
+}
+
+} // namespace
+
+void LatencyTracer::record(Event event, const TraceStamps& stamps,
+                           uint64_t display_us) {
+    const int64_t spans[STAGE_COUNT] = {
+        span(stamps.capture_us, stamps.send_us),
+        span(stamps.send_us, stamps.server_us),
+        span(stamps.server_us, stamps.emit_us),
+        span(stamps.emit_us, stamps.receive_us),
+        span(stamps.receive_us, display_us),
+        span(stamps.capture_us, display_us),
+    };
+    auto& histograms = histograms_[static_cast<size_t>(event)];
+    for (size_t stage = 0; stage < STAGE_COUNT; ++stage) {
+        if (spans[stage] >= 0) {
+            histograms[stage].record(spans[stage]);
+        }
+    }
+}
+
+void LatencyTracer::reset() {
+    for (auto& histograms : histograms_) {
+        for (auto& histogram : histograms) {
+            histogram.reset();
+        }
+    }
+}
+
+uint64_t LatencyTracer::count(Event event) const {
+    // Every recorded event has a receive stamp, so display sees them all
+    return histograms_[static_cast<size_t>(event)][Display].count();
+}
+
+const LatencyHistogram& LatencyTracer::histogram(Event event,
+                                                 Stage stage) const {
+    return histograms_[static_cast<size_t>(event)][stage];
+}
+
+std::string LatencyTracer::summary() const {
+    std::string out;
+    char buf[64];
+    for (auto event : {Event::Delta, Event::Commit}) {
+        if (!out.empty()) {
+            out += '\n';
+        }
+        std::snprintf(buf, sizeof(buf), "%s n=%llu",
+                      event == Event::Delta ? "delta" : "commit",
+                      static_cast<unsigned long long>(count(event)));
+        out += buf;
+        for (size_t stage = 0; stage < STAGE_COUNT; ++stage) {
+            const auto& h = histogram(event, static_cast<Stage>(stage));
+            if (h.count() == 0) {
+                continue;
+            }
+            std::snprintf(buf, sizeof(buf), " %s=%.1f/%.1f/%.1f",
+                          STAGE_NAMES[stage], h.percentile(0.5) / 1000.0,
+                          h.percentile(0.95) / 1000.0, h.max() / 1000.0);
+            out += buf;
+        }
+    }
+    out += " (ms p50/p95/max)";
+    return out;
+}
+
+} // namespace fcitx
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "stats.h"
+
+namespace fcitx {
+
+/**
+ * CLOCK_MONOTONIC timestamps (microseconds) of one transcription event,
+ * as carried by the daemon's *Traced signals (fcitx5-voice-daemon
+ * --trace) and completed by the plugin on receipt.
+ */
+struct TraceStamps {
+    uint64_t capture_us = 0;  // Newest audio the result can cover captured
+    uint64_t send_us = 0;     // That audio sent to the ASR server
+    uint64_t server_us = 0;   // Server event received by the daemon
+    uint64_t emit_us = 0;     // D-Bus signal emitted
+    uint64_t receive_us = 0;  // D-Bus signal dispatched in the plugin
+};
+
+/**
+ * Per-stage latency of traced transcription events, from audio capture
+ * to the preedit repaint (deltas) or commitString (completions).
+ */
+class LatencyTracer {
+public:
+    enum class Event { Delta, Commit };
+
+    enum Stage {
+        Send,     // capture -> send
+        Server,   // send -> server event
+        Daemon,   // server event -> signal emitted
+        Bus,      // emitted -> received by the plugin
+        Display,  // received -> shown (includes preedit coalescing)
+        Total,    // capture -> shown
+        STAGE_COUNT,
+    };
+
+    /**
+     * Record an event shown at display_us. Stamps the daemon could not
+     * fill (0) skip the stages that depend on them.
+     */
+    void record(Event event, const TraceStamps& stamps, uint64_t display_us);
+    void reset();
+
+    uint64_t count(Event event) const;
+    const LatencyHistogram& histogram(Event event, Stage stage) const;
+
+    /** One line per event kind: count, then p50/p95/max per stage in ms. */
+    std::string summary() const;
+
+private:
+    std::array<std::array<LatencyHistogram, STAGE_COUNT>, 2> histograms_;
+};
+
+} // namespace fcitx
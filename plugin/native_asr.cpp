@@ -0,0 +1,392 @@
+#include "native_asr.h"
+#include "json_events.h"
+#include <fcitx-utils/log.h>
+#include <cstdio>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace fcitx {
+
+namespace {
+
+constexpr uint64_t CONNECT_TIMEOUT_US = 10000000;  // Handshake + session setup
+constexpr uint64_t FINISH_TIMEOUT_US = 3000000;    // Wait for final transcripts
+
+constexpr std::string_view TRANSCRIPTION_PATH =
+    "/v1/realtime?intent=transcription";
+
+void appendJsonString(std::string& out, std::string_view s) {
+    out.push_back('"');
+    for (char c : s) {
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escape[7];
+                std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+                out += escape;
+            } else {
+                out.push_back(c);
+            }
+        }
+    }
+    out.push_back('"');
+}
+
+// Same cleanup as the daemon's _clean_text(): the Japanese model emits
+// space-separated characters.
+void cleanText(std::string& text, const std::string& language) {
+    if (language.compare(0, 2, "ja") == 0) {
+        std::erase(text, ' ');
+        return;
+    }
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+        text.clear();
+        return;
+    }
+    text.erase(text.find_last_not_of(" \t\r\n") + 1);
+    text.erase(0, begin);
+}
+
+// Decode an event's transcript into text and clean it up like the
+// daemon's _clean_text()
+bool decodeText(const TranscriptionEvent& event, const std::string& language,
+                std::string& text) {
+    text.clear();
+    if (!event.text_escaped) {
+        text.append(event.text);
+    } else if (!appendJsonUnescaped(event.text, text)) {
+        return false;
+    }
+    cleanText(text, language);
+    return true;
+}
+
+} // namespace
+
+NativeAsrClient::NativeAsrClient(EventLoop* loop, Options options,
+                                 std::unique_ptr<AudioSource> source)
+    : loop_(loop), options_(std::move(options)), source_(std::move(source)),
+      chunk_(source_->chunkSamples()) {
+    size_t frame_samples = source_->sampleRate() * options_.frame_ms / 1000;
+    if (frame_samples == 0 || chunk_.empty() ||
+        chunk_.size() % frame_samples != 0) {
+        throw std::runtime_error("Audio chunks must be whole " +
+                                 std::to_string(options_.frame_ms) +
+                                 " ms VAD frames");
+    }
+    ws_.setOpenCallback([this]() { onOpen(); });
+    ws_.setMessageCallback(
+        [this](std::string_view message) { onMessage(message); });
+    ws_.setCloseCallback(
+        [this](const std::string& reason) { onClosed(reason); });
+}
+
+NativeAsrClient::~NativeAsrClient() {
+    ws_.close();
+    source_->stop();
+}
+
+void NativeAsrClient::start() {
+    if (state_ != State::Idle) {
+        throw std::runtime_error("Previous session is still active");
+    }
+
+    source_->start();
+    std::string url = options_.url;
+    while (!url.empty() && url.back() == '/') {
+        url.pop_back();
+    }
+    try {
+        ws_.connect(url + std::string(TRANSCRIPTION_PATH));
+    } catch (...) {
+        source_->stop();
+        throw;
+    }
+
+    append_frame_.reset();
+
+    state_ = State::Connecting;
+    update_sent_ = false;
+    chunks_since_commit_ = 0;
+    pending_commits_ = 0;
+
+    socket_event_ = loop_->addIOEvent(
+        ws_.fd(), IOEventFlag::In | IOEventFlag::Out,
+        [this](EventSourceIO*, int, IOEventFlags flags) {
+            ws_.handleEvents(
+                flags.test(IOEventFlag::In) || flags.test(IOEventFlag::Hup) ||
+                    flags.test(IOEventFlag::Err),
+                flags.test(IOEventFlag::Out));
+            updateSocketEvents();
+            return true;
+        });
+
+    // Audio queues up in the source until the session is configured
+    if (!audio_event_) {
+        audio_event_ = loop_->addIOEvent(
+            source_->eventFd(), IOEventFlag::In,
+            [this](EventSourceIO*, int, IOEventFlags) {
+                onAudio();
+                return true;
+            });
+    }
+    audio_event_->setEnabled(false);
+
+    armTimer(CONNECT_TIMEOUT_US);
+    FCITX_DEBUG() << "Native ASR: connecting to " << url;
+}
+
+void NativeAsrClient::stop() {
+    switch (state_) {
+    case State::Idle:
+    case State::Finishing:
+        return;
+    case State::Connecting:
+    case State::Configuring:
+        // Nothing was streamed yet
+        endSession();
+        return;
+    case State::Streaming:
+        break;
+    }
+
+    // Send what is already queued, then close the utterance
+    sendQueuedAudio();
+    if (state_ != State::Streaming) {
+        return;  // Connection failed while sending
+    }
+    source_->stop();
+    audio_event_->setEnabled(false);
+    if (chunks_since_commit_ > 0) {
+        sendCommit();
+        if (state_ != State::Streaming) {
+            return;
+        }
+    }
+
+    if (pending_commits_ == 0) {
+        endSession();
+        return;
+    }
+    state_ = State::Finishing;
+    armTimer(FINISH_TIMEOUT_US);
+}
+
+void NativeAsrClient::onOpen() {
+    state_ = State::Configuring;
+    FCITX_DEBUG() << "Native ASR: WebSocket open";
+}
+
+void NativeAsrClient::onMessage(std::string_view message) {
+    TranscriptionEvent event;
+    if (!parseTranscriptionEvent(message, event)) {
+        FCITX_WARN() << "Native ASR: ignoring malformed event";
+        return;
+    }
+
+    if (event.kind == TranscriptionEvent::Kind::Error) {
+        FCITX_ERROR() << "Server error: " << message;
+        fail(std::string(message));
+        return;
+    }
+
+    if (state_ == State::Configuring) {
+        if (!update_sent_) {
+            if (event.type != "conversation.created") {
+                fail("Unexpected init message: " + std::string(event.type));
+                return;
+            }
+            sendSessionUpdate();
+            return;
+        }
+
+        // Any non-error reply to the update means the session is ready
+        state_ = State::Streaming;
+        segmenter_.emplace(
+            EnergyVad(source_->sampleRate(), {.frame_ms = options_.frame_ms}),
+            options_.silence_commit_ms);
+        source_->drain();  // Discard audio captured while connecting
+        audio_event_->setEnabled(true);
+        timer_->setEnabled(false);
+        FCITX_DEBUG() << "Native ASR: session configured (model="
+                      << options_.model << ", language=" << options_.language
+                      << ")";
+        if (ready_callback_) {
+            ready_callback_();
+        }
+        return;
+    }
+
+    if (event.kind == TranscriptionEvent::Kind::Delta) {
+        if (decodeText(event, options_.language, text_) && !text_.empty() &&
+            delta_callback_) {
+            delta_callback_(text_);
+        }
+    } else if (event.kind == TranscriptionEvent::Kind::Completed) {
+        if (!decodeText(event, options_.language, text_)) {
+            text_.clear();
+        }
+        if (pending_commits_ > 0) {
+            --pending_commits_;
+        }
+        if (complete_callback_) {
+            complete_callback_(text_);
+        }
+        if (state_ == State::Finishing && pending_commits_ == 0) {
+            endSession();
+        }
+    }
+}
+
+void NativeAsrClient::onClosed(const std::string& reason) {
+    if (state_ == State::Finishing) {
+        // Server hung up after the last commit; nothing more will arrive
+        FCITX_WARN() << "Native ASR: " << reason << " with " << pending_commits_
+                     << " commit(s) unanswered";
+        endSession();
+        return;
+    }
+    if (state_ == State::Connecting) {
+        fail("ASR サーバーに接続できません: " + reason);
+        return;
+    }
+    fail("ASR サーバーとの接続が切れました: " + reason);
+}
+
+void NativeAsrClient::onAudio() {
+    uint64_t counter;
+    while (read(source_->eventFd(), &counter, sizeof(counter)) > 0) {
+    }
+
+    sendQueuedAudio();
+    if (state_ == State::Streaming && source_->exhausted()) {
+        FCITX_INFO() << "Native ASR: audio source exhausted";
+        stop();
+    }
+}
+
+void NativeAsrClient::sendQueuedAudio() {
+    while (state_ == State::Streaming && source_->readChunk(chunk_.data())) {
+        sendAppend(chunk_.data(), chunk_.size());
+        ++chunks_since_commit_;
+
+        if (segmenter_->feed(chunk_.data(), chunk_.size()) !=
+            Segmenter::Action::None) {
+            sendCommit();
+        }
+    }
+}
+
+void NativeAsrClient::sendAppend(const int16_t* samples, size_t n) {
+    ws_.sendText(append_frame_.build(reinterpret_cast<const uint8_t*>(samples),
+                                     n * 2));
+    updateSocketEvents();
+}
+
+void NativeAsrClient::sendCommit() {
+    message_.clear();
+    message_ += R"({"event_id":")";
+    message_ += append_frame_.nextEventId();
+    message_ += R"(","type":"input_audio_buffer.commit"})";
+    ws_.sendText(message_);
+    updateSocketEvents();
+    ++pending_commits_;
+    chunks_since_commit_ = 0;
+}
+
+void NativeAsrClient::sendSessionUpdate() {
+    message_.clear();
+    message_ += R"({"event_id":")";
+    message_ += append_frame_.nextEventId();
+    message_ += R"(","type":"transcription_session.update",)"
+                R"("session":{"input_audio_format":"pcm16",)"
+                R"("input_audio_transcription":{"language":)";
+    appendJsonString(message_, options_.language);
+    message_ += R"(,"model":)";
+    appendJsonString(message_, options_.model);
+    message_ += R"(},"recognition_config":{)"
+                R"("enable_automatic_punctuation":true,)"
+                R"("enable_verbatim_transcripts":false}}})";
+    ws_.sendText(message_);
+    updateSocketEvents();
+    update_sent_ = true;
+}
+
+void NativeAsrClient::updateSocketEvents() {
+    if (!socket_event_ || ws_.state() == WebSocketClient::State::Closed) {
+        return;
+    }
+    socket_event_->setEvents(ws_.wantsWrite()
+                                 ? IOEventFlag::In | IOEventFlag::Out
+                                 : IOEventFlags(IOEventFlag::In));
+}
+
+void NativeAsrClient::armTimer(uint64_t usec) {
+    uint64_t deadline = now(CLOCK_MONOTONIC) + usec;
+    if (timer_) {
+        timer_->setTime(deadline);
+        timer_->setOneShot();
+        return;
+    }
+    timer_ = loop_->addTimeEvent(
+        CLOCK_MONOTONIC, deadline, 0, [this](EventSourceTime*, uint64_t) {
+            if (state_ == State::Finishing) {
+                FCITX_WARN() << "Native ASR: " << pending_commits_
+                             << " commit(s) unanswered at shutdown";
+                endSession();
+            } else if (state_ != State::Idle) {
+                fail("ASR サーバーへの接続がタイムアウトしました");
+            }
+            return true;
+        });
+}
+
+void NativeAsrClient::fail(const std::string& message) {
+    bool active = state_ != State::Idle;
+    closeSession();
+    if (active && error_callback_) {
+        error_callback_(message);
+    }
+}
+
+void NativeAsrClient::endSession() {
+    closeSession();
+    FCITX_DEBUG() << "Native ASR: session ended";
+    if (finished_callback_) {
+        finished_callback_();
+    }
+}
+
+void NativeAsrClient::closeSession() {
+    ws_.close();
+    source_->stop();
+    // Disabled rather than destroyed: this may run inside their callbacks
+    if (socket_event_) {
+        socket_event_->setEnabled(false);
+    }
+    if (audio_event_) {
+        audio_event_->setEnabled(false);
+    }
+    if (timer_) {
+        timer_->setEnabled(false);
+    }
+    state_ = State::Idle;
+}
+
+} // namespace fcitx
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <fcitx-utils/event.h>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "append_frame.h"
+#include "audio_source.h"
+#include "segmenter.h"
+#include "websocket.h"
+
+namespace fcitx {
+
+/**
+ * In-process streaming client for the NIM Riva realtime transcription
+ * protocol, the native counterpart of the daemon's RivaWSClient plus its
+ * send loop.
+ *
+ * Everything runs on the fcitx event loop: the socket and the audio
+ * source's eventfd are watched with IO events, so a transcription event
+ * goes from the socket straight to the callbacks without a thread hop or
+ * a D-Bus round trip. Commits are placed by an energy Segmenter, as in
+ * the daemon.
+ *
+ * Callbacks run from event loop dispatch (or from stop()) and must not
+ * destroy the client.
+ */
+class NativeAsrClient {
+public:
+    struct Options {
+        std::string url = "ws://localhost:9000";
+        std::string model =
+            "parakeet-rnnt-1.1b-unified-ml-cs-universal-multi-asr-streaming";
+        std::string language = "ja-JP";
+        unsigned frame_ms = 10;            // VAD frame
+        unsigned chunk_ms = 20;            // Source chunk, whole VAD frames
+        unsigned silence_commit_ms = 150;  // Silence after speech before commit
+    };
+
+    enum class State {
+        Idle,
+        Connecting,   // TCP connect and WebSocket handshake
+        Configuring,  // Waiting for conversation.created / session.updated
+        Streaming,
+        Finishing,    // Final commit sent, waiting for the last transcripts
+    };
+
+    using ReadyCallback = std::function<void()>;
+    using TextCallback = std::function<void(const std::string& text)>;
+    using ErrorCallback = std::function<void(const std::string& message)>;
+    using FinishedCallback = std::function<void()>;
+
+    /**
+     * source must deliver chunks of options.chunk_ms: the segmenter
+     * decides commits once per chunk, like the daemon.
+     * @throws std::runtime_error if its chunks are not whole VAD frames
+     */
+    NativeAsrClient(EventLoop* loop, Options options,
+                    std::unique_ptr<AudioSource> source);
+    ~NativeAsrClient();
+
+    NativeAsrClient(const NativeAsrClient&) = delete;
+    NativeAsrClient& operator=(const NativeAsrClient&) = delete;
+
+    /** Session configured; audio is being streamed. */
+    void setReadyCallback(ReadyCallback cb) { ready_callback_ = std::move(cb); }
+    void setDeltaCallback(TextCallback cb) { delta_callback_ = std::move(cb); }
+    void setCompleteCallback(TextCallback cb) {
+        complete_callback_ = std::move(cb);
+    }
+    /** The session failed and has ended; no finished callback follows. */
+    void setErrorCallback(ErrorCallback cb) { error_callback_ = std::move(cb); }
+    /** The session ended normally (after stop() or when a finite source runs out). */
+    void setFinishedCallback(FinishedCallback cb) {
+        finished_callback_ = std::move(cb);
+    }
+
+    /**
+     * Start capturing and connect. Returns immediately; the ready
+     * callback fires once the session is configured.
+     * @throws std::runtime_error if a session is still active or the
+     *         source/connection cannot be started
+     */
+    void start();
+
+    /**
+     * Stop capturing. Queued audio is sent with a final commit and the
+     * connection stays open until every commit has been answered (or
+     * FINISH_TIMEOUT passes). A session that is still connecting is
+     * dropped.
+     */
+    void stop();
+
+    State state() const { return state_; }
+    const Options& options() const { return options_; }
+
+private:
+    void onOpen();
+    void onMessage(std::string_view message);
+    void onClosed(const std::string& reason);
+    void onAudio();
+    void sendQueuedAudio();
+    void sendAppend(const int16_t* samples, size_t n);
+    void sendCommit();
+    void sendSessionUpdate();
+    void updateSocketEvents();
+    void armTimer(uint64_t usec);
+    void fail(const std::string& message);
+    void endSession();
+    void closeSession();
+
+    EventLoop* loop_;
+    Options options_;
+    std::unique_ptr<AudioSource> source_;
+    WebSocketClient ws_;
+    std::optional<Segmenter> segmenter_;
+    std::unique_ptr<EventSourceIO> socket_event_;
+    std::unique_ptr<EventSourceIO> audio_event_;
+    std::unique_ptr<EventSourceTime> timer_;  // Connect / finish deadline
+    State state_ = State::Idle;
+    bool update_sent_ = false;
+    unsigned chunks_since_commit_ = 0;
+    unsigned pending_commits_ = 0;  // Commits without a completed event yet
+    std::vector<int16_t> chunk_;
+    AppendFrame append_frame_;      // Audio messages and the event ids
+    std::string message_;           // Reused buffer for other messages
+    std::string text_;              // Reused decoded transcript
+
+    ReadyCallback ready_callback_;
+    TextCallback delta_callback_;
+    TextCallback complete_callback_;
+    ErrorCallback error_callback_;
+    FinishedCallback finished_callback_;
+};
+
+} // namespace fcitx
@@ -0,0 +1,109 @@
+#include "pcm_ring.h"
+#include "audio_energy.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fcitx {
+
+double AudioLevel::rmsDb() const {
+    if (rms <= 0.0) {
+        return -96.0;
+    }
+    return std::clamp(20.0 * std::log10(rms / 32768.0), -96.0, 0.0);
+}
+
+PcmRingReader::PcmRingReader(int fd) : fd_(fd) {
+    struct stat st;
+    if (fstat(fd_, &st) < 0 ||
+        static_cast<size_t>(st.st_size) < pcm_ring::DATA_OFFSET) {
+        close(fd_);
+        throw std::runtime_error("PCM ring fd is too small");
+    }
+
+    map_size_ = st.st_size;
+    map_ = mmap(nullptr, map_size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (map_ == MAP_FAILED) {
+        map_ = nullptr;
+        close(fd_);
+        throw std::runtime_error(std::string("Failed to map PCM ring: ") +
+                                 std::strerror(errno));
+    }
+
+    const auto* header = static_cast<const uint32_t*>(map_);
+    uint32_t magic = header[0];
+    uint32_t version = header[1];
+    sample_rate_ = header[2];
+    capacity_ = header[3];
+
+    bool valid = magic == pcm_ring::MAGIC && version == pcm_ring::VERSION &&
+                 capacity_ > 0 && (capacity_ & (capacity_ - 1)) == 0 &&
+                 pcm_ring::DATA_OFFSET + capacity_ * sizeof(int16_t) <=
+                     map_size_;
+    if (!valid) {
+        munmap(map_, map_size_);
+        map_ = nullptr;
+        close(fd_);
+        throw std::runtime_error("PCM ring header is invalid");
+    }
+
+    data_ = reinterpret_cast<const int16_t*>(
+        static_cast<const char*>(map_) + pcm_ring::DATA_OFFSET);
+    read_pos_ = loadWritePos();
+}
+
+PcmRingReader::~PcmRingReader() {
+    if (map_) {
+        munmap(map_, map_size_);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+uint64_t PcmRingReader::loadWritePos() const {
+    const auto* pos = reinterpret_cast<const uint64_t*>(
+        static_cast<const char*>(map_) + pcm_ring::WRITE_POS_OFFSET);
+    // Pairs with the producer's store after it has written the samples
+    return __atomic_load_n(pos, __ATOMIC_ACQUIRE);
+}
+
+AudioLevel PcmRingReader::readLevel(size_t max_samples) {
+    AudioLevel level;
+    uint64_t write_pos = loadWritePos();
+    if (write_pos <= read_pos_) {
+        // Nothing new (or the daemon restarted the ring from zero)
+        read_pos_ = write_pos;
+        return level;
+    }
+
+    // Keep half the ring as headroom so the producer cannot lap the
+    // samples being read in the common case.
+    uint64_t available = write_pos - read_pos_;
+    size_t count = static_cast<size_t>(std::min<uint64_t>(
+        available, std::min<size_t>(max_samples, capacity_ / 2)));
+    uint64_t start = write_pos - count;
+    read_pos_ = write_pos;
+
+    size_t mask = capacity_ - 1;
+    size_t first = start & mask;
+    size_t first_len = std::min<size_t>(count, capacity_ - first);
+    EnergyStats stats = computeEnergy(data_ + first, first_len);
+    if (first_len < count) {
+        EnergyStats wrapped = computeEnergy(data_, count - first_len);
+        stats.merge(wrapped, (data_[mask] ^ data_[0]) < 0);
+    }
+
+    level.samples = count;
+    level.peak = stats.peak;
+    level.rms = stats.rms();
+    return level;
+}
+
+} // namespace fcitx
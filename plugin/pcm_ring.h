@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fcitx {
+
+/**
+ * Shared-memory PCM16 ring written by the daemon (daemon/pcm_ring.py).
+ *
+ * Layout of the memfd (all fields little-endian):
+ *   0   u32 magic ("VPCM")
+ *   4   u32 version
+ *   8   u32 sample rate
+ *   12  u32 capacity in samples (power of two)
+ *   64  u64 write position (total samples ever written)
+ *   128 int16 samples[capacity]
+ *
+ * The daemon is the only writer: it stores samples first and then
+ * publishes the new write position. Readers never write to the mapping,
+ * and the producer never waits for them (old samples are overwritten).
+ */
+namespace pcm_ring {
+constexpr uint32_t MAGIC = 0x4D435056;  // "VPCM"
+constexpr uint32_t VERSION = 1;
+constexpr size_t WRITE_POS_OFFSET = 64;
+constexpr size_t DATA_OFFSET = 128;
+} // namespace pcm_ring
+
+/**
+ * Audio level over a window of samples.
+ */
+struct AudioLevel {
+    size_t samples = 0;  // Number of samples the level was computed over
+    int peak = 0;        // Absolute peak (0..32768)
+    double rms = 0.0;    // Root mean square (0..32768)
+
+    /** RMS in dBFS, clamped to [-96, 0]. */
+    double rmsDb() const;
+};
+
+/**
+ * Read-only, zero-copy view of the daemon's PCM ring.
+ */
+class PcmRingReader {
+public:
+    /**
+     * Map the ring. Takes ownership of fd.
+     * @throws std::runtime_error if the fd is not a valid ring
+     */
+    explicit PcmRingReader(int fd);
+    ~PcmRingReader();
+
+    PcmRingReader(const PcmRingReader&) = delete;
+    PcmRingReader& operator=(const PcmRingReader&) = delete;
+
+    /**
+     * Compute the level of samples written since the previous call,
+     * limited to the newest max_samples. Reads directly from the mapping.
+     * Returns samples == 0 if nothing new was written.
+     */
+    AudioLevel readLevel(size_t max_samples);
+
+    uint32_t sampleRate() const { return sample_rate_; }
+
+private:
+    uint64_t loadWritePos() const;
+
+    int fd_ = -1;
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    const int16_t* data_ = nullptr;
+    uint32_t sample_rate_ = 0;
+    uint32_t capacity_ = 0;
+    uint64_t read_pos_ = 0;
+};
+
+} // namespace fcitx
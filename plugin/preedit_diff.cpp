@@ -0,0 +1,139 @@
+#include "preedit_diff.h"
+#include <algorithm>
+
+namespace fcitx {
+
+namespace {
+
+bool isContinuation(std::string_view s, size_t pos) {
+    return pos < s.size() &&
+           (static_cast<unsigned char>(s[pos]) & 0xC0) == 0x80;
+}
+
+bool isAsciiWordChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '\'';
+}
+
+} // namespace
+
+size_t utf8CommonPrefix(std::string_view a, std::string_view b) {
+    size_t n = std::min(a.size(), b.size());
+    size_t i = std::mismatch(a.begin(), a.begin() + n, b.begin()).first -
+               a.begin();
+    // Back off from the middle of a multi-byte sequence
+    while (i > 0 && (isContinuation(a, i) || isContinuation(b, i))) {
+        --i;
+    }
+    return i;
+}
+
+size_t wordSafeLength(std::string_view text, size_t length) {
+    if (length == 0 || !isAsciiWordChar(text[length - 1]) ||
+        (length < text.size() && !isAsciiWordChar(text[length]))) {
+        return length;
+    }
+    while (length > 0 && isAsciiWordChar(text[length - 1])) {
+        --length;
+    }
+    return length;
+}
+
+size_t committedLength(std::string_view committed, std::string_view text) {
+    if (text.starts_with(committed)) {
+        return committed.size();
+    }
+    if (committed.size() >= text.size()) {
+        return text.size();
+    }
+    size_t length = committed.size();
+    while (isContinuation(text, length)) {
+        ++length;
+    }
+    // Finish a word the revision runs on ("hello" -> "helloworld")
+    while (length > 0 && length < text.size() &&
+           isAsciiWordChar(text[length - 1]) && isAsciiWordChar(text[length])) {
+        ++length;
+    }
+    return length;
+}
+
+PreeditDiff::Update PreeditDiff::update(std::string_view text) {
+    Update result;
+    if (text == text_) {
+        result.stable = text_.size();
+        return result;
+    }
+    result.changed = true;
+    result.stable = utf8CommonPrefix(text_, text);
+    text_.assign(text);
+    return result;
+}
+
+void PreeditDiff::reset() {
+    text_.clear();
+}
+
+size_t StableHorizon::update(std::string_view text, uint64_t now) {
+    size_t common = utf8CommonPrefix(text_, text);
+    ++update_count_;
+
+    // Prefixes longer than the common part were revised: cut them off
+    auto it = runs_.begin();
+    size_t previous = 0;
+    while (it != runs_.end() && it->length <= common) {
+        previous = it->length;
+        ++it;
+    }
+    if (it != runs_.end()) {
+        if (common > previous) {
+            it->length = common;  // Keeps its age
+            ++it;
+        }
+        runs_.erase(it, runs_.end());
+    }
+    if (text.size() > common) {
+        runs_.push_back({text.size(), update_count_, now});
+    }
+    text_.assign(text);
+    return stable(now);
+}
+
+bool StableHorizon::isStable(const Run& run, uint64_t now) const {
+    // The update that introduced a run counts as its first
+    bool by_count = update_count_ - run.since_update + 1 >= updates_;
+    bool by_time = usec_ > 0 && now - run.since_time >= usec_;
+    return by_count || by_time;
+}
+
+size_t StableHorizon::stable(uint64_t now) const {
+    // Longest prefix old enough by either measure; older runs come first
+    size_t stable = 0;
+    for (const auto& run : runs_) {
+        if (!isStable(run, now)) {
+            break;
+        }
+        stable = run.length;
+    }
+    return stable;
+}
+
+uint64_t StableHorizon::deadline(uint64_t now) const {
+    if (usec_ == 0) {
+        return 0;
+    }
+    // The oldest run not yet stable holds back all younger ones
+    for (const auto& run : runs_) {
+        if (!isStable(run, now)) {
+            return run.since_time + usec_;
+        }
+    }
+    return 0;
+}
+
+void StableHorizon::reset() {
+    text_.clear();
+    runs_.clear();
+}
+
+} // namespace fcitx
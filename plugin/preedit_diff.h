@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fcitx {
+
+/**
+ * Length in bytes of the longest common prefix of a and b that ends on
+ * a UTF-8 code point boundary in both.
+ */
+size_t utf8CommonPrefix(std::string_view a, std::string_view b);
+
+/**
+ * Move an early commit point of length bytes off the middle of an ASCII
+ * word, which the recognizer may still extend ("hel" -> "hello").
+ * Japanese text has no word separators and is committed as is.
+ */
+size_t wordSafeLength(std::string_view text, size_t length);
+
+/**
+ * Bytes of text that stand for committed, a prefix of an earlier
+ * partial result of the same segment that was committed already. That
+ * is all of committed while text still extends it. After the server
+ * revised it ("hello " -> "Hello world."), the revision cannot be taken
+ * back from the application, so the same number of bytes is skipped,
+ * moved forward to a code point and word boundary, and only the rest is
+ * new.
+ */
+size_t committedLength(std::string_view committed, std::string_view text);
+
+/**
+ * Diffs successive partial results against the last one shown.
+ *
+ * The server resends the whole partial text every time; the part shared
+ * with the previous text is "stable" and the rest is the volatile tail
+ * the recognizer may still revise.
+ */
+class PreeditDiff {
+public:
+    struct Update {
+        bool changed = false;  // Differs from the text shown before
+        size_t stable = 0;     // Bytes of the stable prefix
+    };
+
+    /** Diff text against the current one and make it current. */
+    Update update(std::string_view text);
+
+    /** Forget the current text (the preedit was cleared or committed). */
+    void reset();
+
+    const std::string& text() const { return text_; }
+
+private:
+    std::string text_;
+};
+
+/**
+ * Stability horizon over successive partial results of one segment:
+ * the longest prefix that has been present unchanged in the last N
+ * updates or for T microseconds (T = 0 disables the time limit), which
+ * is safe to commit before the segment is finalized.
+ */
+class StableHorizon {
+public:
+    StableHorizon(unsigned updates, uint64_t usec)
+        : updates_(updates), usec_(usec) {}
+
+    /**
+     * Feed the newest partial text received at time now (monotonic usec)
+     * and return the length in bytes of its stable prefix (on a code
+     * point boundary).
+     */
+    size_t update(std::string_view text, uint64_t now);
+
+    /** Stable prefix of the newest text at time now, without an update. */
+    size_t stable(uint64_t now) const;
+
+    /**
+     * When the stable prefix next grows by age alone (monotonic usec),
+     * or 0 if only another update can grow it.
+     */
+    uint64_t deadline(uint64_t now) const;
+
+    /** Start over for a new segment. */
+    void reset();
+
+    /** The newest partial text. */
+    const std::string& text() const { return text_; }
+
+private:
+    // Prefix lengths in (previous entry's length, length] have been
+    // present in every update since (since_update, since_time). Lengths
+    // grow and ages shrink along the vector.
+    struct Run {
+        size_t length;
+        uint64_t since_update;
+        uint64_t since_time;
+    };
+
+    bool isStable(const Run& run, uint64_t now) const;
+
+    unsigned updates_;
+    uint64_t usec_;
+    std::string text_;
+    std::vector<Run> runs_;
+    uint64_t update_count_ = 0;
+};
+
+} // namespace fcitx
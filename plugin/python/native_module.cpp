@@ -0,0 +1,439 @@
+// CPython extension exposing the plugin's native audio helpers to the
+// daemon as daemon._native.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <exception>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "append_frame.h"
+#include "audio_energy.h"
+#include "base64.h"
+#include "event_queue.h"
+#include "json_events.h"
+
+namespace {
+
+// Borrow the bytes of any buffer-protocol object (bytes, memoryview, numpy)
+class BufferView {
+public:
+    bool acquire(PyObject* obj) {
+        if (PyObject_GetBuffer(obj, &view_, PyBUF_C_CONTIGUOUS) < 0) {
+            return false;
+        }
+        acquired_ = true;
+        return true;
+    }
+
+    ~BufferView() {
+        if (acquired_) {
+            PyBuffer_Release(&view_);
+        }
+    }
+
+    const void* data() const { return view_.buf; }
+    size_t size() const { return static_cast<size_t>(view_.len); }
+
+private:
+    Py_buffer view_{};
+    bool acquired_ = false;
+};
+
+PyObject* energy(PyObject*, PyObject* arg) {
+    BufferView buffer;
+    if (!buffer.acquire(arg)) {
+        return nullptr;
+    }
+
+    auto stats = fcitx::computeEnergy(
+        static_cast<const int16_t*>(buffer.data()), buffer.size() / 2);
+    return Py_BuildValue("(din)", stats.rms(), stats.peak,
+                         static_cast<Py_ssize_t>(stats.zero_crossings));
+}
+
+PyObject* kernelName(PyObject*, PyObject*) {
+    return PyUnicode_FromString(fcitx::energyKernelName());
+}
+
+PyObject* base64Encode(PyObject*, PyObject* arg) {
+    BufferView buffer;
+    if (!buffer.acquire(arg)) {
+        return nullptr;
+    }
+
+    size_t size = fcitx::base64EncodedSize(buffer.size());
+    PyObject* result =
+        PyBytes_FromStringAndSize(nullptr, static_cast<Py_ssize_t>(size));
+    if (!result) {
+        return nullptr;
+    }
+    fcitx::base64Encode(static_cast<const uint8_t*>(buffer.data()),
+                        buffer.size(), PyBytes_AS_STRING(result));
+    return result;
+}
+
+PyObject* base64KernelName(PyObject*, PyObject*) {
+    return PyUnicode_FromString(fcitx::base64KernelName());
+}
+
+// Interned event kinds returned by parse_event(), created at import
+PyObject* kindDelta;
+PyObject* kindCompleted;
+PyObject* kindError;
+
+PyObject* parseEvent(PyObject*, PyObject* arg) {
+    std::string_view message;
+    BufferView buffer;
+    if (PyUnicode_Check(arg)) {
+        Py_ssize_t size;
+        const char* data = PyUnicode_AsUTF8AndSize(arg, &size);
+        if (!data) {
+            return nullptr;
+        }
+        message = {data, static_cast<size_t>(size)};
+    } else {
+        if (!buffer.acquire(arg)) {
+            return nullptr;
+        }
+        message = {static_cast<const char*>(buffer.data()), buffer.size()};
+    }
+
+    fcitx::TranscriptionEvent event;
+    if (!fcitx::parseTranscriptionEvent(message, event)) {
+        PyErr_SetString(PyExc_ValueError, "malformed server event");
+        return nullptr;
+    }
+
+    PyObject* kind;
+    switch (event.kind) {
+    case fcitx::TranscriptionEvent::Kind::Delta:
+        kind = kindDelta;
+        break;
+    case fcitx::TranscriptionEvent::Kind::Completed:
+        kind = kindCompleted;
+        break;
+    case fcitx::TranscriptionEvent::Kind::Error:
+        return Py_BuildValue("(OO)", kindError, Py_None);
+    default:
+        return Py_BuildValue("(OO)", Py_None, Py_None);
+    }
+
+    PyObject* text;
+    if (!event.text_escaped) {
+        text = PyUnicode_DecodeUTF8(event.text.data(),
+                                    static_cast<Py_ssize_t>(event.text.size()),
+                                    "replace");
+    } else {
+        thread_local std::string decoded;
+        decoded.clear();
+        if (!fcitx::appendJsonUnescaped(event.text, decoded)) {
+            PyErr_SetString(PyExc_ValueError, "malformed string escape");
+            return nullptr;
+        }
+        text = PyUnicode_DecodeUTF8(decoded.data(),
+                                    static_cast<Py_ssize_t>(decoded.size()),
+                                    "replace");
+    }
+    if (!text) {
+        return nullptr;
+    }
+    PyObject* result = PyTuple_Pack(2, kind, text);
+    Py_DECREF(text);
+    return result;
+}
+
+// AppendFrame: the message is written straight into a new ASCII str, so
+// building one costs a single allocation
+struct AppendFrameObject {
+    PyObject_HEAD
+    fcitx::AppendFrame frame;
+};
+
+PyObject* appendFrameNew(PyTypeObject* type, PyObject* args, PyObject* kwds) {
+    if (PyTuple_GET_SIZE(args) != 0 || (kwds && PyDict_GET_SIZE(kwds) != 0)) {
+        PyErr_SetString(PyExc_TypeError, "AppendFrame() takes no arguments");
+        return nullptr;
+    }
+    auto* self = reinterpret_cast<AppendFrameObject*>(type->tp_alloc(type, 0));
+    if (self) {
+        new (&self->frame) fcitx::AppendFrame();
+    }
+    return reinterpret_cast<PyObject*>(self);
+}
+
+void appendFrameDealloc(PyObject* obj) {
+    auto* self = reinterpret_cast<AppendFrameObject*>(obj);
+    PyTypeObject* type = Py_TYPE(obj);
+    self->frame.~AppendFrame();
+    type->tp_free(obj);
+    Py_DECREF(type);
+}
+
+PyObject* appendFrameBuild(PyObject* obj, PyObject* arg) {
+    auto* self = reinterpret_cast<AppendFrameObject*>(obj);
+    BufferView buffer;
+    if (!buffer.acquire(arg)) {
+        return nullptr;
+    }
+
+    size_t size = fcitx::AppendFrame::messageSize(buffer.size());
+    PyObject* result = PyUnicode_New(static_cast<Py_ssize_t>(size), 127);
+    if (!result) {
+        return nullptr;
+    }
+    self->frame.write(static_cast<const uint8_t*>(buffer.data()),
+                      buffer.size(),
+                      reinterpret_cast<char*>(PyUnicode_1BYTE_DATA(result)));
+    return result;
+}
+
+PyObject* appendFrameNextEventId(PyObject* obj, PyObject*) {
+    auto* self = reinterpret_cast<AppendFrameObject*>(obj);
+    auto id = self->frame.nextEventId();
+    return PyUnicode_FromStringAndSize(id.data(),
+                                       static_cast<Py_ssize_t>(id.size()));
+}
+
+PyObject* appendFrameReset(PyObject* obj, PyObject*) {
+    reinterpret_cast<AppendFrameObject*>(obj)->frame.reset();
+    Py_RETURN_NONE;
+}
+
+PyMethodDef appendFrameMethods[] = {
+    {"build", appendFrameBuild, METH_O,
+     "build(pcm16) -> str\n\n"
+     "input_audio_buffer.append message for the chunk, with the next event id."},
+    {"next_event_id", appendFrameNextEventId, METH_NOARGS,
+     "Next event id of the sequence, for the session's other messages."},
+    {"reset", appendFrameReset, METH_NOARGS,
+     "Start a new event id sequence."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyType_Slot appendFrameSlots[] = {
+    {Py_tp_doc, const_cast<char*>(
+                    "Preformatted input_audio_buffer.append message.")},
+    {Py_tp_new, reinterpret_cast<void*>(appendFrameNew)},
+    {Py_tp_dealloc, reinterpret_cast<void*>(appendFrameDealloc)},
+    {Py_tp_methods, appendFrameMethods},
+    {0, nullptr},
+};
+
+PyType_Spec appendFrameSpec = {
+    "_native.AppendFrame",
+    sizeof(AppendFrameObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    appendFrameSlots,
+};
+
+// EventQueue: asyncio thread -> GLib main loop (see event_queue.h)
+struct EventQueueObject {
+    PyObject_HEAD
+    fcitx::EventQueue* queue;
+    std::vector<fcitx::EventQueue::Event> batch;  // Reused by drain()
+};
+
+PyObject* eventQueueNew(PyTypeObject* type, PyObject* args, PyObject* kwds) {
+    static const char* keywords[] = {"capacity", nullptr};
+    Py_ssize_t capacity = 1024;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|n",
+                                     const_cast<char**>(keywords), &capacity)) {
+        return nullptr;
+    }
+    if (capacity <= 0) {
+        PyErr_SetString(PyExc_ValueError, "capacity must be positive");
+        return nullptr;
+    }
+    auto* self = reinterpret_cast<EventQueueObject*>(type->tp_alloc(type, 0));
+    if (!self) {
+        return nullptr;
+    }
+    new (&self->batch) std::vector<fcitx::EventQueue::Event>();
+    try {
+        self->queue = new fcitx::EventQueue(static_cast<size_t>(capacity));
+    } catch (const std::exception& e) {
+        PyErr_SetString(PyExc_OSError, e.what());
+        Py_DECREF(self);
+        return nullptr;
+    }
+    return reinterpret_cast<PyObject*>(self);
+}
+
+void eventQueueDealloc(PyObject* obj) {
+    auto* self = reinterpret_cast<EventQueueObject*>(obj);
+    PyTypeObject* type = Py_TYPE(obj);
+    delete self->queue;
+    self->batch.~vector();
+    type->tp_free(obj);
+    Py_DECREF(type);
+}
+
+PyObject* eventQueuePush(PyObject* obj, PyObject* args) {
+    auto* self = reinterpret_cast<EventQueueObject*>(obj);
+    int kind;
+    const char* text;
+    Py_ssize_t size;
+    unsigned long long capture_us = 0, send_us = 0, server_us = 0;
+    if (!PyArg_ParseTuple(args, "is#|KKK", &kind, &text, &size, &capture_us,
+                          &send_us, &server_us)) {
+        return nullptr;
+    }
+    if (kind < 0 ||
+        kind > static_cast<int>(fcitx::EventQueue::Kind::Exhausted)) {
+        PyErr_SetString(PyExc_ValueError, "unknown event kind");
+        return nullptr;
+    }
+
+    fcitx::EventQueue::Event event;
+    event.kind = static_cast<fcitx::EventQueue::Kind>(kind);
+    event.text.assign(text, static_cast<size_t>(size));
+    event.capture_us = capture_us;
+    event.send_us = send_us;
+    event.server_us = server_us;
+    return PyBool_FromLong(self->queue->push(std::move(event)));
+}
+
+PyObject* eventQueueDrain(PyObject* obj, PyObject*) {
+    auto* self = reinterpret_cast<EventQueueObject*>(obj);
+    self->queue->drain(self->batch);
+
+    PyObject* result = PyList_New(static_cast<Py_ssize_t>(self->batch.size()));
+    if (!result) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < self->batch.size(); ++i) {
+        const auto& event = self->batch[i];
+        PyObject* item = Py_BuildValue(
+            "(is#KKK)", static_cast<int>(event.kind), event.text.data(),
+            static_cast<Py_ssize_t>(event.text.size()),
+            static_cast<unsigned long long>(event.capture_us),
+            static_cast<unsigned long long>(event.send_us),
+            static_cast<unsigned long long>(event.server_us));
+        if (!item) {
+            Py_DECREF(result);
+            return nullptr;
+        }
+        PyList_SET_ITEM(result, static_cast<Py_ssize_t>(i), item);
+    }
+    return result;
+}
+
+PyObject* eventQueueClearDelta(PyObject* obj, PyObject*) {
+    reinterpret_cast<EventQueueObject*>(obj)->queue->clearDelta();
+    Py_RETURN_NONE;
+}
+
+PyObject* eventQueueFileno(PyObject* obj, PyObject*) {
+    return PyLong_FromLong(
+        reinterpret_cast<EventQueueObject*>(obj)->queue->fd());
+}
+
+PyObject* eventQueueDropped(PyObject* obj, void*) {
+    return PyLong_FromUnsignedLongLong(
+        reinterpret_cast<EventQueueObject*>(obj)->queue->dropped());
+}
+
+PyMethodDef eventQueueMethods[] = {
+    {"push", eventQueuePush, METH_VARARGS,
+     "push(kind, text, capture_us=0, send_us=0, server_us=0) -> bool\n\n"
+     "Queue an event (producer thread); a delta replaces the pending\n"
+     "one. False if the queue is full."},
+    {"drain", eventQueueDrain, METH_NOARGS,
+     "drain() -> [(kind, text, capture_us, send_us, server_us)]\n\n"
+     "Clear the wakeup and take all queued events (consumer thread),\n"
+     "the latest delta last unless a later event superseded it."},
+    {"clear_delta", eventQueueClearDelta, METH_NOARGS,
+     "Drop the pending delta (consumer thread)."},
+    {"fileno", eventQueueFileno, METH_NOARGS,
+     "eventfd that becomes readable when events are queued."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyGetSetDef eventQueueGetSet[] = {
+    {"dropped", eventQueueDropped, nullptr,
+     "Deltas superseded before they were drained.", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr},
+};
+
+PyType_Slot eventQueueSlots[] = {
+    {Py_tp_doc, const_cast<char*>(
+                    "Lock-free SPSC event queue with an eventfd wakeup.")},
+    {Py_tp_new, reinterpret_cast<void*>(eventQueueNew)},
+    {Py_tp_dealloc, reinterpret_cast<void*>(eventQueueDealloc)},
+    {Py_tp_methods, eventQueueMethods},
+    {Py_tp_getset, eventQueueGetSet},
+    {0, nullptr},
+};
+
+PyType_Spec eventQueueSpec = {
+    "_native.EventQueue",
+    sizeof(EventQueueObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    eventQueueSlots,
+};
+
+PyMethodDef methods[] = {
+    {"energy", energy, METH_O,
+     "energy(pcm16) -> (rms, peak, zero_crossings)\n\n"
+     "Energy statistics of a PCM16 buffer using the SIMD kernel."},
+    {"kernel_name", kernelName, METH_NOARGS,
+     "Name of the energy kernel selected for this CPU."},
+    {"parse_event", parseEvent, METH_O,
+     "parse_event(message) -> (kind, text)\n\n"
+     "Classify a server event (str or bytes) without building a dict.\n"
+     "kind is 'delta', 'completed', 'error' or None; text is the decoded\n"
+     "delta or transcript (None for other kinds). Raises ValueError if\n"
+     "the message is not a JSON object with a string type."},
+    {"base64_encode", base64Encode, METH_O,
+     "base64_encode(data) -> bytes\n\n"
+     "Padded base64 encoding of a buffer using the SIMD kernel."},
+    {"base64_kernel_name", base64KernelName, METH_NOARGS,
+     "Name of the base64 kernel selected for this CPU."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyModuleDef module = {
+    PyModuleDef_HEAD_INIT,
+    "_native",
+    "Native audio helpers for the fcitx5-voice daemon.",
+    0,
+    methods,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit__native() {
+    PyObject* m = PyModule_Create(&module);
+    if (!m) {
+        return nullptr;
+    }
+    kindDelta = PyUnicode_InternFromString("delta");
+    kindCompleted = PyUnicode_InternFromString("completed");
+    kindError = PyUnicode_InternFromString("error");
+    if (!kindDelta || !kindCompleted || !kindError) {
+        Py_DECREF(m);
+        return nullptr;
+    }
+
+    PyObject* type = PyType_FromSpec(&appendFrameSpec);
+    if (!type || PyModule_AddObject(m, "AppendFrame", type) < 0) {
+        Py_XDECREF(type);
+        Py_DECREF(m);
+        return nullptr;
+    }
+    type = PyType_FromSpec(&eventQueueSpec);
+    if (!type || PyModule_AddObject(m, "EventQueue", type) < 0) {
+        Py_XDECREF(type);
+        Py_DECREF(m);
+        return nullptr;
+    }
+    return m;
+}
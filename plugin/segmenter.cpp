@@ -0,0 +1,119 @@
+#include "segmenter.h"
+#include "audio_energy.h"
+#include <algorithm>
+
+namespace fcitx {
+
+EnergyVad::EnergyVad(unsigned sample_rate, Options options)
+    : options_(options),
+      frame_samples_(sample_rate * options.frame_ms / 1000),
+      calibration_frames_(
+          std::max(1u, options.calibration_ms / options.frame_ms)),
+      hangover_frames_(options.hangover_ms / options.frame_ms) {}
+
+double EnergyVad::threshold() const {
+    return std::max(noiseFloor() * options_.multiplier, options_.min_threshold);
+}
+
+std::optional<bool> EnergyVad::process(const int16_t* frame) {
+    double level = computeEnergy(frame, frame_samples_).rms();
+
+    if (!calibrated_) {
+        calibration_sum_ += level;
+        if (++calibration_count_ == calibration_frames_) {
+            floor_ = calibration_sum_ / calibration_count_;
+            calibrated_ = true;
+        }
+        return std::nullopt;
+    }
+
+    if (level >= threshold()) {
+        hangover_ = hangover_frames_;
+        return true;
+    }
+
+    // Track slow changes in background noise on non-speech frames only
+    floor_ += options_.floor_alpha * (level - floor_);
+    if (hangover_ > 0) {
+        --hangover_;
+        return true;
+    }
+    return false;
+}
+
+Segmenter::Segmenter(EnergyVad vad, unsigned silence_commit_ms,
+                     unsigned flush_interval_ms, unsigned max_flushes)
+    : vad_(std::move(vad)),
+      silence_commit_frames_(
+          std::max(1u, silence_commit_ms / vad_.frameMs())),
+      flush_frames_(std::max(1u, flush_interval_ms / vad_.frameMs())),
+      max_flushes_(max_flushes) {
+    pending_.reserve(vad_.frameSamples());
+}
+
+Segmenter::Action Segmenter::feed(const int16_t* samples, size_t n) {
+    const size_t frame = vad_.frameSamples();
+    Action action = Action::None;
+    auto record = [&action](Action result) {
+        if (result != Action::None && action != Action::Commit) {
+            action = result;
+        }
+    };
+
+    // Complete a frame started by the previous chunk
+    if (!pending_.empty()) {
+        size_t take = std::min(n, frame - pending_.size());
+        pending_.insert(pending_.end(), samples, samples + take);
+        samples += take;
+        n -= take;
+        if (pending_.size() < frame) {
+            return action;
+        }
+        record(step(vad_.process(pending_.data())));
+        pending_.clear();
+    }
+
+    for (; n >= frame; samples += frame, n -= frame) {
+        record(step(vad_.process(samples)));
+    }
+    pending_.assign(samples, samples + n);
+    return action;
+}
+
+Segmenter::Action Segmenter::step(std::optional<bool> is_speech) {
+    if (!is_speech) {
+        return Action::None;  // Calibrating
+    }
+
+    if (*is_speech) {
+        has_speech_ = true;
+        silence_frames_ = 0;
+        flush_count_ = 0;
+        silence_after_commit_ = 0;
+        return Action::None;
+    }
+
+    ++silence_frames_;
+    if (flush_count_ < max_flushes_) {
+        ++silence_after_commit_;
+    }
+
+    // Commit after speech followed by silence
+    if (has_speech_ && silence_frames_ >= silence_commit_frames_) {
+        has_speech_ = false;
+        flush_count_ = 0;
+        silence_after_commit_ = 0;
+        return Action::Commit;
+    }
+
+    // Periodic flush commits during silence to finalize text
+    if (flush_count_ < max_flushes_ && silence_after_commit_ > 0 &&
+        silence_after_commit_ % flush_frames_ == 0) {
+        ++flush_count_;
+        return Action::Flush;
+    }
+
+    return Action::None;
+}
+
+} // namespace fcitx
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace fcitx {
+
+/**
+ * Energy voice activity detector, the native counterpart of the
+ * daemon's EnergyVAD (daemon/vad.py): per-frame RMS against an adaptive
+ * noise floor, calibrated from the first calibration_ms of audio, with a
+ * hangover to bridge short dips inside words.
+ */
+class EnergyVad {
+public:
+    struct Options {
+        unsigned frame_ms = 10;
+        unsigned calibration_ms = 1000;
+        unsigned hangover_ms = 50;
+        double multiplier = 3.0;
+        double min_threshold = 300.0;
+        double floor_alpha = 0.02;
+    };
+
+    EnergyVad(unsigned sample_rate, Options options);
+
+    /** Classify one frame of frameSamples() samples; nullopt while calibrating. */
+    std::optional<bool> process(const int16_t* frame);
+
+    size_t frameSamples() const { return frame_samples_; }
+    unsigned frameMs() const { return options_.frame_ms; }
+    double noiseFloor() const { return calibrated_ ? floor_ : 0.0; }
+    double threshold() const;
+
+private:
+    Options options_;
+    size_t frame_samples_;
+    unsigned calibration_frames_;
+    unsigned hangover_frames_;
+    unsigned calibration_count_ = 0;
+    double calibration_sum_ = 0.0;
+    double floor_ = 0.0;
+    bool calibrated_ = false;
+    unsigned hangover_ = 0;
+};
+
+/**
+ * Turns per-frame VAD decisions into commit points, matching the
+ * daemon's Segmenter: commit after speech followed by silence_commit_ms
+ * of silence, then up to max_flushes flush commits every
+ * flush_interval_ms while the silence lasts.
+ */
+class Segmenter {
+public:
+    enum class Action { None, Commit, Flush };
+
+    Segmenter(EnergyVad vad, unsigned silence_commit_ms,
+              unsigned flush_interval_ms = 1000, unsigned max_flushes = 3);
+
+    /** Classify a chunk of any length; leftover samples carry over. */
+    Action feed(const int16_t* samples, size_t n);
+
+    const EnergyVad& vad() const { return vad_; }
+    bool hasSpeech() const { return has_speech_; }
+
+private:
+    Action step(std::optional<bool> is_speech);
+
+    EnergyVad vad_;
+    unsigned silence_commit_frames_;
+    unsigned flush_frames_;
+    unsigned max_flushes_;
+    bool has_speech_ = false;
+    unsigned silence_frames_ = 0;
+    unsigned flush_count_ = 0;
+    unsigned silence_after_commit_ = 0;
+    std::vector<int16_t> pending_;  // Partial frame from the previous chunk
+};
+
+} // namespace fcitx
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <span>
+
+namespace fcitx {
+
+/**
+ * Lock-free single-producer/single-consumer ring of trivially copyable
+ * elements. Storage is allocated once; the producer and consumer can
+ * each work in place on contiguous spans to avoid intermediate copies.
+ */
+template <typename T>
+class SpscRing {
+public:
+    /** Capacity is rounded up to a power of two. */
+    explicit SpscRing(size_t capacity)
+        : capacity_(std::bit_ceil(std::max<size_t>(capacity, 2))),
+          mask_(capacity_ - 1),
+          buffer_(std::make_unique<T[]>(capacity_)) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return capacity_; }
+
+    // Producer side
+
+    /** Largest contiguous free region starting at the write position. */
+    std::span<T> writableSpan() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t free = capacity_ - (head - tail_.load(std::memory_order_acquire));
+        size_t offset = head & mask_;
+        return {buffer_.get() + offset, std::min(free, capacity_ - offset)};
+    }
+
+    /** Publish n elements written into writableSpan(). */
+    void commitWrite(size_t n) {
+        head_.store(head_.load(std::memory_order_relaxed) + n,
+                    std::memory_order_release);
+    }
+
+    /** Copy n elements in; fails without writing if there is no room. */
+    bool push(const T* data, size_t n) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (capacity_ - (head - tail_.load(std::memory_order_acquire)) < n) {
+            return false;
+        }
+        copyIn(head, data, n);
+        head_.store(head + n, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+
+    size_t readable() const {
+        return head_.load(std::memory_order_acquire) -
+               tail_.load(std::memory_order_relaxed);
+    }
+
+    /** Copy n elements out; fails without consuming if fewer are queued. */
+    bool pop(T* out, size_t n) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_.load(std::memory_order_acquire) - tail < n) {
+            return false;
+        }
+        copyOut(tail, out, n);
+        tail_.store(tail + n, std::memory_order_release);
+        return true;
+    }
+
+    /** Drop n queued elements (n <= readable()). */
+    void discard(size_t n) {
+        tail_.store(tail_.load(std::memory_order_relaxed) + n,
+                    std::memory_order_release);
+    }
+
+private:
+    void copyIn(size_t pos, const T* data, size_t n) {
+        size_t offset = pos & mask_;
+        size_t first = std::min(n, capacity_ - offset);
+        std::copy_n(data, first, buffer_.get() + offset);
+        std::copy_n(data + first, n - first, buffer_.get());
+    }
+
+    void copyOut(size_t pos, T* out, size_t n) const {
+        size_t offset = pos & mask_;
+        size_t first = std::min(n, capacity_ - offset);
+        std::copy_n(buffer_.get() + offset, first, out);
+        std::copy_n(buffer_.get(), n - first, out + first);
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<T[]> buffer_;
+    alignas(64) std::atomic<size_t> head_{0};  // Written by producer
+    alignas(64) std::atomic<size_t> tail_{0};  // Written by consumer
+};
+
+} // namespace fcitx
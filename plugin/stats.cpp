@@ -0,0 +1,90 @@
+#include "stats.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace fcitx {
+
+namespace {
+
+constexpr const char* COUNTER_NAMES[] = {
+    "deltas_received", "deltas_coalesced", "deltas_superseded",
+    "deltas_unchanged", "preedit_updates", "commits",
+    "early_commits",   "dbus_signals",     "channel_events",
+    "dbus_call_errors", "daemon_exits", "bus_reconnects",
+};
+static_assert(std::size(COUNTER_NAMES) == StatsRegistry::COUNTER_COUNT);
+
+constexpr const char* HISTOGRAM_NAMES[] = {
+    "delta_to_preedit_us",
+    "dbus_dispatch_us",
+    "dbus_call_us",
+};
+static_assert(std::size(HISTOGRAM_NAMES) == StatsRegistry::HISTOGRAM_COUNT);
+
+} // namespace
+
+size_t LatencyHistogram::bucketOf(uint64_t usec) {
+    // Values below SUB_BUCKETS map to themselves; above, the exponent
+    // picks a group of SUB_BUCKETS and the next SUB_BITS bits the bucket
+    unsigned width = std::bit_width(usec);
+    if (width <= SUB_BITS) {
+        return usec;
+    }
+    unsigned shift = width - SUB_BITS - 1;
+    size_t bucket = SUB_BUCKETS * (shift + 1) +
+                    ((usec >> shift) & (SUB_BUCKETS - 1));
+    return std::min(bucket, BUCKETS - 1);
+}
+
+uint64_t LatencyHistogram::upperBound(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    unsigned shift = bucket / SUB_BUCKETS - 1;
+    uint64_t top = SUB_BUCKETS + bucket % SUB_BUCKETS;
+    return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t usec) {
+    ++buckets_[bucketOf(usec)];
+    ++count_;
+    sum_ += usec;
+    max_ = std::max(max_, usec);
+}
+
+void LatencyHistogram::reset() { *this = LatencyHistogram(); }
+
+uint64_t LatencyHistogram::percentile(double q) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    auto rank = static_cast<uint64_t>(std::ceil(q * count_));
+    rank = std::clamp<uint64_t>(rank, 1, count_);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKETS; ++b) {
+        seen += buckets_[b];
+        if (seen >= rank) {
+            // The last bucket is open-ended
+            return b == BUCKETS - 1 ? max_ : std::min(upperBound(b), max_);
+        }
+    }
+    return max_;
+}
+
+void StatsRegistry::reset() {
+    counters_.fill(0);
+    for (auto& histogram : histograms_) {
+        histogram.reset();
+    }
+}
+
+const char* StatsRegistry::name(Counter counter) {
+    return COUNTER_NAMES[counter];
+}
+
+const char* StatsRegistry::name(Histogram histogram) {
+    return HISTOGRAM_NAMES[histogram];
+}
+
+} // namespace fcitx
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace fcitx {
+
+/**
+ * Log-linear (HDR-style) latency histogram in microseconds.
+ *
+ * Values below 16 µs are counted exactly; above that every power of two
+ * is split into 16 linear sub-buckets, so a percentile is within 6.25%
+ * of the true value. Values from 2^36 µs (about 19 hours) up share the
+ * last bucket. Fixed storage, no allocation when recording.
+ */
+class LatencyHistogram {
+public:
+    void record(uint64_t usec);
+    void reset();
+
+    uint64_t count() const { return count_; }
+    uint64_t max() const { return max_; }
+    uint64_t mean() const { return count_ ? sum_ / count_ : 0; }
+    /** Upper bound of the bucket holding quantile q (0..1); 0 if empty. */
+    uint64_t percentile(double q) const;
+
+private:
+    static constexpr unsigned SUB_BITS = 4;
+    static constexpr size_t SUB_BUCKETS = size_t{1} << SUB_BITS;
+    static constexpr unsigned MAX_BITS = 36;
+    static constexpr size_t BUCKETS =
+        SUB_BUCKETS * (MAX_BITS - SUB_BITS + 1);
+
+    static size_t bucketOf(uint64_t usec);
+    static uint64_t upperBound(size_t bucket);
+
+    std::array<uint64_t, BUCKETS> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
+/**
+ * Plugin counters and latency histograms, exported over D-Bus by
+ * DBusClient (org.fcitx.Fcitx5.Voice.Stats, see tools/voice_stats.py).
+ *
+ * Metrics are fixed enums so recording is an array index; everything
+ * runs on the fcitx event loop thread.
+ */
+class StatsRegistry {
+public:
+    enum Counter {
+        DeltasReceived,   // Partial results from either transport
+        DeltasCoalesced,  // Replaced by a newer delta before being painted
+        DeltasSuperseded, // Dropped by DBusClient: newer delta/commit queued
+        DeltasUnchanged,  // Painted text would not have changed
+        PreeditUpdates,   // Preedit repaints
+        Commits,          // commitString calls
+        EarlyCommits,     // ... of which early (EarlyCommit)
+        DBusSignals,      // Daemon signals dispatched
+        ChannelEvents,    // Daemon events read from the event channel
+        DBusCallErrors,   // Method calls failed or timed out
+        DaemonExits,      // Daemon released its bus name (exit or crash)
+        BusReconnects,    // Session bus connection restored after a loss
+        COUNTER_COUNT,
+    };
+
+    enum Histogram {
+        DeltaToPreedit,  // Delta received -> preedit painted
+        DBusDispatch,    // One DBusClient::processEvents() pass
+        DBusCall,        // Method call sent -> reply handled
+        HISTOGRAM_COUNT,
+    };
+
+    void add(Counter counter, uint64_t n = 1) { counters_[counter] += n; }
+    void record(Histogram histogram, uint64_t usec) {
+        histograms_[histogram].record(usec);
+    }
+    void reset();
+
+    uint64_t counter(Counter counter) const { return counters_[counter]; }
+    const LatencyHistogram& histogram(Histogram histogram) const {
+        return histograms_[histogram];
+    }
+
+    /** snake_case metric names, as exported. */
+    static const char* name(Counter counter);
+    static const char* name(Histogram histogram);
+
+private:
+    std::array<uint64_t, COUNTER_COUNT> counters_{};
+    std::array<LatencyHistogram, HISTOGRAM_COUNT> histograms_;
+};
+
+} // namespace fcitx
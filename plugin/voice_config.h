@@ -0,0 +1,53 @@
+#pragma once
+
+#include <fcitx-config/configuration.h>
+#include <string>
+
+namespace fcitx {
+
+/**
+ * Addon configuration, stored in conf/voice.conf.
+ *
+ * With NativeTransport enabled the plugin captures audio and talks to
+ * the ASR server itself; otherwise it drives fcitx5-voice-daemon over
+ * D-Bus and the transport options are unused (the daemon has its own).
+ * The preedit options apply to both.
+ */
+FCITX_CONFIGURATION(
+    VoiceConfig,
+    Option<bool> nativeTransport{
+        this, "NativeTransport",
+        "Connect to the ASR server directly (no daemon)", false};
+    Option<bool> eventChannel{
+        this, "EventChannel",
+        "Receive daemon events over a binary socket instead of D-Bus signals",
+        false};
+    Option<std::string> serverUrl{this, "ServerUrl", "ASR server URL",
+                                  "ws://localhost:9000"};
+    Option<std::string> language{this, "Language", "Recognition language",
+                                 "ja-JP"};
+    Option<std::string> model{
+        this, "Model", "ASR model",
+        "parakeet-rnnt-1.1b-unified-ml-cs-universal-multi-asr-streaming"};
+    Option<std::string> captureDevice{this, "CaptureDevice",
+                                      "ALSA capture device", "default"};
+    Option<int, IntConstrain> silenceCommitMs{
+        this, "SilenceCommitMs", "Silence before committing (ms)", 150,
+        IntConstrain(20, 2000)};
+    Option<int, IntConstrain> preeditFps{
+        this, "PreeditFps",
+        "Preedit refresh rate (Hz, 0 = repaint on every partial result)", 30,
+        IntConstrain(0, 120)};
+    Option<bool> earlyCommit{
+        this, "EarlyCommit",
+        "Commit stable text before the server finalizes the segment", false};
+    Option<int, IntConstrain> stableUpdates{
+        this, "StableUpdates",
+        "Partial results a prefix must survive before early commit", 4,
+        IntConstrain(2, 50)};
+    Option<int, IntConstrain> stableMs{
+        this, "StableMs",
+        "Time a prefix must stay unchanged before early commit (ms, 0 = off)",
+        1500, IntConstrain(0, 10000)};);
+
+} // namespace fcitx
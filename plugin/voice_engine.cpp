@@ -1,66 +1,100 @@
 #include "voice_engine.h"
+#include <fcitx-config/iniparser.h>
 #include <fcitx-utils/event.h>
 #include <fcitx-utils/log.h>
 #include <fcitx/inputcontext.h>
 #include <fcitx/inputpanel.h>
 #include <fcitx/text.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unistd.h>
+#include <utility>
+#ifdef VOICE_HAVE_ALSA
+#include "audio_capture.h"
+#endif
 
 namespace fcitx {
 
+static const uint64_t METER_INTERVAL_US = 100000;  // 10 Hz
+static const uint64_t MIC_DEAD_US = 1500000;       // No signal for 1.5s
+static const uint64_t PREWARM_INTERVAL_US = 30000000;  // Standby outlasts this
+static const char* CONFIG_FILE = "conf/voice.conf";
+
+// Map an RMS level in dBFS (-60..0) onto a single bar glyph
+static const char* levelGlyph(double db) {
+    static const char* glyphs[] = {"▁", "▂", "▃", "▄", "▅", "▆", "▇", "█"};
+    int index = static_cast<int>((db + 60.0) / 60.0 * 8.0);
+    return glyphs[std::clamp(index, 0, 7)];
+}
+
 VoiceEngine::VoiceEngine(Instance* instance)
-    : instance_(instance), dbus_client_(std::make_unique<DBusClient>()) {
+    : instance_(instance),
+      dbus_client_(std::make_unique<DBusClient>(instance)) {
 
     // Set up D-Bus callbacks
     dbus_client_->setTranscriptionCallback(
-        [this](const std::string& text, int segment_num) {
-            onTranscriptionComplete(text, segment_num);
+        [this](const std::string& text, int segment_num,
+               const TraceStamps* trace) {
+            onTranscriptionComplete(text, segment_num, trace);
         });
 
     dbus_client_->setTranscriptionDeltaCallback(
-        [this](const std::string& text) {
-            onTranscriptionDelta(text);
+        [this](const std::string& text, const TraceStamps* trace) {
+            onTranscriptionDelta(text, trace);
         });
 
     dbus_client_->setErrorCallback(
         [this](const std::string& message) {
             onError(message);
         });
+    dbus_client_->setLevelCallback(
+        [this](const AudioLevel& level) { onAudioLevel(level); });
+    dbus_client_->exportStats(&stats_);
 
-    // Set up IO event for D-Bus file descriptor
-    int dbus_fd = dbus_client_->getFileDescriptor();
-    if (dbus_fd >= 0) {
-        event_source_ = instance_->eventLoop().addIOEvent(
-            dbus_fd,
-            IOEventFlag::In,
-            [this](EventSource*, int, IOEventFlags) {
-                dbus_client_->processEvents();
-                return true;
-            });
-    } else {
-        FCITX_ERROR() << "Failed to get D-Bus file descriptor, falling back to timer";
-        // Fallback to timer-based polling
-        event_source_ = instance_->eventLoop().addTimeEvent(
-            CLOCK_MONOTONIC, now(CLOCK_MONOTONIC), 100000,
-            [this](EventSourceTime*, uint64_t) {
-                dbus_client_->processEvents();
-                return true;
-            });
-    }
+    dbus_client_->setDaemonCallback(
+        [this](bool running) { onDaemonChanged(running); });
+
+    // Signals skip the bus daemon once the daemon offers a direct link
+    dbus_client_->enablePeer(true);
+
+    reloadConfig();
 }
 
 VoiceEngine::~VoiceEngine() = default;
 
+void VoiceEngine::reloadConfig() {
+    readAsIni(config_, CONFIG_FILE);
+    native_asr_stale_ = true;
+    configureEventChannel();
+}
+
+void VoiceEngine::setConfig(const RawConfig& config) {
+    config_.load(config, true);
+    safeSaveAsIni(config_, CONFIG_FILE);
+    native_asr_stale_ = true;
+    configureEventChannel();
+}
+
+void VoiceEngine::configureEventChannel() {
+    // Takes effect from the next daemon instance; an open channel stays
+    dbus_client_->enableEventChannel(*config_.eventChannel);
+}
+
 void VoiceEngine::activate(const InputMethodEntry& entry,
                           InputContextEvent& event) {
+    prewarm();
     updateStatus();
 }
 
 void VoiceEngine::deactivate(const InputMethodEntry& entry,
                             InputContextEvent& event) {
-    if (recording_) {
+    if (state_ != RecordingState::Idle) {
         stopRecording();
     }
+    cancelPreedit();
     preedit_text_.clear();
+    preedit_diff_.reset();
 }
 
 void VoiceEngine::keyEvent(const InputMethodEntry& entry, KeyEvent& event) {
@@ -75,77 +109,456 @@ void VoiceEngine::keyEvent(const InputMethodEntry& entry, KeyEvent& event) {
 
 void VoiceEngine::reset(const InputMethodEntry& entry,
                        InputContextEvent& event) {
+    cancelPreedit();
     preedit_text_.clear();
+    preedit_diff_.reset();
 }
 
 void VoiceEngine::startRecording() {
-    if (recording_) {
+    if (state_ != RecordingState::Idle) {
         FCITX_WARN() << "Already recording";
         return;
     }
 
+    resetSegment();
+    horizon_ = StableHorizon(*config_.stableUpdates,
+                             static_cast<uint64_t>(*config_.stableMs) * 1000);
+
+    if (*config_.nativeTransport) {
+        startNativeRecording();
+        return;
+    }
+
     try {
-        dbus_client_->startRecording();
-        recording_ = true;
-        updateStatus();
+        dbus_client_->startRecording(
+            [this](bool ok, const std::string& error) {
+                onStartReply(ok, error);
+            });
+        state_ = RecordingState::StartRequested;
+        showNotification("🎤 録音開始中...");
     } catch (const std::exception& e) {
         FCITX_ERROR() << "Failed to start recording: " << e.what();
         showNotification("❌ 録音開始失敗");
-        recording_ = false;
+        state_ = RecordingState::Idle;
+    }
+}
+
+void VoiceEngine::startNativeRecording() {
+    try {
+        // Pick up config changes once the previous session has finished
+        if (!native_asr_ ||
+            (native_asr_stale_ &&
+             native_asr_->state() == NativeAsrClient::State::Idle)) {
+            native_asr_ = createNativeAsr();
+            native_asr_stale_ = false;
+        }
+        native_asr_->start();
+        native_session_ = true;
+        state_ = RecordingState::StartRequested;
+        showNotification("🎤 録音開始中...");
+    } catch (const std::exception& e) {
+        FCITX_ERROR() << "Failed to start recording: " << e.what();
+        showNotification("❌ 録音開始失敗");
+        state_ = RecordingState::Idle;
+    }
+}
+
+std::unique_ptr<NativeAsrClient> VoiceEngine::createNativeAsr() {
+#ifdef VOICE_HAVE_ALSA
+    NativeAsrClient::Options options;
+    options.url = *config_.serverUrl;
+    options.model = *config_.model;
+    options.language = *config_.language;
+    options.silence_commit_ms = *config_.silenceCommitMs;
+
+    AudioCapture::Options capture;
+    capture.device = *config_.captureDevice;
+    capture.chunk_ms = options.chunk_ms;
+
+    auto client = std::make_unique<NativeAsrClient>(
+        &instance_->eventLoop(), options,
+        std::make_unique<AudioCapture>(capture));
+
+    // Same handlers as the daemon's signals, minus the D-Bus hop
+    client->setReadyCallback([this]() { onStartReply(true, ""); });
+    client->setDeltaCallback(
+        [this](const std::string& text) { onTranscriptionDelta(text, nullptr); });
+    client->setCompleteCallback([this](const std::string& text) {
+        onTranscriptionComplete(text, 0, nullptr);
+    });
+    client->setErrorCallback(
+        [this](const std::string& message) { onError(message); });
+    client->setFinishedCallback([this]() { onNativeFinished(); });
+    return client;
+#else
+    throw std::runtime_error("Native transport requires ALSA capture support");
+#endif
+}
+
+void VoiceEngine::onNativeFinished() {
+    // Ended on its own rather than through stopRecording()
+    if (state_ == RecordingState::Idle) {
+        return;
+    }
+    native_session_ = false;
+    state_ = RecordingState::Idle;
+    updateStatus();
+}
+
+void VoiceEngine::onStartReply(bool ok, const std::string& error) {
+    // Stopped (or failed via Error signal) while the call was in flight
+    if (state_ != RecordingState::StartRequested) {
+        return;
+    }
+
+    if (!ok) {
+        FCITX_ERROR() << "Failed to start recording: " << error;
+        showNotification("❌ 録音開始失敗");
+        state_ = RecordingState::Idle;
+        return;
+    }
+
+    state_ = RecordingState::Recording;
+    updateStatus();
+    if (!native_session_) {
+        openLevelMeter();
     }
 }
 
 void VoiceEngine::stopRecording() {
-    if (!recording_) {
+    if (state_ == RecordingState::Idle) {
         FCITX_WARN() << "Not recording";
         return;
     }
 
-    // Commit any pending preedit text immediately
+    finishRecording();
+
+    if (native_session_) {
+        // Final transcripts still arrive through the callbacks
+        native_session_ = false;
+        native_asr_->stop();
+        updateStatus();
+        return;
+    }
+
+    // Also sent while StartRequested: the daemon handles calls in order,
+    // so a pending start is undone rather than left running.
+    try {
+        dbus_client_->stopRecording(
+            [](bool ok, const std::string& error) {
+                if (!ok) {
+                    FCITX_ERROR() << "Failed to stop recording: " << error;
+                }
+            });
+    } catch (const std::exception& e) {
+        FCITX_ERROR() << "Failed to stop recording: " << e.what();
+    }
+    updateStatus();
+}
+
+void VoiceEngine::finishRecording() {
+    // Commit any pending preedit text immediately, including a delta
+    // that has not been painted yet
+    cancelPreedit();
     if (!preedit_text_.empty()) {
         auto* ic = instance_->mostRecentInputContext();
         if (ic) {
             ic->commitString(preedit_text_);
+            stats_.add(StatsRegistry::Commits);
         }
         preedit_text_.clear();
         clearPreedit();
     }
 
+    stopLevelMeter();
+    state_ = RecordingState::Idle;
+}
+
+void VoiceEngine::onDaemonChanged(bool running) {
+    // A new daemon has no standby session yet
+    last_prewarm_time_ = 0;
+    if (native_session_) {
+        return;
+    }
+
+    if (!running) {
+        // Calls in flight fail on their own; a running session would
+        // wait for events that never come
+        if (state_ == RecordingState::Recording) {
+            FCITX_WARN() << "Voice daemon exited while recording";
+            finishRecording();
+            showTimedNotification("❌ 音声デーモンが終了しました", 5000);
+        }
+        return;
+    }
+
+    // A new daemon starts idle; catch a session this side still thinks
+    // is running
     try {
-        dbus_client_->stopRecording();
+        dbus_client_->queryStatus(
+            [this](const std::string& status, const std::string& error) {
+                if (!error.empty()) {
+                    FCITX_DEBUG() << "GetStatus failed: " << error;
+                    return;
+                }
+                if (status == "idle" && !native_session_ &&
+                    state_ == RecordingState::Recording) {
+                    FCITX_WARN() << "Voice daemon is idle; ending recording";
+                    finishRecording();
+                    updateStatus();
+                }
+            });
     } catch (const std::exception& e) {
-        FCITX_ERROR() << "Failed to stop recording: " << e.what();
+        FCITX_DEBUG() << "GetStatus failed: " << e.what();
     }
-    recording_ = false;
-    updateStatus();
 }
 
 void VoiceEngine::toggleRecording() {
-    if (recording_) {
+    if (state_ == RecordingState::Idle) {
+        startRecording();
+    } else {
         stopRecording();
+    }
+}
+
+void VoiceEngine::prewarm() {
+    // Open the daemon's standby session (and start the daemon) while the
+    // user is still focusing the text field, not on the first Shift+Space
+    if (*config_.nativeTransport || state_ != RecordingState::Idle) {
+        return;
+    }
+    uint64_t current = now(CLOCK_MONOTONIC);
+    if (last_prewarm_time_ && current - last_prewarm_time_ < PREWARM_INTERVAL_US) {
+        return;
+    }
+    last_prewarm_time_ = current;
+
+    try {
+        dbus_client_->prewarm([](bool ok, const std::string& error) {
+            if (!ok) {
+                FCITX_DEBUG() << "Prewarm failed: " << error;
+            }
+        });
+    } catch (const std::exception& e) {
+        FCITX_DEBUG() << "Prewarm failed: " << e.what();
+    }
+}
+
+void VoiceEngine::openLevelMeter() {
+    if (dbus_client_->transport() == DBusClient::Transport::Channel) {
+        // Levels arrive with the events; no ring needed
+        channel_meter_ = true;
+        channel_level_ = {};
+        startMeterTimer();
+        return;
+    }
+
+    // Request a fresh fd each session so a restarted daemon's ring is used
+    try {
+        dbus_client_->openPcmRing([this](int fd) {
+            if (fd < 0) {
+                return;
+            }
+            if (state_ != RecordingState::Recording) {
+                close(fd);
+                return;
+            }
+            try {
+                pcm_ring_ = std::make_unique<PcmRingReader>(fd);
+            } catch (const std::exception& e) {
+                FCITX_WARN() << "Level meter unavailable: " << e.what();
+                return;
+            }
+            startMeterTimer();
+        });
+    } catch (const std::exception& e) {
+        FCITX_WARN() << "Level meter unavailable: " << e.what();
+    }
+}
+
+void VoiceEngine::startMeterTimer() {
+    last_signal_time_ = now(CLOCK_MONOTONIC);
+    meter_text_.clear();
+    if (meter_timer_) {
+        meter_timer_->setTime(last_signal_time_ + METER_INTERVAL_US);
+        meter_timer_->setOneShot();
+        return;
+    }
+    meter_timer_ = instance_->eventLoop().addTimeEvent(
+        CLOCK_MONOTONIC, last_signal_time_ + METER_INTERVAL_US, 0,
+        [this](EventSourceTime* source, uint64_t) {
+            if (state_ != RecordingState::Recording ||
+                (!pcm_ring_ && !channel_meter_)) {
+                return true;
+            }
+            updateLevelMeter();
+            source->setNextInterval(METER_INTERVAL_US);
+            source->setOneShot();
+            return true;
+        });
+}
+
+void VoiceEngine::onAudioLevel(const AudioLevel& level) {
+    if (!channel_meter_ || level.samples == 0) {
+        return;
+    }
+    // Merge the chunks since the last refresh into one window
+    size_t samples = channel_level_.samples + level.samples;
+    double energy = channel_level_.rms * channel_level_.rms *
+                        channel_level_.samples +
+                    level.rms * level.rms * level.samples;
+    channel_level_.rms = std::sqrt(energy / samples);
+    channel_level_.peak = std::max(channel_level_.peak, level.peak);
+    channel_level_.samples = samples;
+}
+
+void VoiceEngine::updateLevelMeter() {
+    uint64_t current = now(CLOCK_MONOTONIC);
+    AudioLevel level =
+        pcm_ring_ ? pcm_ring_->readLevel(pcm_ring_->sampleRate() / 10)
+                  : std::exchange(channel_level_, AudioLevel{});
+    if (level.peak > 0) {
+        last_signal_time_ = current;
+    }
+
+    std::string text = "🎤 録音中 (Shift+Space で停止) ";
+    if (current - last_signal_time_ > MIC_DEAD_US) {
+        text += "⚠ マイク入力なし";
     } else {
-        startRecording();
+        text += levelGlyph(level.rmsDb());
+    }
+
+    if (text != meter_text_) {
+        meter_text_ = text;
+        showNotification(text);
     }
 }
 
-void VoiceEngine::onTranscriptionDelta(const std::string& text) {
+void VoiceEngine::stopLevelMeter() {
+    if (meter_timer_) {
+        meter_timer_->setEnabled(false);
+    }
+    pcm_ring_.reset();
+    channel_meter_ = false;
+}
+
+void VoiceEngine::onTranscriptionDelta(const std::string& text,
+                                       const TraceStamps* trace) {
     if (text.empty()) {
         return;
     }
+    stats_.add(StatsRegistry::DeltasReceived);
+    if (preedit_pending_) {
+        stats_.add(StatsRegistry::DeltasCoalesced);
+    }
+    preedit_delta_time_ = now(CLOCK_MONOTONIC);
+    // A coalesced delta is never shown; only the one painted is traced
+    if (trace) {
+        preedit_trace_ = *trace;
+    }
+
+    // Replace preedit with latest delta (server resends full partial text
+    // each time), so deltas arriving within one frame only repaint once.
+    // Text already committed early is not shown again, also when the
+    // server revised it since (see committedLength())
+    size_t shown = committedLength(committed_, text);
+    if (*config_.earlyCommit) {
+        size_t committed = commitStablePrefix(
+            text, shown, horizon_.update(text, now(CLOCK_MONOTONIC)));
+        scheduleStableCommit();
+        if (committed > shown) {
+            // Drop the committed part from the preedit right away
+            preedit_text_.assign(text, committed);
+            flushPreedit();
+            return;
+        }
+    }
+    preedit_text_.assign(text, shown);
+    schedulePreedit();
+}
+
+size_t VoiceEngine::commitStablePrefix(const std::string& text, size_t shown,
+                                       size_t stable) {
+    stable = wordSafeLength(text, stable);
+    if (stable <= shown) {
+        return shown;
+    }
+
+    auto* ic = instance_->mostRecentInputContext();
+    if (!ic) {
+        return shown;  // Keep it in the preedit
+    }
+    ic->commitString(text.substr(shown, stable - shown));
+    stats_.add(StatsRegistry::Commits);
+    stats_.add(StatsRegistry::EarlyCommits);
+    committed_.assign(text, 0, stable);
+    return stable;
+}
+
+// StableMs is reached between deltas too: the server may go quiet
+// mid-utterance, leaving the last partial text unchanged
+void VoiceEngine::scheduleStableCommit() {
+    uint64_t deadline = horizon_.deadline(now(CLOCK_MONOTONIC));
+    if (deadline == 0) {
+        if (stable_timer_) {
+            stable_timer_->setEnabled(false);
+        }
+        return;
+    }
+    if (stable_timer_) {
+        stable_timer_->setTime(deadline);
+        stable_timer_->setOneShot();
+        return;
+    }
+    stable_timer_ = instance_->eventLoop().addTimeEvent(
+        CLOCK_MONOTONIC, deadline, 0, [this](EventSourceTime*, uint64_t) {
+            onStableDeadline();
+            return true;
+        });
+}
+
+void VoiceEngine::onStableDeadline() {
+    if (!*config_.earlyCommit) {
+        return;
+    }
+    std::string text = horizon_.text();
+    size_t shown = committedLength(committed_, text);
+    size_t committed =
+        commitStablePrefix(text, shown, horizon_.stable(now(CLOCK_MONOTONIC)));
+    scheduleStableCommit();
+    if (committed > shown) {
+        preedit_text_.assign(text, committed);
+        flushPreedit();
+    }
+}
 
-    // Replace preedit with latest delta (server resends full partial text each time)
-    preedit_text_ = text;
-    setPreedit(preedit_text_);
+// A new segment starts: nothing of it is committed yet
+void VoiceEngine::resetSegment() {
+    committed_.clear();
+    horizon_.reset();
+    if (stable_timer_) {
+        stable_timer_->setEnabled(false);
+    }
 }
 
 void VoiceEngine::onTranscriptionComplete(const std::string& text,
-                                         int segment_num) {
-    // Clear preedit (delta text is replaced by final text)
+                                         int segment_num,
+                                         const TraceStamps* trace) {
+    // Clear preedit (delta text is replaced by final text); an unpainted
+    // delta is dropped, the commit supersedes it
+    if (preedit_pending_) {
+        stats_.add(StatsRegistry::DeltasCoalesced);
+    }
+    cancelPreedit();
     preedit_text_.clear();
     clearPreedit();
 
+    // Skip what was committed early from the partial results
+    size_t skip = committedLength(committed_, text);
+    resetSegment();
+
     // Don't insert empty text
-    if (text.empty()) {
+    if (skip == text.size()) {
         return;
     }
 
@@ -155,13 +568,26 @@ void VoiceEngine::onTranscriptionComplete(const std::string& text,
         return;
     }
 
-    ic->commitString(text);
+    ic->commitString(text.substr(skip));
     ic->updateUserInterface(UserInterfaceComponent::InputPanel);
+    stats_.add(StatsRegistry::Commits);
+
+    if (trace) {
+        tracer_.record(LatencyTracer::Event::Commit, *trace,
+                       now(CLOCK_MONOTONIC));
+        // Results after the stop are the session's last; report then
+        if (state_ == RecordingState::Idle) {
+            FCITX_INFO() << "Voice latency (segment " << segment_num
+                         << "):\n" << tracer_.summary();
+        }
+    }
 }
 
 void VoiceEngine::onError(const std::string& message) {
-    FCITX_ERROR() << "Daemon error: " << message;
-    recording_ = false;
+    FCITX_ERROR() << "Voice input error: " << message;
+    native_session_ = false;
+    state_ = RecordingState::Idle;
+    stopLevelMeter();
     showTimedNotification("❌ " + message, 5000);
 }
 
@@ -187,14 +613,79 @@ void VoiceEngine::clearNotification() {
     ic->updateUserInterface(UserInterfaceComponent::InputPanel);
 }
 
-void VoiceEngine::setPreedit(const std::string& text) {
+void VoiceEngine::schedulePreedit() {
+    int fps = *config_.preeditFps;
+    uint64_t interval = fps > 0 ? 1000000 / fps : 0;
+    uint64_t deadline = last_preedit_time_ + interval;
+
+    // Leading edge: the first delta after a quiet period shows at once
+    if (now(CLOCK_MONOTONIC) >= deadline) {
+        flushPreedit();
+        return;
+    }
+    if (preedit_pending_) {
+        return;  // The armed timer will show the newest text
+    }
+
+    preedit_pending_ = true;
+    if (preedit_timer_) {
+        preedit_timer_->setTime(deadline);
+        preedit_timer_->setOneShot();
+        return;
+    }
+    preedit_timer_ = instance_->eventLoop().addTimeEvent(
+        CLOCK_MONOTONIC, deadline, 0,
+        [this](EventSourceTime*, uint64_t) {
+            flushPreedit();
+            return true;
+        });
+}
+
+void VoiceEngine::flushPreedit() {
+    auto trace = std::exchange(preedit_trace_, std::nullopt);
+    cancelPreedit();
+    auto diff = preedit_diff_.update(preedit_text_);
+    if (!diff.changed) {
+        stats_.add(StatsRegistry::DeltasUnchanged);
+        return;  // Same partial text resent; nothing to repaint
+    }
+    last_preedit_time_ = now(CLOCK_MONOTONIC);
+    setPreedit(preedit_text_, diff.stable);
+
+    uint64_t painted = now(CLOCK_MONOTONIC);
+    stats_.add(StatsRegistry::PreeditUpdates);
+    stats_.record(StatsRegistry::DeltaToPreedit,
+                  painted - preedit_delta_time_);
+    if (trace) {
+        tracer_.record(LatencyTracer::Event::Delta, *trace, painted);
+    }
+}
+
+void VoiceEngine::cancelPreedit() {
+    preedit_pending_ = false;
+    preedit_trace_.reset();
+    if (preedit_timer_) {
+        preedit_timer_->setEnabled(false);
+    }
+}
+
+void VoiceEngine::setPreedit(const std::string& text, size_t stable) {
     auto* ic = instance_->mostRecentInputContext();
     if (!ic) {
         return;
     }
 
+    // Text unchanged since the last paint is plain underlined; the tail
+    // the recognizer may still revise is highlighted
     Text preedit;
-    preedit.append(text);
+    if (stable > 0) {
+        preedit.append(text.substr(0, stable), TextFormatFlag::Underline);
+    }
+    if (stable < text.size()) {
+        preedit.append(text.substr(stable),
+                       TextFormatFlags{TextFormatFlag::Underline,
+                                       TextFormatFlag::HighLight});
+    }
     preedit.setCursor(text.length());
     ic->inputPanel().setClientPreedit(preedit);
     ic->updatePreedit();
@@ -202,6 +693,7 @@ void VoiceEngine::setPreedit(const std::string& text) {
 }
 
 void VoiceEngine::clearPreedit() {
+    preedit_diff_.reset();
     auto* ic = instance_->mostRecentInputContext();
     if (!ic) {
         return;
@@ -213,7 +705,7 @@ void VoiceEngine::clearPreedit() {
 }
 
 void VoiceEngine::updateStatus() {
-    if (recording_) {
+    if (state_ == RecordingState::Recording) {
         notification_timer_.reset();
         showNotification("🎤 録音中 (Shift+Space で停止)");
     } else {
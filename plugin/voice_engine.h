@@ -6,10 +6,28 @@
 #include <fcitx/instance.h>
 #include <fcitx-utils/event.h>
 #include <memory>
+#include <optional>
 #include "dbus_client.h"
+#include "latency_trace.h"
+#include "native_asr.h"
+#include "pcm_ring.h"
+#include "preedit_diff.h"
+#include "stats.h"
+#include "voice_config.h"
 
 namespace fcitx {
 
+/**
+ * Recording state as seen by the plugin.
+ * StartRequested covers the window between sending StartRecording
+ * and receiving the daemon's reply.
+ */
+enum class RecordingState {
+    Idle,
+    StartRequested,
+    Recording,
+};
+
 class VoiceEngine final : public InputMethodEngineV2 {
 public:
     VoiceEngine(Instance* instance);
@@ -24,29 +42,77 @@ public:
     void reset(const InputMethodEntry& entry,
               InputContextEvent& event) override;
 
+    const Configuration* getConfig() const override { return &config_; }
+    void setConfig(const RawConfig& config) override;
+    void reloadConfig() override;
+
     // Instance access
     Instance* instance() { return instance_; }
 
 private:
     void startRecording();
+    void startNativeRecording();
+    std::unique_ptr<NativeAsrClient> createNativeAsr();
+    void onNativeFinished();
     void stopRecording();
+    void finishRecording();
     void toggleRecording();
-    void onTranscriptionComplete(const std::string& text, int segment_num);
-    void onTranscriptionDelta(const std::string& text);
+    void onDaemonChanged(bool running);
+    void onStartReply(bool ok, const std::string& error);
+    void prewarm();
+    void configureEventChannel();
+    void openLevelMeter();
+    void startMeterTimer();
+    void updateLevelMeter();
+    void stopLevelMeter();
+    void onAudioLevel(const AudioLevel& level);
+    void onTranscriptionComplete(const std::string& text, int segment_num,
+                                 const TraceStamps* trace);
+    void onTranscriptionDelta(const std::string& text,
+                              const TraceStamps* trace);
     void onError(const std::string& message);
     void showNotification(const std::string& message);
     void clearNotification();
-    void setPreedit(const std::string& text);
+    size_t commitStablePrefix(const std::string& text, size_t shown,
+                              size_t stable);
+    void scheduleStableCommit();
+    void onStableDeadline();
+    void resetSegment();
+    void schedulePreedit();
+    void flushPreedit();
+    void cancelPreedit();
+    void setPreedit(const std::string& text, size_t stable);
     void clearPreedit();
     void updateStatus();
     void showTimedNotification(const std::string& message, uint64_t duration_ms);
 
     Instance* instance_;
+    VoiceConfig config_;
+    StatsRegistry stats_;  // Exported by dbus_client_, so declared first
     std::unique_ptr<DBusClient> dbus_client_;
-    std::unique_ptr<EventSource> event_source_;
+    std::unique_ptr<NativeAsrClient> native_asr_;  // In-process transport, created on first use
+    bool native_session_ = false;    // Current session uses native_asr_
+    bool native_asr_stale_ = false;  // Config changed since native_asr_ was created
     std::unique_ptr<EventSource> notification_timer_;
-    bool recording_ = false;
-    std::string preedit_text_;  // Current delta text shown as preedit (replaced on each delta)
+    std::unique_ptr<EventSourceTime> meter_timer_;          // 10 Hz input level refresh
+    std::unique_ptr<PcmRingReader> pcm_ring_;                // Daemon's shared PCM ring
+    bool channel_meter_ = false;  // Meter fed by event channel levels instead
+    AudioLevel channel_level_;    // Channel levels since the last meter refresh
+    uint64_t last_signal_time_ = 0;  // Last time the meter saw non-zero audio
+    uint64_t last_prewarm_time_ = 0;  // Last Prewarm call, to rate-limit them
+    std::string meter_text_;         // Last level text shown, to skip identical repaints
+    RecordingState state_ = RecordingState::Idle;
+    std::string preedit_text_;  // Latest delta text (replaced on each delta)
+    PreeditDiff preedit_diff_;  // Text last painted, for stable/volatile split
+    StableHorizon horizon_{4, 0};  // EarlyCommit: stable prefix of the segment
+    std::string committed_;     // Prefix of the segment already committed early
+    std::unique_ptr<EventSourceTime> stable_timer_;  // EarlyCommit: next StableMs age
+    std::unique_ptr<EventSourceTime> preedit_timer_;  // Coalesces deltas to PreeditFps
+    bool preedit_pending_ = false;    // preedit_text_ not shown yet; timer armed
+    uint64_t last_preedit_time_ = 0;  // Last preedit repaint
+    uint64_t preedit_delta_time_ = 0; // Arrival of the delta in preedit_text_
+    LatencyTracer tracer_;             // Daemon --trace stamps, per stage
+    std::optional<TraceStamps> preedit_trace_;  // Of preedit_text_, until painted
 };
 
 class VoiceEngineFactory : public AddonFactory {
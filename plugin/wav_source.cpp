@@ -0,0 +1,134 @@
+#include "wav_source.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace fcitx {
+
+namespace {
+
+uint32_t readLe32(const char* p) {
+    return static_cast<uint8_t>(p[0]) | (static_cast<uint8_t>(p[1]) << 8) |
+           (static_cast<uint8_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(p[3])) << 24);
+}
+
+uint16_t readLe16(const char* p) {
+    return static_cast<uint8_t>(p[0]) | (static_cast<uint8_t>(p[1]) << 8);
+}
+
+uint64_t monotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+} // namespace
+
+WavReplaySource::WavReplaySource(Options options)
+    : options_(std::move(options)) {
+    std::ifstream file(options_.path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open WAV file: " + options_.path);
+    }
+    std::string data((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+    if (data.size() < 12 || data.compare(0, 4, "RIFF") != 0 ||
+        data.compare(8, 4, "WAVE") != 0) {
+        throw std::runtime_error("Not a WAV file: " + options_.path);
+    }
+
+    bool have_format = false;
+    size_t pos = 12;
+    while (pos + 8 <= data.size()) {
+        std::string_view id(data.data() + pos, 4);
+        size_t size = readLe32(data.data() + pos + 4);
+        const char* body = data.data() + pos + 8;
+        size = std::min(size, data.size() - pos - 8);
+
+        if (id == "fmt " && size >= 16) {
+            uint16_t format = readLe16(body);
+            uint16_t channels = readLe16(body + 2);
+            uint16_t bits = readLe16(body + 14);
+            if (format != 1 || bits != 16) {
+                throw std::runtime_error("WAV must be 16-bit PCM");
+            }
+            if (channels != 1) {
+                throw std::runtime_error("WAV must be mono");
+            }
+            sample_rate_ = readLe32(body + 4);
+            have_format = true;
+        } else if (id == "data" && have_format) {
+            samples_.resize(size / 2);
+            std::memcpy(samples_.data(), body, samples_.size() * 2);
+            break;
+        }
+        pos += 8 + size + (size & 1);  // Chunks are word aligned
+    }
+    if (!have_format || sample_rate_ == 0 || samples_.empty()) {
+        throw std::runtime_error("WAV has no PCM data: " + options_.path);
+    }
+
+    chunk_samples_ = sample_rate_ * options_.chunk_ms / 1000;
+    if (chunk_samples_ == 0 || options_.speed <= 0) {
+        throw std::runtime_error("Invalid WAV replay options");
+    }
+    total_chunks_ = (samples_.size() + chunk_samples_ - 1) / chunk_samples_;
+    interval_ns_ = std::max<uint64_t>(
+        1, static_cast<uint64_t>(options_.chunk_ms * 1e6 / options_.speed));
+
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (timer_fd_ < 0) {
+        throw std::runtime_error("Failed to create replay timerfd");
+    }
+}
+
+WavReplaySource::~WavReplaySource() { close(timer_fd_); }
+
+void WavReplaySource::start() {
+    next_chunk_ = 0;
+    start_ns_ = monotonicNs();
+
+    itimerspec spec{};
+    spec.it_interval.tv_sec = interval_ns_ / 1000000000;
+    spec.it_interval.tv_nsec = interval_ns_ % 1000000000;
+    spec.it_value = spec.it_interval;
+    timerfd_settime(timer_fd_, 0, &spec, nullptr);
+}
+
+void WavReplaySource::stop() {
+    itimerspec spec{};
+    timerfd_settime(timer_fd_, 0, &spec, nullptr);
+}
+
+size_t WavReplaySource::dueChunks() const {
+    return std::min<size_t>(total_chunks_,
+                            (monotonicNs() - start_ns_) / interval_ns_);
+}
+
+bool WavReplaySource::readChunk(int16_t* out) {
+    if (next_chunk_ >= dueChunks()) {
+        return false;
+    }
+
+    // The last chunk is zero-padded to full size
+    size_t offset = next_chunk_ * chunk_samples_;
+    size_t n = std::min(chunk_samples_, samples_.size() - offset);
+    std::copy_n(samples_.data() + offset, n, out);
+    std::fill(out + n, out + chunk_samples_, 0);
+    ++next_chunk_;
+
+    if (exhausted()) {
+        stop();
+    }
+    return true;
+}
+
+void WavReplaySource::drain() { next_chunk_ = dueChunks(); }
+
+} // namespace fcitx
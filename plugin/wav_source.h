@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "audio_source.h"
+
+namespace fcitx {
+
+/**
+ * Replays a PCM16 mono WAV file as if it were being captured, for
+ * testing the native transport without a microphone. Chunks become
+ * available at real-time pace (scaled by speed), signalled through a
+ * timerfd.
+ */
+class WavReplaySource final : public AudioSource {
+public:
+    struct Options {
+        std::string path;
+        unsigned chunk_ms = 20;
+        double speed = 1.0;  // > 1 replays faster than real time
+    };
+
+    /**
+     * Load the whole file.
+     * @throws std::runtime_error if it is not a 16-bit PCM mono WAV
+     */
+    explicit WavReplaySource(Options options);
+    ~WavReplaySource() override;
+
+    void start() override;
+    void stop() override;
+    bool readChunk(int16_t* out) override;
+    void drain() override;
+
+    int eventFd() const override { return timer_fd_; }
+    size_t chunkSamples() const override { return chunk_samples_; }
+    unsigned sampleRate() const override { return sample_rate_; }
+    bool exhausted() const override { return next_chunk_ >= total_chunks_; }
+
+private:
+    size_t dueChunks() const;
+
+    Options options_;
+    std::vector<int16_t> samples_;
+    unsigned sample_rate_ = 0;
+    size_t chunk_samples_ = 0;
+    size_t total_chunks_ = 0;
+    size_t next_chunk_ = 0;
+    uint64_t interval_ns_ = 0;
+    uint64_t start_ns_ = 0;
+    int timer_fd_ = -1;
+};
+
+} // namespace fcitx
@@ -0,0 +1,558 @@
+#include "websocket.h"
+#include "base64.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace fcitx {
+
+namespace {
+
+constexpr uint8_t OP_CONTINUATION = 0x0;
+constexpr uint8_t OP_TEXT = 0x1;
+constexpr uint8_t OP_BINARY = 0x2;
+constexpr uint8_t OP_CLOSE = 0x8;
+constexpr uint8_t OP_PING = 0x9;
+constexpr uint8_t OP_PONG = 0xA;
+
+constexpr size_t MAX_MESSAGE_SIZE = 16 << 20;
+constexpr size_t MAX_HANDSHAKE_SIZE = 16 << 10;
+constexpr size_t RECV_CHUNK = 64 << 10;
+
+constexpr char HANDSHAKE_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// SHA-1 (RFC 3174), only used to verify Sec-WebSocket-Accept
+std::array<uint8_t, 20> sha1(std::string_view input) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476,
+                     0xC3D2E1F0};
+
+    std::string msg(input);
+    uint64_t bit_length = static_cast<uint64_t>(input.size()) * 8;
+    msg.push_back(static_cast<char>(0x80));
+    while (msg.size() % 64 != 56) {
+        msg.push_back(0);
+    }
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        msg.push_back(static_cast<char>(bit_length >> shift));
+    }
+
+    auto rotl = [](uint32_t v, int n) { return (v << n) | (v >> (32 - n)); };
+    for (size_t block = 0; block < msg.size(); block += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            auto* p = reinterpret_cast<const uint8_t*>(msg.data() + block + i * 4);
+            w[i] = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t t = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    std::array<uint8_t, 20> digest;
+    for (int i = 0; i < 20; ++i) {
+        digest[i] = static_cast<uint8_t>(h[i / 4] >> (24 - (i % 4) * 8));
+    }
+    return digest;
+}
+
+void fillRandom(void* buf, size_t n) {
+    auto* p = static_cast<uint8_t*>(buf);
+    while (n > 0) {
+        ssize_t got = getrandom(p, n, 0);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("getrandom failed");
+        }
+        p += got;
+        n -= got;
+    }
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+               return std::tolower(static_cast<unsigned char>(x)) ==
+                      std::tolower(static_cast<unsigned char>(y));
+           });
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+} // namespace
+
+WebSocketClient::~WebSocketClient() { close(); }
+
+void WebSocketClient::connect(const std::string& url) {
+    close();
+
+    constexpr std::string_view scheme = "ws://";
+    if (url.compare(0, 6, "wss://") == 0) {
+        throw std::runtime_error("wss:// is not supported: " + url);
+    }
+    if (url.compare(0, scheme.size(), scheme) != 0) {
+        throw std::runtime_error("Not a ws:// URL: " + url);
+    }
+
+    std::string_view rest(url);
+    rest.remove_prefix(scheme.size());
+    size_t authority_end = rest.find_first_of("/?");
+    std::string_view authority = rest.substr(0, authority_end);
+    path_ = authority_end == std::string_view::npos
+                ? "/"
+                : std::string(rest.substr(authority_end));
+    if (path_.front() == '?') {
+        path_.insert(0, "/");
+    }
+
+    std::string host;
+    std::string port = "80";
+    if (!authority.empty() && authority.front() == '[') {
+        size_t close_bracket = authority.find(']');
+        if (close_bracket == std::string_view::npos) {
+            throw std::runtime_error("Malformed URL: " + url);
+        }
+        host = authority.substr(1, close_bracket - 1);
+        if (authority.size() > close_bracket + 1) {
+            if (authority[close_bracket + 1] != ':') {
+                throw std::runtime_error("Malformed URL: " + url);
+            }
+            port = authority.substr(close_bracket + 2);
+        }
+    } else {
+        size_t colon = authority.rfind(':');
+        host = authority.substr(0, colon);
+        if (colon != std::string_view::npos) {
+            port = authority.substr(colon + 1);
+        }
+    }
+    if (host.empty() || port.empty()) {
+        throw std::runtime_error("Malformed URL: " + url);
+    }
+    host_header_ = authority;
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    int err = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+    if (err != 0) {
+        throw std::runtime_error("Failed to resolve " + host + ": " +
+                                 gai_strerror(err));
+    }
+
+    std::string last_error = "no addresses";
+    for (addrinfo* ai = result; ai; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family,
+                        ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                        ai->ai_protocol);
+        if (fd < 0) {
+            last_error = strerror(errno);
+            continue;
+        }
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0 ||
+            errno == EINPROGRESS) {
+            fd_ = fd;
+            break;
+        }
+        last_error = strerror(errno);
+        ::close(fd);
+    }
+    freeaddrinfo(result);
+
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to connect to " + host_header_ +
+                                 ": " + last_error);
+    }
+
+    // Audio chunks and commits are small; don't let Nagle hold them back
+    int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    uint8_t nonce[16];
+    fillRandom(nonce, sizeof(nonce));
+    fillRandom(&mask_state_, sizeof(mask_state_));
+    mask_state_ |= 1;  // xorshift state must be non-zero
+
+    std::string key;
+    base64Append(nonce, sizeof(nonce), key);
+    auto digest = sha1(key + HANDSHAKE_GUID);
+    accept_key_.clear();
+    base64Append(digest.data(), digest.size(), accept_key_);
+
+    send_buffer_ = "GET " + path_ + " HTTP/1.1\r\n"
+                   "Host: " + host_header_ + "\r\n"
+                   "Upgrade: websocket\r\n"
+                   "Connection: Upgrade\r\n"
+                   "Sec-WebSocket-Key: " + key + "\r\n"
+                   "Sec-WebSocket-Version: 13\r\n"
+                   "\r\n";
+    state_ = State::Connecting;
+}
+
+bool WebSocketClient::sendText(std::string_view payload) {
+    if (state_ != State::Open) {
+        return false;
+    }
+    appendFrame(OP_TEXT, payload);
+    flush();
+    return state_ == State::Open;
+}
+
+void WebSocketClient::handleEvents(bool readable, bool writable) {
+    if (state_ == State::Connecting) {
+        if (!readable && !writable) {
+            return;
+        }
+        onConnected();
+        if (state_ != State::Handshake) {
+            return;
+        }
+        // Send the upgrade request now; the reply comes with a later event
+        flush();
+        return;
+    }
+
+    if (writable && !send_buffer_.empty()) {
+        flush();
+    }
+    if (!readable || state_ == State::Closed) {
+        return;
+    }
+
+    // Drain the socket, then parse everything that arrived
+    bool eof = false;
+    while (true) {
+        size_t offset = recv_buffer_.size();
+        recv_buffer_.resize(offset + RECV_CHUNK);
+        ssize_t n = recv(fd_, recv_buffer_.data() + offset, RECV_CHUNK, 0);
+        recv_buffer_.resize(offset + std::max<ssize_t>(n, 0));
+        if (n > 0) {
+            continue;
+        }
+        if (n == 0) {
+            eof = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            fail(std::string("Receive failed: ") + strerror(errno));
+            return;
+        }
+        break;
+    }
+
+    if (state_ == State::Handshake) {
+        readHandshake();
+    }
+    if (state_ == State::Open) {
+        readFrames();
+    }
+    if (eof && state_ != State::Closed) {
+        fail("Connection closed by server");
+    }
+}
+
+void WebSocketClient::close() {
+    if (fd_ >= 0) {
+        if (state_ == State::Open) {
+            // Status 1000 (normal closure); dropped if the socket is full
+            const char status[] = {0x03, static_cast<char>(0xE8)};
+            appendFrame(OP_CLOSE, std::string_view(status, 2));
+            send(fd_, send_buffer_.data(), send_buffer_.size(),
+                 MSG_NOSIGNAL | MSG_DONTWAIT);
+        }
+        ::close(fd_);
+        fd_ = -1;
+    }
+    state_ = State::Closed;
+    send_buffer_.clear();
+    recv_buffer_.clear();
+    message_.clear();
+    in_fragmented_ = false;
+}
+
+void WebSocketClient::appendFrame(uint8_t opcode, std::string_view payload) {
+    size_t n = payload.size();
+    send_buffer_.push_back(static_cast<char>(0x80 | opcode));  // FIN
+    if (n < 126) {
+        send_buffer_.push_back(static_cast<char>(0x80 | n));
+    } else if (n <= 0xFFFF) {
+        send_buffer_.push_back(static_cast<char>(0x80 | 126));
+        send_buffer_.push_back(static_cast<char>(n >> 8));
+        send_buffer_.push_back(static_cast<char>(n));
+    } else {
+        send_buffer_.push_back(static_cast<char>(0x80 | 127));
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            send_buffer_.push_back(static_cast<char>(n >> shift));
+        }
+    }
+
+    // Client frames must be masked
+    mask_state_ ^= mask_state_ << 13;
+    mask_state_ ^= mask_state_ >> 17;
+    mask_state_ ^= mask_state_ << 5;
+    uint8_t mask[4];
+    std::memcpy(mask, &mask_state_, 4);
+    send_buffer_.append(reinterpret_cast<const char*>(mask), 4);
+
+    size_t offset = send_buffer_.size();
+    send_buffer_.resize(offset + n);
+    char* dst = send_buffer_.data() + offset;
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = static_cast<char>(payload[i] ^ mask[i & 3]);
+    }
+}
+
+void WebSocketClient::flush() {
+    size_t written = 0;
+    while (written < send_buffer_.size()) {
+        ssize_t n = send(fd_, send_buffer_.data() + written,
+                         send_buffer_.size() - written,
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n >= 0) {
+            written += n;
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        fail(std::string("Send failed: ") + strerror(errno));
+        return;
+    }
+    send_buffer_.erase(0, written);
+}
+
+void WebSocketClient::onConnected() {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &len) < 0) {
+        err = errno;
+    }
+    if (err != 0) {
+        fail("Failed to connect to " + host_header_ + ": " + strerror(err));
+        return;
+    }
+    state_ = State::Handshake;
+}
+
+void WebSocketClient::readHandshake() {
+    size_t end = recv_buffer_.find("\r\n\r\n");
+    if (end == std::string::npos) {
+        if (recv_buffer_.size() > MAX_HANDSHAKE_SIZE) {
+            fail("Handshake response too large");
+        }
+        return;
+    }
+
+    std::string_view response(recv_buffer_.data(), end);
+    size_t line_end = response.find("\r\n");
+    std::string_view status_line = response.substr(0, line_end);
+    if (status_line.substr(0, 9) != "HTTP/1.1 " ||
+        status_line.substr(9, 3) != "101") {
+        fail("Handshake rejected: " + std::string(status_line));
+        return;
+    }
+
+    bool accepted = false;
+    while (line_end != std::string_view::npos) {
+        size_t start = line_end + 2;
+        line_end = response.find("\r\n", start);
+        std::string_view line = response.substr(start, line_end - start);
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        if (equalsIgnoreCase(trim(line.substr(0, colon)),
+                             "Sec-WebSocket-Accept")) {
+            accepted = trim(line.substr(colon + 1)) == accept_key_;
+        }
+    }
+    if (!accepted) {
+        fail("Handshake failed: bad Sec-WebSocket-Accept");
+        return;
+    }
+
+    // Frames may follow the response in the same read
+    recv_buffer_.erase(0, end + 4);
+    state_ = State::Open;
+    if (open_callback_) {
+        open_callback_();
+    }
+}
+
+void WebSocketClient::readFrames() {
+    size_t pos = 0;
+    while (state_ == State::Open) {
+        auto* p = reinterpret_cast<const uint8_t*>(recv_buffer_.data()) + pos;
+        size_t available = recv_buffer_.size() - pos;
+        if (available < 2) {
+            break;
+        }
+
+        bool fin = p[0] & 0x80;
+        uint8_t opcode = p[0] & 0x0F;
+        bool masked = p[1] & 0x80;
+        uint64_t length = p[1] & 0x7F;
+        size_t header = 2;
+        if (length == 126) {
+            header += 2;
+            if (available < header) {
+                break;
+            }
+            length = (p[2] << 8) | p[3];
+        } else if (length == 127) {
+            header += 8;
+            if (available < header) {
+                break;
+            }
+            length = 0;
+            for (int i = 0; i < 8; ++i) {
+                length = (length << 8) | p[2 + i];
+            }
+        }
+        if (length > MAX_MESSAGE_SIZE) {
+            fail("Message too large");
+            return;
+        }
+        size_t mask_offset = header;
+        if (masked) {
+            header += 4;
+        }
+        if (available < header + length) {
+            break;
+        }
+
+        char* payload = recv_buffer_.data() + pos + header;
+        if (masked) {
+            // Servers must not mask, but unmasking costs nothing
+            for (size_t i = 0; i < length; ++i) {
+                payload[i] ^= p[mask_offset + (i & 3)];
+            }
+        }
+        std::string_view data(payload, length);
+        pos += header + length;
+
+        switch (opcode) {
+        case OP_TEXT:
+        case OP_BINARY:
+            if (in_fragmented_) {
+                fail("Protocol error: interleaved message");
+                return;
+            }
+            if (fin) {
+                if (message_callback_) {
+                    message_callback_(data);
+                }
+            } else {
+                message_.assign(data);
+                in_fragmented_ = true;
+            }
+            break;
+        case OP_CONTINUATION:
+            if (!in_fragmented_) {
+                fail("Protocol error: unexpected continuation");
+                return;
+            }
+            if (message_.size() + data.size() > MAX_MESSAGE_SIZE) {
+                fail("Message too large");
+                return;
+            }
+            message_.append(data);
+            if (fin) {
+                in_fragmented_ = false;
+                if (message_callback_) {
+                    message_callback_(message_);
+                }
+                message_.clear();
+            }
+            break;
+        case OP_PING:
+            appendFrame(OP_PONG, data);
+            flush();
+            break;
+        case OP_PONG:
+            break;
+        case OP_CLOSE: {
+            std::string reason = "Connection closed by server";
+            if (data.size() >= 2) {
+                int code = (static_cast<uint8_t>(data[0]) << 8) |
+                           static_cast<uint8_t>(data[1]);
+                reason += " (" + std::to_string(code);
+                if (data.size() > 2) {
+                    reason += ": " + std::string(data.substr(2));
+                }
+                reason += ")";
+            }
+            fail(reason);
+            return;
+        }
+        default:
+            fail("Protocol error: unknown opcode " + std::to_string(opcode));
+            return;
+        }
+    }
+
+    // A callback may have closed the connection and cleared the buffer
+    if (state_ == State::Open) {
+        recv_buffer_.erase(0, pos);
+    }
+}
+
+void WebSocketClient::fail(const std::string& reason) {
+    close();
+    if (close_callback_) {
+        close_callback_(reason);
+    }
+}
+
+} // namespace fcitx
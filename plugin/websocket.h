@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace fcitx {
+
+/**
+ * Minimal non-blocking RFC 6455 WebSocket client (ws:// only).
+ *
+ * The client owns a non-blocking TCP socket but no event loop: the owner
+ * watches fd() (for output as well while wantsWrite() is true) and calls
+ * handleEvents() when it is ready. Text messages are delivered through
+ * the message callback as views into the receive buffer, valid only for
+ * the duration of the call. Pings are answered, fragmented messages are
+ * reassembled, and extensions (permessage-deflate) are not negotiated.
+ *
+ * Callbacks run from inside connect()/handleEvents()/sendText() and must
+ * not destroy the client.
+ */
+class WebSocketClient {
+public:
+    enum class State {
+        Closed,
+        Connecting,  // TCP connect in progress
+        Handshake,   // HTTP upgrade sent, waiting for 101
+        Open,
+    };
+
+    using OpenCallback = std::function<void()>;
+    using MessageCallback = std::function<void(std::string_view message)>;
+    using CloseCallback = std::function<void(const std::string& reason)>;
+
+    WebSocketClient() = default;
+    ~WebSocketClient();
+
+    WebSocketClient(const WebSocketClient&) = delete;
+    WebSocketClient& operator=(const WebSocketClient&) = delete;
+
+    void setOpenCallback(OpenCallback cb) { open_callback_ = std::move(cb); }
+    void setMessageCallback(MessageCallback cb) {
+        message_callback_ = std::move(cb);
+    }
+    void setCloseCallback(CloseCallback cb) { close_callback_ = std::move(cb); }
+
+    /**
+     * Start connecting to a ws://host[:port]/path URL. Name resolution is
+     * synchronous; the TCP connect and handshake complete in handleEvents().
+     * @throws std::runtime_error on a malformed URL or resolution failure
+     */
+    void connect(const std::string& url);
+
+    /**
+     * Queue a text message. Whatever the socket accepts is written
+     * immediately; the rest is flushed from handleEvents().
+     * @return false if the connection is not open
+     */
+    bool sendText(std::string_view payload);
+
+    /**
+     * Process socket readiness. Fires the open, message and close
+     * callbacks as the connection progresses.
+     */
+    void handleEvents(bool readable, bool writable);
+
+    /**
+     * Close the connection immediately (after a best-effort close frame).
+     * Does not fire the close callback.
+     */
+    void close();
+
+    State state() const { return state_; }
+    int fd() const { return fd_; }
+
+    /** True while the owner should also watch fd() for writability. */
+    bool wantsWrite() const {
+        return state_ == State::Connecting || !send_buffer_.empty();
+    }
+
+private:
+    void appendFrame(uint8_t opcode, std::string_view payload);
+    void flush();
+    void onConnected();
+    void readHandshake();
+    void readFrames();
+    void fail(const std::string& reason);
+
+    int fd_ = -1;
+    State state_ = State::Closed;
+    std::string host_header_;
+    std::string path_;
+    std::string accept_key_;    // Expected Sec-WebSocket-Accept
+    std::string send_buffer_;   // Framed output not yet written
+    std::string recv_buffer_;   // Unparsed input
+    std::string message_;       // Reassembly buffer for fragmented messages
+    bool in_fragmented_ = false;
+    uint32_t mask_state_ = 0;   // xorshift state for frame masks
+    OpenCallback open_callback_;
+    MessageCallback message_callback_;
+    CloseCallback close_callback_;
+};
+
+} // namespace fcitx
@@ -77,11 +77,14 @@ echo ""
 
 # 2. Build and install C++ plugin
 echo "==> Building C++ plugin..."
+# Build daemon/_native against the venv's Python
+PYTHON_PATH=$(uv run python -c 'import sys; print(sys.executable)')
 mkdir -p build
 cd build
 
 if [ "$LOCAL_INSTALL" = true ]; then
-    cmake .. -DCMAKE_INSTALL_PREFIX="$HOME/.local" -DCMAKE_BUILD_TYPE=Release
+    cmake .. -DCMAKE_INSTALL_PREFIX="$HOME/.local" -DCMAKE_BUILD_TYPE=Release \
+        -DPython3_EXECUTABLE="$PYTHON_PATH"
     make -j$(nproc)
     echo "✓ C++ plugin built"
 
@@ -90,7 +93,8 @@ if [ "$LOCAL_INSTALL" = true ]; then
     cd ..
     echo "✓ C++ plugin installed to ~/.local"
 else
-    cmake .. -DCMAKE_INSTALL_PREFIX=/usr -DCMAKE_BUILD_TYPE=Release
+    cmake .. -DCMAKE_INSTALL_PREFIX=/usr -DCMAKE_BUILD_TYPE=Release \
+        -DPython3_EXECUTABLE="$PYTHON_PATH"
     make -j$(nproc)
     echo "✓ C++ plugin built"
 
@@ -117,11 +121,14 @@ sleep 2  # Wait for daemon to start
 echo "✓ Daemon started"
 echo ""
 
-# 4. Install D-Bus interface (for reference)
+# 4. Install D-Bus interface (for reference) and activation file
 echo "==> Installing D-Bus interface definition..."
 mkdir -p ~/.local/share/dbus-1/interfaces/
 cp dbus/org.fcitx.Fcitx5.Voice.xml ~/.local/share/dbus-1/interfaces/
 echo "✓ D-Bus interface installed"
+mkdir -p ~/.local/share/dbus-1/services/
+cp dbus/org.fcitx.Fcitx5.Voice.service ~/.local/share/dbus-1/services/
+echo "✓ D-Bus activation installed (daemon starts on demand)"
 echo ""
 
 # 5. Restart fcitx5
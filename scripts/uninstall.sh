@@ -38,8 +38,9 @@ rm -f ~/.local/bin/fcitx5-voice-daemon
 echo "✓ Daemon binary removed"
 echo ""
 
-# 4. Remove D-Bus interface
+# 4. Remove D-Bus interface and activation file
 rm -f ~/.local/share/dbus-1/interfaces/org.fcitx.Fcitx5.Voice.xml
+rm -f ~/.local/share/dbus-1/services/org.fcitx.Fcitx5.Voice.service
 echo "✓ D-Bus interface removed"
 echo ""
 
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+/*
+ * Checks for the plain test executables: a failed check reports its
+ * location and the values compared, and main() returns testResult(),
+ * which is non-zero if any check failed.
+ */
+
+inline int test_failures = 0;
+
+inline void testFail(const char* file, int line, const std::string& what) {
+    std::fprintf(stderr, "%s:%d: %s\n", file, line, what.c_str());
+    ++test_failures;
+}
+
+inline int testResult() {
+    if (test_failures) {
+        std::fprintf(stderr, "%d check(s) failed\n", test_failures);
+    }
+    return test_failures ? 1 : 0;
+}
+
+#define CHECK(cond)                                              \
+    do {                                                         \
+        if (!(cond)) {                                           \
+            testFail(__FILE__, __LINE__, "CHECK(" #cond ")");    \
+        }                                                        \
+    } while (0)
+
+// Operands are printed with std::to_string() or as strings
+#define CHECK_EQ(a, b)                                                  \
+    do {                                                                \
+        auto&& check_a = (a);                                           \
+        auto&& check_b = (b);                                           \
+        if (!(check_a == check_b)) {                                    \
+            testFail(__FILE__, __LINE__,                                \
+                     "CHECK_EQ(" #a ", " #b "): " +                     \
+                         testString(check_a) + " != " +                 \
+                         testString(check_b));                          \
+        }                                                               \
+    } while (0)
+
+inline std::string testString(const std::string& s) { return '"' + s + '"'; }
+inline std::string testString(const char* s) { return testString(std::string(s)); }
+inline std::string testString(std::string_view s) { return testString(std::string(s)); }
+template <typename T>
+std::string testString(const T& value) {
+    return std::to_string(value);
+}
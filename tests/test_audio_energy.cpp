@@ -0,0 +1,88 @@
+#include "audio_energy.h"
+#include "test.h"
+#include <random>
+#include <vector>
+
+using namespace fcitx;
+
+// Every kernel must agree with the scalar one for all lengths around
+// its vector width (16 samples for AVX2, 8 for SSE2 and NEON) and its
+// loop's one-lane overlap, and at any alignment.
+static void checkKernels(const std::vector<int16_t>& samples) {
+    for (const auto& kernel : detail::energyKernels()) {
+        for (size_t offset = 0; offset < 2; ++offset) {
+            for (size_t n = 0; n + offset <= samples.size(); ++n) {
+                const int16_t* s = samples.data() + offset;
+                EnergyStats expected = detail::computeEnergyScalar(s, n);
+                EnergyStats actual = kernel.fn(s, n);
+                if (actual.sum_squares != expected.sum_squares ||
+                    actual.peak != expected.peak ||
+                    actual.zero_crossings != expected.zero_crossings ||
+                    actual.samples != expected.samples) {
+                    testFail(__FILE__, __LINE__,
+                             std::string(kernel.name) + " differs at n=" +
+                                 std::to_string(n) + " offset=" +
+                                 std::to_string(offset));
+                }
+            }
+        }
+    }
+}
+
+static void testRandom() {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> dist(INT16_MIN, INT16_MAX);
+    std::vector<int16_t> samples(100);
+    for (auto& s : samples) {
+        s = static_cast<int16_t>(dist(rng));
+    }
+    checkKernels(samples);
+}
+
+// Full scale: -32768 has no positive counterpart in int16
+static void testExtremes() {
+    std::vector<int16_t> samples(100);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = i % 3 == 0 ? INT16_MIN : (i % 3 == 1 ? INT16_MAX : 0);
+    }
+    checkKernels(samples);
+    samples.assign(100, INT16_MIN);
+    checkKernels(samples);
+
+    EnergyStats stats = computeEnergy(samples.data(), samples.size());
+    CHECK_EQ(stats.peak, 32768);
+    CHECK_EQ(stats.sum_squares, 100ull * 32768 * 32768);
+    CHECK_EQ(stats.zero_crossings, 0u);
+}
+
+// Zero counts as positive: 0 -> -1 and -1 -> 0 cross, 1 -> 0 does not
+static void testCrossings() {
+    std::vector<int16_t> samples;
+    for (int i = 0; i < 40; ++i) {
+        samples.insert(samples.end(), {1, 0, -1, 0, 1, -1});
+    }
+    checkKernels(samples);
+
+    EnergyStats stats = computeEnergy(samples.data(), 6);
+    CHECK_EQ(stats.zero_crossings, 3u);
+}
+
+static void testMerge() {
+    std::vector<int16_t> samples = {100, -200, 300, -400, 500, -600};
+    EnergyStats whole = computeEnergy(samples.data(), 6);
+    EnergyStats head = computeEnergy(samples.data(), 3);
+    head.merge(computeEnergy(samples.data() + 3, 3), true);
+    CHECK_EQ(head.sum_squares, whole.sum_squares);
+    CHECK_EQ(head.peak, whole.peak);
+    CHECK_EQ(head.zero_crossings, whole.zero_crossings);
+    CHECK_EQ(head.samples, whole.samples);
+    CHECK_EQ(computeEnergy(nullptr, 0).rms(), 0.0);
+}
+
+int main() {
+    testRandom();
+    testExtremes();
+    testCrossings();
+    testMerge();
+    return testResult();
+}
@@ -0,0 +1,67 @@
+#include "base64.h"
+#include "test.h"
+#include <random>
+#include <vector>
+
+using namespace fcitx;
+
+// RFC 4648 test vectors
+static void testVectors() {
+    const std::pair<const char*, const char*> vectors[] = {
+        {"", ""},
+        {"f", "Zg=="},
+        {"fo", "Zm8="},
+        {"foo", "Zm9v"},
+        {"foob", "Zm9vYg=="},
+        {"fooba", "Zm9vYmE="},
+        {"foobar", "Zm9vYmFy"},
+    };
+    for (const auto& [input, expected] : vectors) {
+        std::string out = "prefix:";
+        base64Append(reinterpret_cast<const uint8_t*>(input),
+                     std::char_traits<char>::length(input), out);
+        CHECK_EQ(out, std::string("prefix:") + expected);
+    }
+}
+
+// Every kernel must agree with the scalar one for all lengths around its
+// block size (12 input bytes for SSSE3, 24 for AVX2, 48 for NEON) and
+// the extra bytes its loads read, at any alignment, and must not write
+// past base64EncodedSize().
+static void testKernels() {
+    std::mt19937 rng(1);
+    std::vector<uint8_t> data(160);
+    for (auto& byte : data) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    // All 64 symbols, in the first block too
+    for (size_t i = 0; i < 48; ++i) {
+        data[i] = static_cast<uint8_t>(i * 0x15);
+    }
+
+    for (const auto& kernel : detail::base64Kernels()) {
+        for (size_t offset = 0; offset < 2; ++offset) {
+            for (size_t n = 0; n + offset <= data.size(); ++n) {
+                std::string expected(base64EncodedSize(n), '\0');
+                detail::base64EncodeScalar(data.data() + offset, n,
+                                           expected.data());
+                std::string actual(base64EncodedSize(n) + 64, '#');
+                kernel.fn(data.data() + offset, n, actual.data());
+                if (actual.compare(0, expected.size(), expected) != 0 ||
+                    actual.find_first_not_of('#', expected.size()) !=
+                        std::string::npos) {
+                    testFail(__FILE__, __LINE__,
+                             std::string(kernel.name) + " differs at n=" +
+                                 std::to_string(n) + " offset=" +
+                                 std::to_string(offset));
+                }
+            }
+        }
+    }
+}
+
+int main() {
+    testVectors();
+    testKernels();
+    return testResult();
+}
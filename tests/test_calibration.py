@@ -0,0 +1,120 @@
+"""Tests for daemon/calibration.py."""
+
+import os
+import tempfile
+import unittest
+from pathlib import Path
+from unittest import mock
+
+from daemon import calibration
+from daemon.calibration import NoiseFloorCache
+
+
+class NoiseFloorCacheTest(unittest.TestCase):
+    def setUp(self):
+        self._dir = tempfile.TemporaryDirectory()
+        self.path = Path(self._dir.name) / "cache" / "noise_floor.json"
+
+    def tearDown(self):
+        self._dir.cleanup()
+
+    def test_keys(self):
+        keys = {
+            NoiseFloorCache.key("USB Mic", "energy", 10),
+            NoiseFloorCache.key("USB Mic", "energy", 20),
+            NoiseFloorCache.key("USB Mic", "spectral", 10),
+            NoiseFloorCache.key("Built-in", "energy", 10),
+        }
+        self.assertEqual(len(keys), 4)
+
+        cache = NoiseFloorCache()
+        cache.update(NoiseFloorCache.key("USB Mic", "energy", 10), 100.0)
+        self.assertIsNone(
+            cache.lookup(NoiseFloorCache.key("USB Mic", "energy", 20)))
+        self.assertIsNone(
+            cache.lookup(NoiseFloorCache.key("Built-in", "energy", 10)))
+
+    def test_ema(self):
+        cache = NoiseFloorCache(alpha=0.2)
+        cache.update("k", 100.0)
+        entry = cache.lookup("k")
+        self.assertEqual((entry.mean, entry.var, entry.count), (100.0, 0.0, 1))
+
+        cache.update("k", 200.0)
+        # mean += 0.2 * 100; var = 0.8 * (0 + 0.2 * 100^2)
+        self.assertAlmostEqual(entry.mean, 120.0)
+        self.assertAlmostEqual(entry.var, 1600.0)
+        self.assertAlmostEqual(entry.std, 40.0)
+        self.assertEqual(entry.count, 2)
+
+        # Converges on a steady floor, and the variance decays
+        for _ in range(100):
+            cache.update("k", 50.0)
+        self.assertAlmostEqual(entry.mean, 50.0, places=3)
+        self.assertLess(entry.var, 1e-3)
+
+    def test_round_trip(self):
+        cache = NoiseFloorCache(self.path)
+        cache.update("a", 10.0)
+        cache.update("a", 20.0)
+        cache.update("b", 3.5)
+        cache.save()
+
+        loaded = NoiseFloorCache(self.path).lookup("a")
+        expected = cache.lookup("a")
+        self.assertEqual(loaded, expected)
+        self.assertEqual(NoiseFloorCache(self.path).lookup("b").mean, 3.5)
+
+    def test_save_only_when_changed(self):
+        cache = NoiseFloorCache(self.path)
+        cache.save()
+        self.assertFalse(self.path.exists())
+
+        cache.update("a", 1.0)
+        cache.save()
+        with mock.patch.object(Path, "write_text") as write:
+            cache.save()
+            write.assert_not_called()
+        self.assertIsNone(NoiseFloorCache().lookup("a"))  # No path: memory
+
+    def test_atomic_write(self):
+        cache = NoiseFloorCache(self.path)
+        cache.update("a", 1.0)
+        cache.save()
+        before = self.path.read_text()
+        self.assertEqual(os.listdir(self.path.parent), [self.path.name])
+
+        # A failed replace leaves the old file and keeps the change
+        cache.update("a", 2.0)
+        with mock.patch("os.replace", side_effect=OSError("read-only")):
+            cache.save()
+        self.assertEqual(self.path.read_text(), before)
+        cache.save()
+        self.assertNotEqual(self.path.read_text(), before)
+
+    def test_bad_files_are_ignored(self):
+        self.path.parent.mkdir(parents=True)
+        for content in (
+            "not json",
+            "[]",
+            '{"version": 1, "entries": []}',
+            '{"version": 999, "entries": {"a": {"mean": 1.0}}}',
+            '{"version": 1, "entries": {"a": {"bogus": 1}}}',
+            '{"version": 1, "entries": {"a": 1.0}}',
+        ):
+            self.path.write_text(content)
+            self.assertIsNone(NoiseFloorCache(self.path).lookup("a"))
+
+    def test_default_path(self):
+        with mock.patch.dict(os.environ, {"CACHE_DIRECTORY": "/a:/b"}):
+            self.assertEqual(calibration.default_path(),
+                             Path("/a/noise_floor.json"))
+        env = {"XDG_CACHE_HOME": "/xdg"}
+        with mock.patch.dict(os.environ, env):
+            os.environ.pop("CACHE_DIRECTORY", None)
+            self.assertEqual(calibration.default_path(),
+                             Path("/xdg/fcitx5-voice/noise_floor.json"))
+
+
+if __name__ == "__main__":
+    unittest.main()
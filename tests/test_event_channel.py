@@ -0,0 +1,43 @@
+"""Tests for daemon/event_channel.py."""
+
+import socket
+import unittest
+
+from daemon import event_channel
+from daemon.event_channel import EventChannels, HEADER, MAX_MESSAGE
+
+
+class EventChannelsTest(unittest.TestCase):
+    def setUp(self):
+        self.channels = EventChannels()
+        self.reader = socket.socket(fileno=self.channels.open())
+
+    def tearDown(self):
+        self.reader.close()
+        self.channels.close()
+
+    def receive(self):
+        message = self.reader.recv(MAX_MESSAGE + 1)
+        kind, _, _, length, segment_num, *_ = HEADER.unpack_from(message)
+        text = message[HEADER.size:]
+        self.assertEqual(len(text), length)
+        return kind, text.decode(), segment_num
+
+    def test_send(self):
+        self.channels.send(event_channel.COMPLETED, "こんにちは", 3)
+        self.assertEqual(self.receive(),
+                         (event_channel.COMPLETED, "こんにちは", 3))
+
+    def test_long_text_is_cut_on_a_character_boundary(self):
+        # 3-byte characters never end exactly at the size limit
+        limit = MAX_MESSAGE - HEADER.size
+        text = "あ" * (limit // 3 + 10)
+        self.assertNotEqual(limit % 3, 0)
+        self.channels.send(event_channel.DELTA, text)
+        kind, received, _ = self.receive()
+        self.assertEqual(kind, event_channel.DELTA)
+        self.assertEqual(received, "あ" * (limit // 3))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,184 @@
+#include "event_queue.h"
+#include "test.h"
+#include <poll.h>
+#include <atomic>
+#include <thread>
+
+using namespace fcitx;
+using Kind = EventQueue::Kind;
+
+static EventQueue::Event event(Kind kind, std::string text) {
+    EventQueue::Event e;
+    e.kind = kind;
+    e.text = std::move(text);
+    return e;
+}
+
+static bool readable(int fd) {
+    pollfd pfd{fd, POLLIN, 0};
+    return poll(&pfd, 1, 0) == 1;
+}
+
+static void testOrder() {
+    EventQueue queue;
+    std::vector<EventQueue::Event> out;
+
+    EventQueue::Event first = event(Kind::Completed, "one");
+    first.capture_us = 1;
+    first.send_us = 2;
+    first.server_us = 3;
+    CHECK(queue.push(std::move(first)));
+    CHECK(queue.push(event(Kind::Error, "two")));
+    CHECK(queue.push(event(Kind::Completed, "three")));
+    CHECK(queue.push(event(Kind::Exhausted, "")));
+
+    queue.drain(out);
+    CHECK_EQ(out.size(), 4u);
+    if (out.size() == 4) {
+        CHECK(out[0].kind == Kind::Completed);
+        CHECK_EQ(out[0].text, "one");
+        CHECK_EQ(out[0].capture_us, 1u);
+        CHECK_EQ(out[0].send_us, 2u);
+        CHECK_EQ(out[0].server_us, 3u);
+        CHECK(out[1].kind == Kind::Error);
+        CHECK_EQ(out[2].text, "three");
+        CHECK(out[3].kind == Kind::Exhausted);
+    }
+
+    queue.drain(out);
+    CHECK(out.empty());
+}
+
+// The ring wraps around and refuses events when full
+static void testCapacity() {
+    EventQueue queue(3);  // Rounded up to 4
+    std::vector<EventQueue::Event> out;
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 4; ++i) {
+            CHECK(queue.push(event(Kind::Completed, std::to_string(i))));
+        }
+        CHECK(!queue.push(event(Kind::Completed, "full")));
+        queue.drain(out);
+        CHECK_EQ(out.size(), 4u);
+        if (!out.empty()) {
+            CHECK_EQ(out.front().text, "0");
+            CHECK_EQ(out.back().text, "3");
+        }
+    }
+}
+
+// One eventfd write per batch, cleared by drain()
+static void testWakeup() {
+    EventQueue queue;
+    std::vector<EventQueue::Event> out;
+    CHECK(!readable(queue.fd()));
+
+    queue.push(event(Kind::Completed, "a"));
+    CHECK(readable(queue.fd()));
+    queue.push(event(Kind::Completed, "b"));
+    queue.drain(out);
+    CHECK(!readable(queue.fd()));
+    CHECK_EQ(out.size(), 2u);
+
+    // A drain with nothing queued leaves it clear
+    queue.drain(out);
+    CHECK(!readable(queue.fd()));
+    queue.push(event(Kind::Completed, "c"));
+    CHECK(readable(queue.fd()));
+}
+
+// Only the newest delta is kept, and a ring event supersedes it
+static void testDeltaCoalescing() {
+    EventQueue queue;
+    std::vector<EventQueue::Event> out;
+
+    queue.push(event(Kind::Delta, "h"));
+    queue.push(event(Kind::Delta, "he"));
+    queue.push(event(Kind::Delta, "hel"));
+    queue.drain(out);
+    CHECK_EQ(out.size(), 1u);
+    if (!out.empty()) {
+        CHECK(out[0].kind == Kind::Delta);
+        CHECK_EQ(out[0].text, "hel");
+    }
+    CHECK_EQ(queue.dropped(), 2u);
+
+    queue.push(event(Kind::Delta, "hello"));
+    queue.push(event(Kind::Completed, "Hello."));
+    queue.push(event(Kind::Delta, "wor"));
+    queue.drain(out);
+    CHECK_EQ(out.size(), 2u);
+    if (out.size() == 2) {
+        CHECK_EQ(out[0].text, "Hello.");
+        CHECK_EQ(out[1].text, "wor");  // The delta comes last
+    }
+    CHECK_EQ(queue.dropped(), 3u);
+
+    queue.push(event(Kind::Delta, "stale"));
+    queue.clearDelta();
+    queue.drain(out);
+    CHECK(out.empty());
+    CHECK_EQ(queue.dropped(), 4u);
+}
+
+// A producer thread races drain(): a delta pushed after completion k
+// must arrive after completion k and never after completion k + 1,
+// which is what drain() puts it back for.
+static void testDeltaOrderUnderRace() {
+    constexpr int COMPLETIONS = 20000;
+    EventQueue queue(64);
+    std::atomic<bool> done{false};
+
+    std::thread producer([&] {
+        for (int k = 1; k <= COMPLETIONS; ++k) {
+            while (!queue.push(event(Kind::Completed, std::to_string(k)))) {
+                std::this_thread::yield();
+            }
+            queue.push(event(Kind::Delta, std::to_string(k)));
+            queue.push(event(Kind::Delta, std::to_string(k)));
+        }
+        done = true;
+    });
+
+    std::vector<EventQueue::Event> out;
+    int completed = 0;
+    int deltas = 0;
+    bool ok = true;
+    while (completed < COMPLETIONS || !done) {
+        pollfd pfd{queue.fd(), POLLIN, 0};
+        poll(&pfd, 1, 10);
+        queue.drain(out);
+        for (const auto& e : out) {
+            int k = std::stoi(e.text);
+            if (e.kind == Kind::Completed) {
+                ok = ok && k == completed + 1;
+                completed = k;
+            } else {
+                ok = ok && k == completed;
+                ++deltas;
+            }
+        }
+        if (!ok) {
+            break;
+        }
+    }
+    producer.join();
+    queue.drain(out);
+    for (const auto& e : out) {
+        ok = ok && e.kind == Kind::Delta && std::stoi(e.text) == completed;
+        ++deltas;
+    }
+    CHECK(ok);
+    CHECK_EQ(completed, COMPLETIONS);
+    // Every delta is either delivered or counted as dropped
+    CHECK_EQ(deltas + queue.dropped(), 2u * COMPLETIONS);
+}
+
+int main() {
+    testOrder();
+    testCapacity();
+    testWakeup();
+    testDeltaCoalescing();
+    testDeltaOrderUnderRace();
+    return testResult();
+}
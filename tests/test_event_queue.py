@@ -0,0 +1,121 @@
+"""Tests for daemon/event_queue.py (and the native queue when built)."""
+
+import select
+import threading
+import time
+import unittest
+
+from daemon import event_queue
+from daemon.event_queue import COMPLETED, DELTA, ERROR, EXHAUSTED
+
+
+def readable(queue) -> bool:
+    return bool(select.select([queue.fileno()], [], [], 0)[0])
+
+
+class EventQueueTests:
+    """Run against each implementation through make_queue()."""
+
+    def make_queue(self, capacity=event_queue.DEFAULT_CAPACITY):
+        raise NotImplementedError
+
+    def test_order(self):
+        queue = self.make_queue()
+        self.assertTrue(queue.push(COMPLETED, "one", 1, 2, 3))
+        self.assertTrue(queue.push(ERROR, "two"))
+        self.assertTrue(queue.push(COMPLETED, "three"))
+        self.assertTrue(queue.push(EXHAUSTED, ""))
+        self.assertEqual(queue.drain(), [
+            (COMPLETED, "one", 1, 2, 3),
+            (ERROR, "two", 0, 0, 0),
+            (COMPLETED, "three", 0, 0, 0),
+            (EXHAUSTED, "", 0, 0, 0),
+        ])
+        self.assertEqual(queue.drain(), [])
+
+    def test_capacity(self):
+        queue = self.make_queue(4)
+        for _ in range(3):
+            for i in range(4):
+                self.assertTrue(queue.push(COMPLETED, str(i)))
+            self.assertFalse(queue.push(COMPLETED, "full"))
+            self.assertEqual([e[1] for e in queue.drain()],
+                             ["0", "1", "2", "3"])
+
+    def test_wakeup(self):
+        queue = self.make_queue()
+        self.assertFalse(readable(queue))
+        queue.push(COMPLETED, "a")
+        self.assertTrue(readable(queue))
+        queue.push(COMPLETED, "b")
+        self.assertEqual(len(queue.drain()), 2)
+        self.assertFalse(readable(queue))
+        queue.drain()
+        self.assertFalse(readable(queue))
+        queue.push(COMPLETED, "c")
+        self.assertTrue(readable(queue))
+
+    def test_delta_coalescing(self):
+        queue = self.make_queue()
+        queue.push(DELTA, "h")
+        queue.push(DELTA, "he")
+        queue.push(DELTA, "hel")
+        self.assertEqual(queue.drain(), [(DELTA, "hel", 0, 0, 0)])
+        self.assertEqual(queue.dropped, 2)
+
+        # A completion supersedes the delta before it; the one after it
+        # is delivered last
+        queue.push(DELTA, "hello")
+        queue.push(COMPLETED, "Hello.")
+        queue.push(DELTA, "wor")
+        self.assertEqual([e[1] for e in queue.drain()], ["Hello.", "wor"])
+        self.assertEqual(queue.dropped, 3)
+
+        queue.push(DELTA, "stale")
+        queue.clear_delta()
+        self.assertEqual(queue.drain(), [])
+        self.assertEqual(queue.dropped, 4)
+
+    def test_delta_order_under_race(self):
+        """A delta pushed after completion k arrives after it, and never
+        after completion k + 1."""
+        queue = self.make_queue(64)
+        count = 5000
+
+        def produce():
+            for k in range(1, count + 1):
+                while not queue.push(COMPLETED, str(k)):
+                    time.sleep(0)
+                queue.push(DELTA, str(k))
+                queue.push(DELTA, str(k))
+
+        producer = threading.Thread(target=produce)
+        producer.start()
+        completed = deltas = 0
+        while completed < count or producer.is_alive():
+            select.select([queue.fileno()], [], [], 0.01)
+            for kind, text, *_ in queue.drain():
+                if kind == COMPLETED:
+                    self.assertEqual(int(text), completed + 1)
+                    completed = int(text)
+                else:
+                    self.assertEqual(int(text), completed)
+                    deltas += 1
+        producer.join()
+        deltas += len(queue.drain())
+        self.assertEqual(deltas + queue.dropped, 2 * count)
+
+
+class PyEventQueueTest(EventQueueTests, unittest.TestCase):
+    def make_queue(self, capacity=event_queue.DEFAULT_CAPACITY):
+        return event_queue._PyEventQueue(capacity)
+
+
+@unittest.skipIf(event_queue._native is None, "daemon/_native not built")
+class NativeEventQueueTest(EventQueueTests, unittest.TestCase):
+    def make_queue(self, capacity=event_queue.DEFAULT_CAPACITY):
+        return event_queue._native.EventQueue(capacity)
+
+
+if __name__ == "__main__":
+    unittest.main()
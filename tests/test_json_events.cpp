@@ -0,0 +1,107 @@
+#include "json_events.h"
+#include "test.h"
+
+using namespace fcitx;
+
+// Decoded text, or "<error>" on a malformed escape
+static std::string unescape(std::string_view raw) {
+    std::string out;
+    return appendJsonUnescaped(raw, out) ? out : "<error>";
+}
+
+static void testEscapes() {
+    CHECK_EQ(unescape("plain"), "plain");
+    CHECK_EQ(unescape(R"(a\"b\\c\/d)"), "a\"b\\c/d");
+    CHECK_EQ(unescape(R"(\n\t\r\b\f)"), "\n\t\r\b\f");
+    CHECK_EQ(unescape(R"(\u0041\u00e9\u3042)"), "A\xC3\xA9\xE3\x81\x82");
+    CHECK_EQ(unescape(R"(\u00E9)"), "\xC3\xA9");
+    // Surrogate pair: U+1F600
+    CHECK_EQ(unescape(R"(\ud83d\ude00!)"), "\xF0\x9F\x98\x80!");
+}
+
+// Each becomes U+FFFD (EF BF BD)
+static void testLoneSurrogates() {
+    CHECK_EQ(unescape(R"(\ud800)"), "\xEF\xBF\xBD");
+    CHECK_EQ(unescape(R"(\ud800x)"), "\xEF\xBF\xBDx");
+    CHECK_EQ(unescape(R"(\udc00)"), "\xEF\xBF\xBD");
+    // A high surrogate followed by something other than a low one
+    CHECK_EQ(unescape(R"(\ud800A)"), "\xEF\xBF\xBD" "A");
+    CHECK_EQ(unescape(R"(\ud800\ud800)"), "\xEF\xBF\xBD\xEF\xBF\xBD");
+    CHECK_EQ(unescape(R"(\ud800\n)"), "\xEF\xBF\xBD\n");
+}
+
+static void testMalformedEscapes() {
+    CHECK_EQ(unescape(R"(\x)"), "<error>");
+    CHECK_EQ(unescape(R"(\')"), "<error>");
+    CHECK_EQ(unescape(R"(\U0041)"), "<error>");
+    CHECK_EQ(unescape(R"(\u12)"), "<error>");
+    CHECK_EQ(unescape(R"(\u12g4)"), "<error>");
+    CHECK_EQ(unescape("trailing\\"), "<error>");
+}
+
+static void testEvents() {
+    TranscriptionEvent event;
+    CHECK(parseTranscriptionEvent(
+        R"({"type": "conversation.item.input_audio_transcription.delta",)"
+        R"( "item_id": "x", "delta": "hel\"lo"})",
+        event));
+    CHECK(event.kind == TranscriptionEvent::Kind::Delta);
+    CHECK_EQ(event.text, std::string_view(R"(hel\"lo)"));
+    CHECK(event.text_escaped);
+
+    // Member order does not matter; nested values are skipped
+    CHECK(parseTranscriptionEvent(
+        R"({"transcript":"done","extra":{"a":[1,"}",{"b":"\""}]},)"
+        R"("type":"conversation.item.input_audio_transcription.completed"})",
+        event));
+    CHECK(event.kind == TranscriptionEvent::Kind::Completed);
+    CHECK_EQ(event.text, std::string_view("done"));
+    CHECK(!event.text_escaped);
+
+    CHECK(parseTranscriptionEvent(
+        R"({"type":"error","error":{"message":"bad"}})", event));
+    CHECK(event.kind == TranscriptionEvent::Kind::Error);
+
+    CHECK(parseTranscriptionEvent(R"({"type":"session.created"})", event));
+    CHECK(event.kind == TranscriptionEvent::Kind::Other);
+
+    // Escaped quotes and backslashes before the closing quote
+    CHECK(parseTranscriptionEvent(
+        R"({"type":"conversation.item.input_audio_transcription.delta",)"
+        R"("delta":"a\\"})",
+        event));
+    CHECK_EQ(event.text, std::string_view(R"(a\\)"));
+    CHECK_EQ(unescape(event.text), "a\\");
+}
+
+static void testMalformedEvents() {
+    TranscriptionEvent event;
+    const char* inputs[] = {
+        "",
+        "[]",
+        "{",
+        R"({"type")",
+        R"({"type":)",
+        R"({"type":"delta)",
+        R"({"type":"a" "delta":"b"})",
+        R"({"type":"a",})",
+        R"({"delta":"no type"})",
+        R"({"type":1})",
+        R"({"type":"a","x":[1,2)",
+    };
+    for (const char* input : inputs) {
+        if (parseTranscriptionEvent(input, event)) {
+            testFail(__FILE__, __LINE__,
+                     std::string("accepted: ") + input);
+        }
+    }
+}
+
+int main() {
+    testEscapes();
+    testLoneSurrogates();
+    testMalformedEscapes();
+    testEvents();
+    testMalformedEvents();
+    return testResult();
+}
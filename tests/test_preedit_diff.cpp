@@ -0,0 +1,155 @@
+#include "preedit_diff.h"
+#include "test.h"
+
+using namespace fcitx;
+
+static void testUtf8CommonPrefix() {
+    CHECK_EQ(utf8CommonPrefix("", "abc"), 0u);
+    CHECK_EQ(utf8CommonPrefix("abc", "abd"), 2u);
+    CHECK_EQ(utf8CommonPrefix("abc", "abc"), 3u);
+    CHECK_EQ(utf8CommonPrefix("ab", "abc"), 2u);
+    // "本" (E6 9C AC) and "曜" (E6 9B 9C) share a lead byte
+    CHECK_EQ(utf8CommonPrefix("日本", "日曜"), 3u);
+    CHECK_EQ(utf8CommonPrefix("日本", "日本語"), 6u);
+}
+
+static void testPreeditDiff() {
+    PreeditDiff diff;
+    auto update = diff.update("hel");
+    CHECK(update.changed);
+    CHECK_EQ(update.stable, 0u);
+
+    update = diff.update("hello");
+    CHECK(update.changed);
+    CHECK_EQ(update.stable, 3u);
+    CHECK_EQ(diff.text(), "hello");
+
+    // A resend of the same text changes nothing
+    update = diff.update("hello");
+    CHECK(!update.changed);
+    CHECK_EQ(update.stable, 5u);
+
+    // Revised tail
+    update = diff.update("help");
+    CHECK(update.changed);
+    CHECK_EQ(update.stable, 3u);
+
+    // Shrinking is a change too
+    update = diff.update("he");
+    CHECK(update.changed);
+    CHECK_EQ(update.stable, 2u);
+
+    diff.reset();
+    CHECK_EQ(diff.text(), "");
+    update = diff.update("he");
+    CHECK(update.changed);
+    CHECK_EQ(update.stable, 0u);
+
+    // Not split inside a character
+    diff.reset();
+    diff.update("日本");
+    CHECK_EQ(diff.update("日曜").stable, 3u);
+}
+
+static void testWordSafeLength() {
+    CHECK_EQ(wordSafeLength("hello world", 0), 0u);
+    CHECK_EQ(wordSafeLength("hello world", 6), 6u);   // After the space
+    CHECK_EQ(wordSafeLength("hello world", 5), 5u);   // Word ends there
+    CHECK_EQ(wordSafeLength("hello world", 3), 0u);   // "hel|lo"
+    CHECK_EQ(wordSafeLength("hello world", 8), 6u);   // "wo|rld"
+    CHECK_EQ(wordSafeLength("hello world", 11), 6u);  // "world" may grow
+    CHECK_EQ(wordSafeLength("it's on", 3), 0u);       // ' is part of a word
+    CHECK_EQ(wordSafeLength("hello, world", 5), 5u);
+    // No word separators in Japanese
+    CHECK_EQ(wordSafeLength("こんにちは", 6), 6u);
+}
+
+static void testStableHorizonByCount() {
+    StableHorizon horizon(3, 0);
+    CHECK_EQ(horizon.update("he", 0), 0u);
+    CHECK_EQ(horizon.update("hel", 0), 0u);
+    CHECK_EQ(horizon.update("hell", 0), 2u);  // "he" seen three times
+    CHECK_EQ(horizon.update("hello", 0), 3u);
+    // A revision cuts the horizon back to the unchanged part, which keeps
+    // its age
+    CHECK_EQ(horizon.update("help", 0), 3u);
+    CHECK_EQ(horizon.update("hex", 0), 2u);
+    horizon.reset();
+    CHECK_EQ(horizon.update("hex", 0), 0u);
+}
+
+static void testStableHorizonByTime() {
+    StableHorizon horizon(100, 500);
+    CHECK_EQ(horizon.update("a", 1000), 0u);
+    CHECK_EQ(horizon.update("ab", 1400), 0u);
+    CHECK_EQ(horizon.update("abc", 1500), 1u);  // "a" is 500 us old
+    CHECK_EQ(horizon.update("abc", 2000), 3u);
+}
+
+// Without further updates a prefix still becomes stable at its deadline
+static void testStableHorizonDeadline() {
+    StableHorizon horizon(100, 500);
+    CHECK_EQ(horizon.deadline(0), 0u);
+    horizon.update("a", 1000);
+    horizon.update("ab", 1200);
+    CHECK_EQ(horizon.deadline(1200), 1500u);  // "a" first
+    CHECK_EQ(horizon.stable(1499), 0u);
+    CHECK_EQ(horizon.stable(1500), 1u);
+    CHECK_EQ(horizon.deadline(1500), 1700u);
+    CHECK_EQ(horizon.stable(1700), 2u);
+    CHECK_EQ(horizon.deadline(1700), 0u);
+    CHECK_EQ(horizon.text(), "ab");
+
+    StableHorizon by_count(3, 0);
+    by_count.update("a", 0);
+    CHECK_EQ(by_count.deadline(0), 0u);
+}
+
+static void testStableHorizonUtf8() {
+    // "日本" and "日曜" share a lead byte but only "日" is stable
+    StableHorizon horizon(2, 0);
+    horizon.update("日本", 0);
+    CHECK_EQ(horizon.update("日曜", 0), 3u);
+}
+
+static void testCommittedLength() {
+    CHECK_EQ(committedLength("", "hello"), 0u);
+    CHECK_EQ(committedLength("hello ", "hello world"), 6u);
+    CHECK_EQ(committedLength("hello ", "hello "), 6u);
+    // Shorter than what was committed: nothing left to show
+    CHECK_EQ(committedLength("hello world ", "hello"), 5u);
+}
+
+// The server revised text that was committed early: only what follows
+// the committed part may be committed, or "hello " shows up twice
+static void testCommittedLengthRevision() {
+    std::string text = "Hello world.";
+    size_t skip = committedLength("hello ", text);
+    CHECK_EQ(text.substr(skip), "world.");
+
+    // The skip does not end inside a word of the revision
+    text = "Helloworld";
+    CHECK_EQ(text.substr(committedLength("hello", text)), "");
+    text = "Hello there";
+    CHECK_EQ(text.substr(committedLength("hi ", text)), " there");
+    CHECK_EQ(text.substr(committedLength("hi", text)), " there");
+
+    // Nor inside a multi-byte character
+    text = "今日は世界";
+    CHECK_EQ(text.substr(committedLength("こんに", text)), "世界");
+    CHECK_EQ(text.substr(committedLength("こん", text)), "は世界");
+    CHECK_EQ(text.substr(committedLength("aこ", text)), "は世界");
+}
+
+int main() {
+    testUtf8CommonPrefix();
+    testPreeditDiff();
+    testWordSafeLength();
+    testStableHorizonByCount();
+    testStableHorizonByTime();
+    testStableHorizonDeadline();
+    testStableHorizonUtf8();
+    testCommittedLength();
+    testCommittedLengthRevision();
+    return testResult();
+}
@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""Micro-benchmark for building input_audio_buffer.append messages.
+
+Compares the per-chunk cost of:
+  json      - the original b64encode + json.dumps + uuid4 event id
+  template  - the pure-Python preformatted frame in daemon/frames.py
+  native    - the SIMD base64 AppendFrame in daemon/_native (built with
+              the C++ plugin)
+
+Chunks are cut from every fixture WAV (tools/fixtures/, see
+generate_fixtures.py) or from synthetic noise when none is available.
+Each implementation's messages are checked to decode back to the chunk
+before timing.
+
+Usage:
+    uv run python tools/bench_base64.py
+    uv run python tools/bench_base64.py --wav tools/fixtures/noisy.wav
+    uv run python tools/bench_base64.py --chunks 20 100 --json
+"""
+
+import argparse
+import base64
+import json
+import random
+import struct
+import sys
+import time
+import uuid
+import wave
+from pathlib import Path
+
+TOOLS_DIR = Path(__file__).resolve().parent
+PROJECT_ROOT = TOOLS_DIR.parent
+FIXTURES_DIR = TOOLS_DIR / "fixtures"
+
+sys.path.insert(0, str(PROJECT_ROOT))
+from daemon import frames  # noqa: E402
+from daemon.recorder import SAMPLE_RATE  # noqa: E402
+
+
+def append_json(chunk: bytes) -> str:
+    """The pre-template implementation from RivaWSClient.send_audio."""
+    return json.dumps(
+        {
+            "event_id": f"event_{uuid.uuid4()}",
+            "type": "input_audio_buffer.append",
+            "audio": base64.b64encode(chunk).decode("ascii"),
+        }
+    )
+
+
+def load_pcm(wavs: list[Path]) -> bytes:
+    if not wavs:
+        wavs = sorted(FIXTURES_DIR.glob("*.wav"))
+    if wavs:
+        pcm = bytearray()
+        for wav in wavs:
+            with wave.open(str(wav), "rb") as wf:
+                print(f"Audio: {wav}")
+                pcm += wf.readframes(wf.getnframes())
+        return bytes(pcm)
+    print("Audio: synthetic noise (no fixtures found)")
+    rng = random.Random(0)
+    return struct.pack(
+        f"<{SAMPLE_RATE * 5}h",
+        *(rng.randint(-3000, 3000) for _ in range(SAMPLE_RATE * 5)),
+    )
+
+
+def check(name: str, fn, chunks: list[bytes]) -> None:
+    for chunk in chunks:
+        event = json.loads(fn(chunk))
+        if (event["type"] != "input_audio_buffer.append"
+                or base64.b64decode(event["audio"]) != chunk):
+            raise SystemExit(f"{name}: message does not round-trip")
+
+
+def bench(fn, chunks: list[bytes], min_time: float) -> float:
+    """Return mean nanoseconds per chunk."""
+    calls = 0
+    start = time.perf_counter_ns()
+    deadline = start + int(min_time * 1e9)
+    while True:
+        for chunk in chunks:
+            fn(chunk)
+        calls += len(chunks)
+        now = time.perf_counter_ns()
+        if now >= deadline:
+            return (now - start) / calls
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--wav", type=Path, nargs="+", default=[],
+                        help="PCM16 mono WAVs to slice (default: all fixtures)")
+    parser.add_argument(
+        "--chunks", type=int, nargs="+", default=[100],
+        help="Chunk sizes in ms (default: 100, the daemon's send interval)",
+    )
+    parser.add_argument(
+        "--min-time", type=float, default=0.5,
+        help="Seconds to run each measurement (default: 0.5)",
+    )
+    parser.add_argument("--json", action="store_true",
+                        help="Print machine-readable results")
+    args = parser.parse_args()
+
+    pcm = load_pcm(args.wav)
+    impls = {
+        "json": append_json,
+        "template": frames._PyAppendFrame().build,
+    }
+    if frames._native is not None:
+        impls["native"] = frames._native.AppendFrame().build
+    else:
+        print("Native module not built (daemon/_native); skipping native")
+
+    results = []
+    for chunk_ms in args.chunks:
+        chunk_bytes = SAMPLE_RATE * chunk_ms // 1000 * 2
+        chunks = [
+            pcm[i:i + chunk_bytes]
+            for i in range(0, len(pcm) - chunk_bytes + 1, chunk_bytes)
+        ]
+        for name, fn in impls.items():
+            check(name, fn, chunks[:50])
+            ns = bench(fn, chunks, args.min_time)
+            results.append({
+                "impl": name,
+                "chunk_ms": chunk_ms,
+                "ns_per_chunk": round(ns, 1),
+                "mb_per_s": round(chunk_bytes / ns * 1e3, 1),
+                # Share of one CPU spent per second of audio
+                "realtime_pct": round(ns / (chunk_ms * 1e6) * 100, 4),
+            })
+
+    if args.json:
+        print(json.dumps({"kernel": frames.KERNEL, "results": results},
+                         indent=2))
+        return 0
+
+    print(f"Kernel: {frames.KERNEL}")
+    print(f"{'impl':<9} {'chunk':>6} {'ns/chunk':>12} {'MB/s':>8} "
+          f"{'% realtime':>11} {'speedup':>8}")
+    for chunk_ms in args.chunks:
+        rows = [r for r in results if r["chunk_ms"] == chunk_ms]
+        baseline = rows[0]["ns_per_chunk"]
+        for r in rows:
+            print(f"{r['impl']:<9} {chunk_ms:>4}ms {r['ns_per_chunk']:>12.1f} "
+                  f"{r['mb_per_s']:>8.1f} {r['realtime_pct']:>10.4f}% "
+                  f"{baseline / r['ns_per_chunk']:>7.1f}x")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Micro-benchmark for the silence-detection energy computation.
+
+Compares the per-chunk RMS cost of:
+  python  - the original struct.unpack + generator loop
+  numpy   - the numpy fallback in daemon/dsp.py
+  native  - the SIMD kernel in daemon/_native (built with the C++ plugin)
+
+Frames are cut from a fixture WAV (tools/fixtures/, see
+generate_fixtures.py) or from synthetic noise when none is available.
+
+Usage:
+    uv run python tools/bench_energy.py
+    uv run python tools/bench_energy.py --wav tools/fixtures/noisy.wav
+    uv run python tools/bench_energy.py --frames 10 20 100 --json
+"""
+
+import argparse
+import json
+import random
+import struct
+import sys
+import time
+import wave
+from pathlib import Path
+
+TOOLS_DIR = Path(__file__).resolve().parent
+PROJECT_ROOT = TOOLS_DIR.parent
+FIXTURES_DIR = TOOLS_DIR / "fixtures"
+
+sys.path.insert(0, str(PROJECT_ROOT))
+from daemon import dsp  # noqa: E402
+from daemon.recorder import SAMPLE_RATE  # noqa: E402
+
+
+def rms_python_loop(chunk: bytes) -> float:
+    """The pre-kernel implementation from _send_audio_loop."""
+    samples = struct.unpack(f"<{len(chunk) // 2}h", chunk)
+    return (sum(s * s for s in samples) / len(samples)) ** 0.5
+
+
+def rms_numpy(chunk: bytes) -> float:
+    import numpy as np
+    samples = np.frombuffer(chunk, dtype=np.int16).astype(np.float64)
+    return float(np.sqrt(np.dot(samples, samples) / len(samples)))
+
+
+def load_pcm(wav: Path | None) -> bytes:
+    if wav is None:
+        candidates = sorted(FIXTURES_DIR.glob("*.wav"))
+        wav = candidates[0] if candidates else None
+    if wav is not None:
+        with wave.open(str(wav), "rb") as wf:
+            print(f"Audio: {wav}")
+            return wf.readframes(wf.getnframes())
+    print("Audio: synthetic noise (no fixtures found)")
+    rng = random.Random(0)
+    return struct.pack(
+        f"<{SAMPLE_RATE * 5}h",
+        *(rng.randint(-3000, 3000) for _ in range(SAMPLE_RATE * 5)),
+    )
+
+
+def bench(fn, frames: list[bytes], min_time: float) -> float:
+    """Return mean nanoseconds per frame."""
+    calls = 0
+    start = time.perf_counter_ns()
+    deadline = start + int(min_time * 1e9)
+    while True:
+        for frame in frames:
+            fn(frame)
+        calls += len(frames)
+        now = time.perf_counter_ns()
+        if now >= deadline:
+            return (now - start) / calls
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--wav", type=Path, help="PCM16 mono WAV to slice")
+    parser.add_argument(
+        "--frames", type=int, nargs="+", default=[10, 20, 100],
+        help="Frame sizes in ms (default: 10 20 100)",
+    )
+    parser.add_argument(
+        "--min-time", type=float, default=0.5,
+        help="Seconds to run each measurement (default: 0.5)",
+    )
+    parser.add_argument("--json", action="store_true",
+                        help="Print machine-readable results")
+    args = parser.parse_args()
+
+    pcm = load_pcm(args.wav)
+    impls = {"python": rms_python_loop, "numpy": rms_numpy}
+    if dsp._native is not None:
+        impls["native"] = lambda chunk: dsp._native.energy(chunk)[0]
+    else:
+        print("Native module not built (daemon/_native); skipping native")
+
+    results = []
+    for frame_ms in args.frames:
+        frame_bytes = SAMPLE_RATE * frame_ms // 1000 * 2
+        frames = [
+            pcm[i:i + frame_bytes]
+            for i in range(0, len(pcm) - frame_bytes + 1, frame_bytes)
+        ][:500]
+        for name, fn in impls.items():
+            ns = bench(fn, frames, args.min_time)
+            results.append({
+                "impl": name,
+                "frame_ms": frame_ms,
+                "ns_per_frame": round(ns, 1),
+                # Share of one CPU spent per second of audio
+                "realtime_pct": round(ns / (frame_ms * 1e6) * 100, 4),
+            })
+
+    if args.json:
+        print(json.dumps({"kernel": dsp.KERNEL, "results": results}, indent=2))
+        return 0
+
+    print(f"Kernel: {dsp.KERNEL}")
+    print(f"{'impl':<8} {'frame':>6} {'ns/frame':>12} {'% realtime':>11} "
+          f"{'speedup':>8}")
+    for frame_ms in args.frames:
+        rows = [r for r in results if r["frame_ms"] == frame_ms]
+        baseline = rows[0]["ns_per_frame"]
+        for r in rows:
+            print(f"{r['impl']:<8} {frame_ms:>4}ms {r['ns_per_frame']:>12.1f} "
+                  f"{r['realtime_pct']:>10.4f}% "
+                  f"{baseline / r['ns_per_frame']:>7.1f}x")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+"""Benchmark for handing server events to the GLib main loop.
+
+Compares how the daemon's asyncio thread delivers events to the GLib
+thread that emits D-Bus signals:
+
+  idle_add  - one GLib.idle_add closure per event (the original bridge)
+  python    - event_queue._PyEventQueue (deque + eventfd, batched)
+  native    - daemon/_native EventQueue (lock-free SPSC + eventfd)
+
+A producer thread replays a dictation session (a growing delta per
+character, a completion per sentence) in bursts of --burst events every
+--interval-ms, as a server flushing partial results does. Reported per
+implementation: main-loop dispatches, signals that would be emitted
+(superseded deltas are dropped by the queues), process CPU time and
+producer-to-dispatch latency.
+
+Usage:
+    uv run python tools/bench_event_queue.py
+    uv run python tools/bench_event_queue.py --burst 8 --interval-ms 5 --json
+"""
+
+import argparse
+import json
+import sys
+import threading
+import time
+from pathlib import Path
+
+from gi.repository import GLib
+
+TOOLS_DIR = Path(__file__).resolve().parent
+PROJECT_ROOT = TOOLS_DIR.parent
+
+sys.path.insert(0, str(PROJECT_ROOT))
+sys.path.insert(0, str(TOOLS_DIR))
+from daemon import event_queue  # noqa: E402
+from generate_fixtures import FIXTURES  # noqa: E402
+
+
+def make_corpus() -> list[tuple[int, str]]:
+    events = []
+    for spec in FIXTURES:
+        for text in spec.texts:
+            for i in range(1, len(text) + 1):
+                events.append((event_queue.DELTA, text[:i]))
+            events.append((event_queue.COMPLETED, text))
+    return events
+
+
+def percentile(sorted_values: list[int], p: float) -> int:
+    if not sorted_values:
+        return 0
+    return sorted_values[min(len(sorted_values) - 1,
+                             int(len(sorted_values) * p / 100))]
+
+
+def produce(push, corpus, burst: int, interval_s: float, done) -> None:
+    for start in range(0, len(corpus), burst):
+        for kind, text in corpus[start:start + burst]:
+            push(kind, text, time.monotonic_ns() // 1000)
+        time.sleep(interval_s)
+    done()
+
+
+def run(impl: str, corpus, burst: int, interval_s: float) -> dict:
+    loop = GLib.MainLoop()
+    stats = {"dispatches": 0, "signals": 0}
+    latencies: list[int] = []
+
+    def emit(kind: int, stamp_us: int) -> None:
+        stats["signals"] += 1
+        latencies.append(time.monotonic_ns() // 1000 - stamp_us)
+
+    if impl == "idle_add":
+        def on_idle(kind, stamp_us):
+            stats["dispatches"] += 1
+            emit(kind, stamp_us)
+            return False
+
+        def push(kind, text, stamp_us):
+            GLib.idle_add(on_idle, kind, stamp_us)
+
+        def done():
+            GLib.idle_add(loop.quit)
+    else:
+        queue = (event_queue._PyEventQueue() if impl == "python"
+                 else event_queue._native.EventQueue())
+
+        def on_events(fd, condition):
+            stats["dispatches"] += 1
+            for kind, text, stamp_us, _, _ in queue.drain():
+                if kind == event_queue.EXHAUSTED:
+                    loop.quit()
+                    return False
+                emit(kind, stamp_us)
+            return True
+
+        def push(kind, text, stamp_us):
+            while not queue.push(kind, text, stamp_us):
+                time.sleep(0.001)
+
+        def done():
+            push(event_queue.EXHAUSTED, "", 0)
+
+        GLib.unix_fd_add_full(GLib.PRIORITY_DEFAULT, queue.fileno(),
+                              GLib.IOCondition.IN, on_events)
+
+    producer = threading.Thread(
+        target=produce, args=(push, corpus, burst, interval_s, done)
+    )
+    cpu = time.process_time()
+    producer.start()
+    loop.run()
+    producer.join()
+    cpu = time.process_time() - cpu
+
+    latencies.sort()
+    return {
+        "impl": impl,
+        "events": len(corpus),
+        "dispatches": stats["dispatches"],
+        "signals": stats["signals"],
+        "cpu_ms": round(cpu * 1000, 1),
+        "p50_us": percentile(latencies, 50),
+        "p99_us": percentile(latencies, 99),
+    }
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--burst", type=int, default=4,
+                        help="Events per burst (default: 4)")
+    parser.add_argument("--interval-ms", type=float, default=10,
+                        help="Pause between bursts (default: 10)")
+    parser.add_argument("--json", action="store_true",
+                        help="Print machine-readable results")
+    args = parser.parse_args()
+
+    impls = ["idle_add", "python"]
+    if event_queue._native is not None:
+        impls.append("native")
+    else:
+        print("Native module not built (daemon/_native); skipping native")
+
+    corpus = make_corpus()
+    results = [run(impl, corpus, args.burst, args.interval_ms / 1000)
+               for impl in impls]
+
+    if args.json:
+        print(json.dumps({"burst": args.burst,
+                          "interval_ms": args.interval_ms,
+                          "results": results}, indent=2))
+        return 0
+
+    print(f"{len(corpus)} events, bursts of {args.burst} every "
+          f"{args.interval_ms:g} ms")
+    print(f"{'impl':<10}{'dispatches':>12}{'signals':>10}{'cpu ms':>10}"
+          f"{'p50 us':>10}{'p99 us':>10}")
+    for r in results:
+        print(f"{r['impl']:<10}{r['dispatches']:>12}{r['signals']:>10}"
+              f"{r['cpu_ms']:>10.1f}{r['p50_us']:>10}{r['p99_us']:>10}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""Micro-benchmark for parsing transcription events on the receive path.
+
+Compares the per-event cost of:
+  json    - the original json.loads + dict lookups
+  native  - the pull parser in daemon/_native (built with the C++ plugin)
+
+The corpus is a dictation session over the fixture texts from
+generate_fixtures.py: a growing delta per character (space-separated,
+as the Japanese model emits them) and a completed event per sentence,
+in the Riva event envelope. Messages are benchmarked both ASCII-escaped
+(json.dumps default, as the mock server sends them) and as raw UTF-8
+bytes, the form RivaWSClient.recv_loop receives.
+
+Usage:
+    uv run python tools/bench_events.py
+    uv run python tools/bench_events.py --min-time 2 --json
+"""
+
+import argparse
+import json
+import sys
+import time
+import uuid
+from pathlib import Path
+
+TOOLS_DIR = Path(__file__).resolve().parent
+PROJECT_ROOT = TOOLS_DIR.parent
+
+sys.path.insert(0, str(PROJECT_ROOT))
+sys.path.insert(0, str(TOOLS_DIR))
+from daemon import events  # noqa: E402
+from generate_fixtures import FIXTURES  # noqa: E402
+
+
+def make_corpus(ensure_ascii: bool) -> list[bytes]:
+    messages = []
+    for spec in FIXTURES:
+        for text in spec.texts:
+            item_id = f"item_{uuid.uuid4().hex[:24]}"
+            for i in range(1, len(text) + 1):
+                messages.append({
+                    "event_id": f"event_{uuid.uuid4()}",
+                    "type": events.DELTA_TYPE,
+                    "item_id": item_id,
+                    "content_index": 0,
+                    "delta": " ".join(text[:i]),
+                })
+            messages.append({
+                "event_id": f"event_{uuid.uuid4()}",
+                "type": events.COMPLETED_TYPE,
+                "item_id": item_id,
+                "content_index": 0,
+                "transcript": " ".join(text),
+            })
+    return [json.dumps(m, ensure_ascii=ensure_ascii).encode() for m in messages]
+
+
+def bench(fn, messages: list[bytes], min_time: float) -> float:
+    """Return mean nanoseconds per event."""
+    calls = 0
+    start = time.perf_counter_ns()
+    deadline = start + int(min_time * 1e9)
+    while True:
+        for message in messages:
+            fn(message)
+        calls += len(messages)
+        now = time.perf_counter_ns()
+        if now >= deadline:
+            return (now - start) / calls
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument(
+        "--min-time", type=float, default=0.5,
+        help="Seconds to run each measurement (default: 0.5)",
+    )
+    parser.add_argument("--json", action="store_true",
+                        help="Print machine-readable results")
+    args = parser.parse_args()
+
+    impls = {"json": events._parse_event_json}
+    if events._native is not None:
+        impls["native"] = events._native.parse_event
+    else:
+        print("Native module not built (daemon/_native); skipping native")
+
+    results = []
+    for encoding, ensure_ascii in (("escaped", True), ("utf-8", False)):
+        messages = make_corpus(ensure_ascii)
+        for name, fn in impls.items():
+            # Same answers as json.loads before timing anything
+            for message in messages:
+                if fn(message) != events._parse_event_json(message):
+                    raise SystemExit(f"{name}: wrong result for {message!r}")
+            ns = bench(fn, messages, args.min_time)
+            results.append({
+                "impl": name,
+                "encoding": encoding,
+                "ns_per_event": round(ns, 1),
+                "events_per_s": round(1e9 / ns),
+            })
+
+    if args.json:
+        print(json.dumps({"parser": events.PARSER, "results": results},
+                         indent=2))
+        return 0
+
+    print(f"{'impl':<8} {'encoding':>8} {'ns/event':>10} {'events/s':>12} "
+          f"{'speedup':>8}")
+    for encoding in ("escaped", "utf-8"):
+        rows = [r for r in results if r["encoding"] == encoding]
+        baseline = rows[0]["ns_per_event"]
+        for r in rows:
+            print(f"{r['impl']:<8} {encoding:>8} {r['ns_per_event']:>10.1f} "
+                  f"{r['events_per_s']:>12,} "
+                  f"{baseline / r['ns_per_event']:>7.1f}x")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
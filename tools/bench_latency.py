@@ -0,0 +1,315 @@
+#!/usr/bin/env python3
+"""Latency benchmark for the daemon -> D-Bus -> plugin receive path.
+
+Replays fixture WAVs through the real pipeline, isolated from the
+desktop session:
+
+  mock_riva_server.py  (--server-delay between events)
+      -> fcitx5-voice-daemon --replay-wav FIXTURE --trace
+      -> private dbus-daemon
+      -> fcitx5-voice-dbus-bench (DBusClient, as linked into the plugin)
+
+Every transcription signal carries the daemon's trace stamps (see
+daemon/tracing.py) plus the harness's dispatch time, giving per-stage
+latency for deltas and completions:
+
+  send    audio captured -> sent to the server
+  server  sent -> server event received (includes --server-delay)
+  daemon  server event -> D-Bus signal emitted
+  dbus    emitted -> dispatched by DBusClient
+  total   audio captured -> dispatched by DBusClient
+
+CPU time (user+system) is reported per process: the mock server, the
+daemon(s), dbus-daemon and the harness, along with the messages the
+harness received, their rate while each replay was streaming, and the
+daemon, dbus-daemon and harness CPU time per message.
+
+Usage:
+    uv run python tools/bench_latency.py
+    uv run python tools/bench_latency.py --fixture long_speech --repeat 3
+    uv run python tools/bench_latency.py --server-delay 0.02 --json > bench.json
+    uv run python tools/bench_latency.py --peer  # dbus stage without the bus hop
+    uv run python tools/bench_latency.py --channel  # binary event channel
+"""
+
+import argparse
+import json
+import os
+import signal
+import subprocess
+import sys
+import time
+from pathlib import Path
+
+TOOLS_DIR = Path(__file__).resolve().parent
+PROJECT_ROOT = TOOLS_DIR.parent
+FIXTURES_DIR = TOOLS_DIR / "fixtures"
+
+DEFAULT_BENCH = PROJECT_ROOT / "build" / "plugin" / "fcitx5-voice-dbus-bench"
+DEFAULT_FIXTURES = ["short_phrase", "multi_phrase", "long_speech"]
+DEFAULT_PORT = 9198
+
+DBUS_DEST = "org.fcitx.Fcitx5.Voice"
+DBUS_PATH = "/org/fcitx/Fcitx5/Voice"
+
+STAGES = [
+    ("send", "capture", "send"),
+    ("server", "send", "server"),
+    ("daemon", "server", "emit"),
+    ("dbus", "emit", "receive"),
+    ("total", "capture", "receive"),
+]
+PERCENTILES = (50, 95, 99)
+
+
+def percentile(sorted_values: list[int], p: float) -> int:
+    """Nearest-rank percentile."""
+    if not sorted_values:
+        return 0
+    rank = max(1, -(-len(sorted_values) * p // 100))
+    return sorted_values[int(rank) - 1]
+
+
+def summarize(values: list[int]) -> dict:
+    values = sorted(values)
+    summary = {"count": len(values)}
+    for p in PERCENTILES:
+        summary[f"p{p}_ms"] = percentile(values, p) / 1000
+    summary["max_ms"] = (values[-1] if values else 0) / 1000
+    return summary
+
+
+def cpu_seconds(proc: subprocess.Popen) -> float:
+    """Reap proc and return its user+system CPU time."""
+    _, _, usage = os.wait4(proc.pid, 0)
+    proc.returncode = 0  # Reaped here; keep Popen from waiting again
+    return usage.ru_utime + usage.ru_stime
+
+
+def stop(proc: subprocess.Popen) -> float:
+    proc.send_signal(signal.SIGTERM)
+    deadline = time.monotonic() + 5
+    while time.monotonic() < deadline:
+        pid, _, usage = os.wait4(proc.pid, os.WNOHANG)
+        if pid:
+            proc.returncode = 0
+            return usage.ru_utime + usage.ru_stime
+        time.sleep(0.05)
+    proc.kill()
+    return cpu_seconds(proc)
+
+
+def ensure_fixture(name: str) -> Path:
+    path = FIXTURES_DIR / f"{name}.wav"
+    if not path.exists():
+        print(f"Generating fixture: {name}", file=sys.stderr)
+        subprocess.run(
+            [sys.executable, str(TOOLS_DIR / "generate_fixtures.py"), name],
+            check=True, stdout=subprocess.DEVNULL,
+        )
+    return path
+
+
+def start_bus() -> tuple[subprocess.Popen, str]:
+    proc = subprocess.Popen(
+        ["dbus-daemon", "--session", "--nofork", "--print-address=1"],
+        stdout=subprocess.PIPE, text=True,
+    )
+    address = proc.stdout.readline().strip()
+    if not address:
+        raise RuntimeError("dbus-daemon did not report an address")
+    return proc, address
+
+
+def wait_for_daemon(env: dict, timeout: float = 10.0) -> bool:
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        r = subprocess.run(
+            ["gdbus", "call", "--session", "--dest", DBUS_DEST,
+             "--object-path", DBUS_PATH,
+             "--method", f"{DBUS_DEST}.GetStatus", "--timeout", "1"],
+            env=env, capture_output=True,
+        )
+        if r.returncode == 0:
+            return True
+        time.sleep(0.2)
+    return False
+
+
+def transport(args) -> str:
+    if args.channel:
+        return "channel"
+    return "peer" if args.peer else "bus"
+
+
+def run_fixture(args, wav: Path, env: dict, samples: dict, cpu: dict,
+                traffic: dict) -> None:
+    daemon = subprocess.Popen(
+        [sys.executable, "-m", "daemon.main",
+         "--url", f"ws://localhost:{args.port}",
+         "--replay-wav", str(wav), "--trace"],
+        cwd=str(PROJECT_ROOT), env=env,
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+    )
+    try:
+        if not wait_for_daemon(env):
+            raise RuntimeError(f"daemon did not appear on the bus ({wav.name})")
+
+        harness = subprocess.Popen(
+            [str(args.bench), "--idle-ms", str(args.idle_ms)]
+            + ([f"--{transport(args)}"] if args.peer or args.channel
+               else []),
+            env=env, stdout=subprocess.PIPE, text=True,
+        )
+        output = harness.stdout.read()
+        cpu["harness"] += cpu_seconds(harness)
+    finally:
+        cpu["daemon"] += stop(daemon)
+
+    first = last = 0
+    for line in output.splitlines():
+        kind, *fields = line.split("\t")
+        if kind == "error":
+            raise RuntimeError(f"{wav.name}: {fields[0] if fields else ''}")
+        if kind not in ("delta", "completed"):
+            continue
+        receive, capture, send, server, emit = map(int, fields[:5])
+        traffic["messages"] += 1
+        first = first or receive
+        last = receive
+        stamps = {"receive": receive, "capture": capture, "send": send,
+                  "server": server, "emit": emit}
+        if not capture:
+            raise RuntimeError(f"{wav.name}: untraced signal "
+                               "(daemon without --trace support?)")
+        for stage, start, end in STAGES:
+            if stamps[start] and stamps[end] >= stamps[start]:
+                samples[kind][stage].append(stamps[end] - stamps[start])
+    traffic["span_us"] += last - first
+
+
+def per_message(traffic: dict, cpu: dict) -> dict:
+    messages = traffic["messages"]
+    span_s = traffic["span_us"] / 1e6
+    return {
+        "messages": messages,
+        "messages_per_s": round(messages / span_s, 1) if span_s else 0.0,
+        "cpu_us_per_message": {
+            name: round(cpu[name] / messages * 1e6, 1) if messages else 0.0
+            for name in ("daemon", "dbus-daemon", "harness")
+        },
+    }
+
+
+def print_table(result: dict) -> None:
+    print(f"server delay {result['server_delay_s'] * 1000:.0f} ms, "
+          f"fixtures {', '.join(result['fixtures'])} x{result['repeat']}, "
+          f"over the {result['transport']}")
+    for kind in ("delta", "completed"):
+        stages = result["latency"][kind]
+        print(f"\n{kind} (n={stages['total']['count']})")
+        print(f"  {'stage':<8}" + "".join(
+            f"{f'p{p} ms':>10}" for p in PERCENTILES) + f"{'max ms':>10}")
+        for stage, _, _ in STAGES:
+            s = stages[stage]
+            print(f"  {stage:<8}" + "".join(
+                f"{s[f'p{p}_ms']:>10.2f}" for p in PERCENTILES
+            ) + f"{s['max_ms']:>10.2f}")
+    print("\nCPU time (s)")
+    for process, seconds in result["cpu_s"].items():
+        print(f"  {process:<12}{seconds:>8.3f}")
+    traffic = result["traffic"]
+    print(f"\n{traffic['messages']} messages, "
+          f"{traffic['messages_per_s']:.1f}/s while streaming")
+    print("CPU per message (us)")
+    for process, micros in traffic["cpu_us_per_message"].items():
+        print(f"  {process:<12}{micros:>8.1f}")
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Benchmark daemon -> D-Bus -> plugin latency"
+    )
+    parser.add_argument("--fixture", action="append", metavar="NAME",
+                        help="Fixture to replay (repeatable; default: "
+                        + ", ".join(DEFAULT_FIXTURES) + ")")
+    parser.add_argument("--repeat", type=int, default=1,
+                        help="Replays per fixture (default: 1)")
+    parser.add_argument("--server-delay", type=float, default=0.1,
+                        metavar="SECONDS",
+                        help="Mock server delay between events (default: 0.1)")
+    parser.add_argument("--port", type=int, default=DEFAULT_PORT,
+                        help=f"Mock server port (default: {DEFAULT_PORT})")
+    parser.add_argument("--bench", type=Path, default=DEFAULT_BENCH,
+                        help="fcitx5-voice-dbus-bench binary")
+    parser.add_argument("--idle-ms", type=int, default=2000,
+                        help="End a replay after this long without a signal")
+    parser.add_argument("--peer", action="store_true",
+                        help="Deliver signals over the daemon's direct "
+                        "connection instead of the bus")
+    parser.add_argument("--channel", action="store_true",
+                        help="Deliver events over the daemon's binary event "
+                        "channel instead of D-Bus signals")
+    parser.add_argument("--json", action="store_true",
+                        help="Print results as JSON")
+    args = parser.parse_args()
+
+    if not args.bench.exists():
+        print(f"ERROR: {args.bench} not found (build with "
+              "-DENABLE_DBUS_BENCH=ON)", file=sys.stderr)
+        return 1
+    fixtures = args.fixture or DEFAULT_FIXTURES
+    wavs = [ensure_fixture(name) for name in fixtures]
+
+    samples = {kind: {stage: [] for stage, _, _ in STAGES}
+               for kind in ("delta", "completed")}
+    cpu = {"mock_server": 0.0, "daemon": 0.0, "dbus-daemon": 0.0,
+           "harness": 0.0}
+    traffic = {"messages": 0, "span_us": 0}
+
+    bus, address = start_bus()
+    env = dict(os.environ, DBUS_SESSION_BUS_ADDRESS=address)
+    server = subprocess.Popen(
+        [sys.executable, str(TOOLS_DIR / "mock_riva_server.py"),
+         "--port", str(args.port), "--delay", str(args.server_delay)],
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+    )
+    status = 0
+    try:
+        time.sleep(1.0)
+        if server.poll() is not None:
+            raise RuntimeError("mock server failed to start")
+        for _ in range(args.repeat):
+            for wav in wavs:
+                run_fixture(args, wav, env, samples, cpu, traffic)
+    except (RuntimeError, subprocess.CalledProcessError) as e:
+        print(f"ERROR: {e}", file=sys.stderr)
+        status = 1
+    finally:
+        if server.returncode is None:
+            cpu["mock_server"] = stop(server)
+        cpu["dbus-daemon"] = stop(bus)
+    if status:
+        return status
+
+    result = {
+        "server_delay_s": args.server_delay,
+        "fixtures": fixtures,
+        "repeat": args.repeat,
+        "transport": transport(args),
+        "latency": {
+            kind: {stage: summarize(values) for stage, values in stages.items()}
+            for kind, stages in samples.items()
+        },
+        "cpu_s": {name: round(seconds, 4) for name, seconds in cpu.items()},
+        "traffic": per_message(traffic, cpu),
+    }
+    if args.json:
+        print(json.dumps(result, indent=2))
+    else:
+        print_table(result)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
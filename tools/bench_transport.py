@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""Compare the plugin's event transports end to end.
+
+Runs tools/bench_latency.py once per transport with the mock server
+streaming as fast as it can (--server-delay 0 by default), so delivery
+rather than the server sets the pace:
+
+  bus      D-Bus signals through the session bus daemon
+  peer     D-Bus signals over the daemon's direct connection
+  channel  binary SOCK_SEQPACKET event channel (no D-Bus per event)
+
+Reported per transport: messages received, messages/s while streaming,
+CPU per message for the daemon, dbus-daemon and the harness (the
+plugin's receive path), and p50/p99 of the emit -> dispatch stage.
+
+Usage:
+    uv run python tools/bench_transport.py
+    uv run python tools/bench_transport.py --fixture long_speech --repeat 3
+    uv run python tools/bench_transport.py --json > transport.json
+"""
+
+import argparse
+import json
+import subprocess
+import sys
+from pathlib import Path
+
+TOOLS_DIR = Path(__file__).resolve().parent
+
+TRANSPORTS = {
+    "bus": [],
+    "peer": ["--peer"],
+    "channel": ["--channel"],
+}
+
+
+def run(transport: str, args, passthrough: list[str]) -> dict:
+    r = subprocess.run(
+        [sys.executable, str(TOOLS_DIR / "bench_latency.py"), "--json",
+         "--server-delay", str(args.server_delay), "--repeat", str(args.repeat),
+         *passthrough, *TRANSPORTS[transport]],
+        capture_output=True, text=True,
+    )
+    if r.returncode != 0:
+        raise RuntimeError(f"{transport}: {r.stderr.strip()}")
+    return json.loads(r.stdout)
+
+
+def print_table(results: dict) -> None:
+    print(f"{'transport':<10}{'messages':>10}{'msg/s':>10}"
+          f"{'daemon us':>11}{'bus us':>9}{'plugin us':>11}"
+          f"{'p50 ms':>9}{'p99 ms':>9}")
+    for transport, result in results.items():
+        traffic = result["traffic"]
+        cpu = traffic["cpu_us_per_message"]
+        dbus = result["latency"]["delta"]["dbus"]
+        print(f"{transport:<10}{traffic['messages']:>10}"
+              f"{traffic['messages_per_s']:>10.1f}"
+              f"{cpu['daemon']:>11.1f}{cpu['dbus-daemon']:>9.1f}"
+              f"{cpu['harness']:>11.1f}"
+              f"{dbus['p50_ms']:>9.2f}{dbus['p99_ms']:>9.2f}")
+    print("\nCPU is per received message; p50/p99 are delta emit -> dispatch.")
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Compare bus, peer and event channel delivery"
+    )
+    parser.add_argument("--transport", action="append",
+                        choices=list(TRANSPORTS),
+                        help="Transport to run (repeatable; default: all)")
+    parser.add_argument("--fixture", action="append", metavar="NAME",
+                        help="Fixture to replay (repeatable)")
+    parser.add_argument("--repeat", type=int, default=1,
+                        help="Replays per fixture (default: 1)")
+    parser.add_argument("--server-delay", type=float, default=0.0,
+                        metavar="SECONDS",
+                        help="Mock server delay between events (default: 0)")
+    parser.add_argument("--bench", type=Path,
+                        help="fcitx5-voice-dbus-bench binary")
+    parser.add_argument("--json", action="store_true",
+                        help="Print results as JSON")
+    args = parser.parse_args()
+
+    passthrough = []
+    for name in args.fixture or []:
+        passthrough += ["--fixture", name]
+    if args.bench:
+        passthrough += ["--bench", str(args.bench)]
+
+    results = {}
+    try:
+        for transport in args.transport or list(TRANSPORTS):
+            print(f"Running {transport}...", file=sys.stderr)
+            results[transport] = run(transport, args, passthrough)
+    except RuntimeError as e:
+        print(f"ERROR: {e}", file=sys.stderr)
+        return 1
+
+    if args.json:
+        print(json.dumps(results, indent=2))
+    else:
+        print_table(results)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -27,7 +27,7 @@ from pathlib import Path
 
 sys.path.insert(0, str(Path(__file__).resolve().parent.parent))
 from daemon.ws_client import RivaWSClient, DEFAULT_URL, DEFAULT_MODEL, DEFAULT_LANGUAGE  # noqa: E402
-from daemon.recorder import SAMPLE_RATE, CHUNK_SIZE, CHUNK_BYTES  # noqa: E402
+from daemon.recorder import SAMPLE_RATE, CHUNK_SIZE, CHUNK_BYTES, CHUNK_DURATION_MS  # noqa: E402
 
 # ---------------------------------------------------------------------------
 # ANSI color helpers
@@ -104,7 +104,7 @@ class ReplayState:
         print(f"{_color(f'[{self.elapsed():5.2f}s]', _DIM, self.use_color)} {label} {_color(message, _RED, self.use_color)}", flush=True)
 
     def log_chunk(self, chunk_num: int) -> None:
-        msg = f"Sending audio: 100ms chunk #{chunk_num}"
+        msg = f"Sending audio: {CHUNK_DURATION_MS}ms chunk #{chunk_num}"
         self.log(msg, _DIM)
 
 
@@ -164,7 +164,7 @@ def open_wav(path: str) -> tuple[wave.Wave_read, float]:
 def read_chunks(wf: wave.Wave_read) -> list[bytes]:
     """Read all frames from an open WAV file as a list of raw PCM16 chunks.
 
-    Each chunk is CHUNK_BYTES bytes (3200 bytes = 1600 samples = 100 ms at 16 kHz).
+    Each chunk is CHUNK_BYTES bytes (640 bytes = 320 samples = 20 ms at 16 kHz).
     The last chunk is zero-padded if the file length is not an exact multiple.
     """
     chunks = []
@@ -204,7 +204,7 @@ async def send_audio_fixed_interval(
         chunks_since_commit += 1
 
         if chunks_since_commit >= commit_interval:
-            audio_sent_s = chunks_since_commit * 0.1  # 100ms per chunk
+            audio_sent_s = chunks_since_commit * CHUNK_DURATION_MS / 1000
             state.commits_sent += 1
             state.log_commit(
                 f"Commit #{state.commits_sent} (sent {audio_sent_s:.1f}s of audio)"
@@ -291,7 +291,7 @@ async def replay_file(
     # Load WAV chunks
     wf, duration = open_wav(wav_path)
     chunks = read_chunks(wf)
-    total_audio_s = len(chunks) * 0.1  # each chunk is 100ms
+    total_audio_s = len(chunks) * CHUNK_DURATION_MS / 1000
     state.log_info(
         f"Loaded {wav_path}: {duration:.2f}s audio, {len(chunks)} chunks"
     )
@@ -490,18 +490,19 @@ def parse_args() -> argparse.Namespace:
     parser.add_argument(
         "--commit-interval",
         type=int,
-        default=10,
+        default=1000 // CHUNK_DURATION_MS,
         metavar="N",
-        help="Commit every N chunks (N * 100ms).",
+        help=f"Commit every N chunks (N * {CHUNK_DURATION_MS}ms).",
     )
     parser.add_argument(
         "--chunk-delay",
         type=float,
-        default=0.1,
+        default=CHUNK_DURATION_MS / 1000,
         metavar="SECONDS",
         help=(
             "Delay between sending chunks in seconds. "
-            "0.1 = real-time (100ms). 0 = as fast as possible."
+            f"{CHUNK_DURATION_MS / 1000} = real-time ({CHUNK_DURATION_MS}ms). "
+            "0 = as fast as possible."
         ),
     )
     parser.add_argument(
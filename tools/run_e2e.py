@@ -1,12 +1,16 @@
 #!/usr/bin/env python3
 """End-to-end test for the fcitx5-voice pipeline.
 
-Two modes:
+Three modes:
 
   mock (default)
     Starts a local mock Riva server, sends a sine-wave WAV, and verifies
     the transcription responses. No real server or microphone needed.
 
+  native (--native)
+    Same as mock, but the WAV is streamed by the plugin's in-process C++
+    transport (fcitx5-voice-asr-cli) instead of the Python client.
+
   live (--live)
     Starts the daemon with --replay-wav against a real Riva server, monitors
     D-Bus signals, and verifies completions against expected substrings.
@@ -16,6 +20,9 @@ Usage:
     # Mock mode – fully offline
     python tools/run_e2e.py
 
+    # Native transport against the mock server (build the plugin first)
+    python tools/run_e2e.py --native
+
     # Live mode – real server, default fixture (short_phrase)
     python tools/run_e2e.py --live --url ws://spark-fd28.local:9000
 
@@ -46,11 +53,18 @@ TOOLS_DIR = Path(__file__).resolve().parent
 PROJECT_ROOT = TOOLS_DIR.parent
 FIXTURES_DIR = TOOLS_DIR / "fixtures"
 
+sys.path.insert(0, str(PROJECT_ROOT))
+from daemon.recorder import CHUNK_DURATION_MS  # noqa: E402
+
 DBUS_DEST = "org.fcitx.Fcitx5.Voice"
 DBUS_PATH = "/org/fcitx/Fcitx5/Voice"
 DBUS_IFACE = "org.fcitx.Fcitx5.Voice"
 
 DEFAULT_MOCK_PORT = 9199
+# Mock mode replays at 10x real time and commits once per second of audio
+MOCK_REPLAY_SPEED = 10
+MOCK_COMMIT_INTERVAL = 1000 // CHUNK_DURATION_MS
+DEFAULT_ASR_CLI = PROJECT_ROOT / "build" / "plugin" / "fcitx5-voice-asr-cli"
 DEFAULT_FIXTURE = "multi_phrase"
 DEFAULT_LIVE_TIMEOUT = 40  # seconds
 
@@ -66,6 +80,45 @@ MOCK_EXPECTED = {
 # Mock mode (existing behavior)
 # ---------------------------------------------------------------------------
 
+def _start_mock_server(args: argparse.Namespace, port: int) -> subprocess.Popen | None:
+    server_cmd = [sys.executable, str(TOOLS_DIR / "mock_riva_server.py"), "--port", str(port)]
+    if args.scenario:
+        server_cmd += ["--scenario", args.scenario]
+    server_proc = subprocess.Popen(server_cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    time.sleep(1.0)
+    if server_proc.poll() is not None:
+        _, err = server_proc.communicate()
+        print(f"FAILED to start mock server:\n{err.decode()}", file=sys.stderr)
+        return None
+    print(f"       Server PID: {server_proc.pid}")
+    return server_proc
+
+
+def _stop_mock_server(server_proc: subprocess.Popen) -> None:
+    server_proc.send_signal(signal.SIGTERM)
+    try:
+        server_proc.wait(timeout=5)
+    except subprocess.TimeoutExpired:
+        server_proc.kill()
+        server_proc.wait()
+
+
+def _check_mock_completions(actual_texts: set[str]) -> int:
+    missing = MOCK_EXPECTED - actual_texts
+    extra = actual_texts - MOCK_EXPECTED
+    if missing:
+        print(f"  FAIL: missing completions: {missing}")
+    if extra:
+        print(f"  WARN: unexpected completions: {extra}")
+
+    if not missing:
+        print("E2E TEST PASSED")
+        return 0
+    else:
+        print("E2E TEST FAILED")
+        return 1
+
+
 def run_mock_mode(args: argparse.Namespace) -> int:
     python = sys.executable
     wav_path = args.wav
@@ -87,16 +140,9 @@ def run_mock_mode(args: argparse.Namespace) -> int:
 
     port = args.port or DEFAULT_MOCK_PORT
     print(f"[2/4] Starting mock Riva server on port {port}...")
-    server_cmd = [python, str(TOOLS_DIR / "mock_riva_server.py"), "--port", str(port)]
-    if args.scenario:
-        server_cmd += ["--scenario", args.scenario]
-    server_proc = subprocess.Popen(server_cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-    time.sleep(1.0)
-    if server_proc.poll() is not None:
-        _, err = server_proc.communicate()
-        print(f"FAILED to start mock server:\n{err.decode()}", file=sys.stderr)
+    server_proc = _start_mock_server(args, port)
+    if server_proc is None:
         return 1
-    print(f"       Server PID: {server_proc.pid}")
 
     print(f"[3/4] Replaying WAV to mock server...")
     capture_file = args.capture or tempfile.NamedTemporaryFile(
@@ -106,8 +152,8 @@ def run_mock_mode(args: argparse.Namespace) -> int:
         python, str(TOOLS_DIR / "replay_to_server.py"),
         wav_path,
         "--url", f"ws://localhost:{port}",
-        "--chunk-delay", "0.01",
-        "--commit-interval", "10",
+        "--chunk-delay", str(CHUNK_DURATION_MS / 1000 / MOCK_REPLAY_SPEED),
+        "--commit-interval", str(MOCK_COMMIT_INTERVAL),
         "--no-color",
         "--capture", capture_file,
     ]
@@ -116,12 +162,7 @@ def run_mock_mode(args: argparse.Namespace) -> int:
     replay_result = subprocess.run(replay_cmd, text=True)
 
     print(f"[4/4] Stopping mock server...")
-    server_proc.send_signal(signal.SIGTERM)
-    try:
-        server_proc.wait(timeout=5)
-    except subprocess.TimeoutExpired:
-        server_proc.kill()
-        server_proc.wait()
+    _stop_mock_server(server_proc)
 
     # Set-based assertion: order-independent check of completion texts
     import json as _json
@@ -142,20 +183,78 @@ def run_mock_mode(args: argparse.Namespace) -> int:
         print("E2E TEST FAILED (replay error)")
         return 1
 
-    missing = MOCK_EXPECTED - actual_texts
-    extra = actual_texts - MOCK_EXPECTED
-    if missing:
-        print(f"  FAIL: missing completions: {missing}")
-    if extra:
-        print(f"  WARN: unexpected completions: {extra}")
+    return _check_mock_completions(actual_texts)
 
-    if not missing:
-        print("E2E TEST PASSED")
-        return 0
-    else:
-        print("E2E TEST FAILED")
+
+# ---------------------------------------------------------------------------
+# Native mode (C++ transport against the mock server)
+# ---------------------------------------------------------------------------
+
+def run_native_mode(args: argparse.Namespace) -> int:
+    asr_cli = Path(args.asr_cli)
+    if not asr_cli.exists():
+        print(f"ERROR: {asr_cli} not found (build with -DENABLE_ASR_CLI=ON)",
+              file=sys.stderr)
+        return 1
+
+    wav_path = args.wav or str(FIXTURES_DIR / f"{DEFAULT_FIXTURE}.wav")
+    if not Path(wav_path).exists():
+        print(f"[1/4] Generating fixture: {DEFAULT_FIXTURE}")
+        r = subprocess.run(
+            [sys.executable, str(TOOLS_DIR / "generate_fixtures.py"), DEFAULT_FIXTURE],
+            capture_output=True, text=True,
+        )
+        if r.returncode != 0 or not Path(wav_path).exists():
+            print(f"FAILED to generate fixture:\n{r.stderr}", file=sys.stderr)
+            return 1
+    print(f"[1/4] Using WAV: {wav_path}")
+
+    port = args.port or DEFAULT_MOCK_PORT
+    print(f"[2/4] Starting mock Riva server on port {port}...")
+    server_proc = _start_mock_server(args, port)
+    if server_proc is None:
+        return 1
+
+    print(f"[3/4] Streaming WAV through {asr_cli.name}...")
+    cli_cmd = [
+        str(asr_cli),
+        "--url", f"ws://localhost:{port}",
+        "--speed", str(args.speed),
+        wav_path,
+    ]
+    try:
+        cli_result = subprocess.run(
+            cli_cmd, capture_output=True, text=True, timeout=args.timeout,
+        )
+    except subprocess.TimeoutExpired:
+        print(f"[4/4] Stopping mock server...")
+        _stop_mock_server(server_proc)
+        print()
+        print(f"E2E TEST FAILED (no result within {args.timeout:.0f}s)")
         return 1
 
+    print(f"[4/4] Stopping mock server...")
+    _stop_mock_server(server_proc)
+
+    actual_texts: set[str] = set()
+    for line in cli_result.stdout.splitlines():
+        kind, _, text = line.partition("\t")
+        if args.verbose:
+            print(f"       {kind}: {text}")
+        if kind == "completed" and text:
+            actual_texts.add(text)
+        elif kind == "error":
+            print(f"  ERROR: {text}")
+    if args.verbose and cli_result.stderr:
+        print(cli_result.stderr, file=sys.stderr)
+
+    print()
+    if cli_result.returncode != 0:
+        print("E2E TEST FAILED (native client error)")
+        return 1
+
+    return _check_mock_completions(actual_texts)
+
 
 # ---------------------------------------------------------------------------
 # Live mode (daemon + real server + D-Bus monitoring)
@@ -344,6 +443,18 @@ def main() -> int:
         "--live", action="store_true",
         help="Live mode: real Riva server + daemon instead of mock server.",
     )
+    parser.add_argument(
+        "--native", action="store_true",
+        help="Native mode: stream through the C++ transport (fcitx5-voice-asr-cli).",
+    )
+    parser.add_argument(
+        "--asr-cli", metavar="PATH", default=str(DEFAULT_ASR_CLI),
+        help="fcitx5-voice-asr-cli binary (native mode).",
+    )
+    parser.add_argument(
+        "--speed", type=float, default=4.0,
+        help="WAV replay speed relative to real time (native mode).",
+    )
     parser.add_argument("--url", metavar="URL", help="Riva WebSocket URL (live mode).")
     parser.add_argument(
         "--fixture", metavar="NAME", default=DEFAULT_FIXTURE,
@@ -355,7 +466,7 @@ def main() -> int:
     )
     parser.add_argument(
         "--timeout", type=float, default=DEFAULT_LIVE_TIMEOUT,
-        help="Seconds to wait for RecordingStopped (live mode).",
+        help="Seconds to wait for RecordingStopped (live mode) or the native client.",
     )
     parser.add_argument("--debug", action="store_true", help="Enable daemon debug logging.")
     parser.add_argument("--wav", metavar="FILE", help="Use a specific WAV file.")
@@ -365,7 +476,11 @@ def main() -> int:
     parser.add_argument("--capture", metavar="FILE", help="Capture responses to JSON (mock mode).")
 
     args = parser.parse_args()
-    return run_live_mode(args) if args.live else run_mock_mode(args)
+    if args.live:
+        return run_live_mode(args)
+    if args.native:
+        return run_native_mode(args)
+    return run_mock_mode(args)
 
 
 if __name__ == "__main__":
@@ -39,7 +39,7 @@ PROJECT_ROOT = TOOLS_DIR.parent
 
 sys.path.insert(0, str(PROJECT_ROOT))
 from daemon.ws_client import RivaWSClient  # noqa: E402
-from daemon.recorder import WavReplaySource, CHUNK_BYTES  # noqa: E402
+from daemon.recorder import WavReplaySource, CHUNK_BYTES, CHUNK_DURATION_MS  # noqa: E402
 
 DEFAULT_PORT = 9198
 
@@ -384,11 +384,11 @@ async def _send_audio_loop(
         stop_after_chunks: If set, trigger stop_event after sending this
                            many chunks (for deterministic mid-stop testing).
     """
-    CALIBRATION_CHUNKS = 10
+    CALIBRATION_CHUNKS = 1000 // CHUNK_DURATION_MS
     NOISE_MULTIPLIER = 3.0
     MIN_THRESHOLD = 300
-    SILENCE_COMMIT_CHUNKS = 2
-    FLUSH_INTERVAL_CHUNKS = 10
+    SILENCE_COMMIT_CHUNKS = 200 // CHUNK_DURATION_MS
+    FLUSH_INTERVAL_CHUNKS = 1000 // CHUNK_DURATION_MS
     MAX_FLUSHES = 3
 
     loop = asyncio.get_event_loop()
@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""Dump the fcitx5-voice plugin's counters and latency histograms.
+
+The plugin serves them over D-Bus (org.fcitx.Fcitx5.Voice.Stats on
+/org/fcitx/Fcitx5/Voice/Stats, bus name org.fcitx.Fcitx5.Voice.Plugin)
+while fcitx5 runs. Counters are totals since fcitx5 started or the last
+--reset; histogram values are microseconds, percentiles within ~6%.
+
+Usage:
+    uv run python tools/voice_stats.py
+    uv run python tools/voice_stats.py --json > stats-$(date +%F).json
+    uv run python tools/voice_stats.py --watch 5
+    uv run python tools/voice_stats.py --reset
+"""
+
+import argparse
+import json
+import sys
+import time
+
+from gi.repository import Gio, GLib
+
+SERVICE = "org.fcitx.Fcitx5.Voice.Plugin"
+PATH = "/org/fcitx/Fcitx5/Voice/Stats"
+INTERFACE = "org.fcitx.Fcitx5.Voice.Stats"
+
+HISTOGRAM_FIELDS = ("count", "mean", "p50", "p90", "p99", "p999", "max")
+
+
+def call(bus: Gio.DBusConnection, method: str, reply_type: str | None):
+    return bus.call_sync(
+        SERVICE, PATH, INTERFACE, method, None,
+        GLib.VariantType.new(reply_type) if reply_type else None,
+        Gio.DBusCallFlags.NO_AUTO_START, 1000, None,
+    )
+
+
+def get_stats(bus: Gio.DBusConnection) -> dict:
+    counters, histograms = call(bus, "GetStats", "(a{st}a(sttttttt))").unpack()
+    return {
+        "counters": counters,
+        "histograms": {
+            name: dict(zip(HISTOGRAM_FIELDS, values))
+            for name, *values in histograms
+        },
+    }
+
+
+def print_table(stats: dict) -> None:
+    width = max(map(len, stats["counters"]))
+    for name, value in stats["counters"].items():
+        print(f"{name:<{width}}  {value:>10}")
+    print()
+    print(f"{'histogram (ms)':<22}" + "".join(
+        f"{field:>10}" for field in HISTOGRAM_FIELDS
+    ))
+    for name, h in stats["histograms"].items():
+        row = f"{h['count']:>10}" + "".join(
+            f"{h[field] / 1000:>10.2f}" for field in HISTOGRAM_FIELDS[1:]
+        )
+        print(f"{name:<22}{row}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--json", action="store_true",
+                        help="Print one JSON object (with a timestamp)")
+    parser.add_argument("--watch", type=float, metavar="SECONDS",
+                        help="Repeat every SECONDS until interrupted")
+    parser.add_argument("--reset", action="store_true",
+                        help="Reset all counters and histograms")
+    args = parser.parse_args()
+
+    try:
+        bus = Gio.bus_get_sync(Gio.BusType.SESSION, None)
+        if args.reset:
+            call(bus, "Reset", None)
+            return
+        while True:
+            stats = get_stats(bus)
+            if args.json:
+                stats["time"] = time.time()
+                print(json.dumps(stats), flush=True)
+            else:
+                print_table(stats)
+            if not args.watch:
+                break
+            time.sleep(args.watch)
+            if not args.json:
+                print()
+    except GLib.Error as e:
+        print(f"Cannot reach the fcitx5-voice plugin: {e.message}",
+              file=sys.stderr)
+        sys.exit(1)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()